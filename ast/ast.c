@@ -6,6 +6,7 @@
 // method to create program node or block node
 ASTNode* create_program_node(ASTNode** statements, int count, NodeType type) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = type;
     node->scope = create_scope(NULL);
@@ -22,6 +23,7 @@ ASTNode* create_program_node(ASTNode** statements, int count, NodeType type) {
 // method to create number node
 ASTNode* create_number_node(double value) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_NUMBER;
     node->scope = create_scope(NULL);
@@ -35,6 +37,7 @@ ASTNode* create_number_node(double value) {
 // method to create string node
 ASTNode* create_string_node(char* value) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_STRING;
     node->scope = create_scope(NULL);
@@ -48,6 +51,7 @@ ASTNode* create_string_node(char* value) {
 // method to create boolean node
 ASTNode* create_boolean_node(char* value) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_BOOLEAN;
     node->scope = create_scope(NULL);
@@ -61,6 +65,7 @@ ASTNode* create_boolean_node(char* value) {
 // method to create variable node
 ASTNode* create_variable_node(char* name, char* type, int is_param) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->is_param = is_param;
     node->type = NODE_VARIABLE;
@@ -79,6 +84,7 @@ ASTNode* create_variable_node(char* name, char* type, int is_param) {
 // method to create binary operation node
 ASTNode* create_binary_op_node(Operator op, char* op_name, ASTNode* left, ASTNode* right, Type* return_type) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_BINARY_OP;
     node->scope = create_scope(NULL);
@@ -95,6 +101,7 @@ ASTNode* create_binary_op_node(Operator op, char* op_name, ASTNode* left, ASTNod
 // method to create unary operation node
 ASTNode* create_unary_op_node(Operator op, char* op_name, ASTNode* operand, Type* return_type) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_UNARY_OP;
     node->scope = create_scope(NULL);
@@ -111,6 +118,7 @@ ASTNode* create_unary_op_node(Operator op, char* op_name, ASTNode* operand, Type
 // method to create assignment node or destructive assignment node
 ASTNode* create_assignment_node(char* var, ASTNode* value, char* type_name, NodeType type) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->checked = 0;
     node->type = type;
@@ -127,6 +135,7 @@ ASTNode* create_assignment_node(char* var, ASTNode* value, char* type_name, Node
 // method to create function call node
 ASTNode* create_func_call_node(char* name, ASTNode** args, int arg_count) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_FUNC_CALL;
     node->scope = create_scope(NULL);
@@ -146,6 +155,7 @@ ASTNode* create_func_call_node(char* name, ASTNode** args, int arg_count) {
 // method to create function declaration node
 ASTNode* create_func_dec_node(char* name, ASTNode** args, int arg_count, ASTNode* body, char* ret_type) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_FUNC_DEC;
     node->return_type = &TYPE_VOID;
@@ -167,6 +177,7 @@ ASTNode* create_func_dec_node(char* name, ASTNode** args, int arg_count, ASTNode
 // method to create let-in node
 ASTNode* create_let_in_node(ASTNode** declarations, int dec_count, ASTNode* body) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_LET_IN;
     node->return_type = &TYPE_OBJECT;
@@ -186,6 +197,7 @@ ASTNode* create_let_in_node(ASTNode** declarations, int dec_count, ASTNode* body
 // method to create conditional (if) node
 ASTNode* create_conditional_node(ASTNode* condition, ASTNode* body_true, ASTNode* body_false) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_CONDITIONAL;
     node->return_type = &TYPE_OBJECT;
@@ -203,6 +215,7 @@ ASTNode* create_conditional_node(ASTNode* condition, ASTNode* body_true, ASTNode
 // method to create q-conditional (if?) node
 ASTNode* create_q_conditional_node(ASTNode* exp, ASTNode* body_true, ASTNode* body_false) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_Q_CONDITIONAL;
     node->return_type = &TYPE_OBJECT;
@@ -220,6 +233,7 @@ ASTNode* create_q_conditional_node(ASTNode* exp, ASTNode* body_true, ASTNode* bo
 // method to create loop node (while loop)
 ASTNode* create_loop_node(ASTNode* condition, ASTNode* body) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_LOOP;
     node->return_type = &TYPE_OBJECT;
@@ -234,6 +248,7 @@ ASTNode* create_loop_node(ASTNode* condition, ASTNode* body) {
 // method to create for loop node
 ASTNode* create_for_loop_node(char* var_name, ASTNode** params, ASTNode* body, int count) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_FOR_LOOP;
     node->return_type = &TYPE_OBJECT;
@@ -254,6 +269,7 @@ ASTNode* create_for_loop_node(char* var_name, ASTNode** params, ASTNode* body, i
 // method to create type testing node or type downcasting node
 ASTNode* create_test_casting_type_node(ASTNode* exp, char* type_name, int test) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = test? NODE_TEST_TYPE : NODE_CAST_TYPE;
     node->return_type = test? &TYPE_BOOLEAN : &TYPE_OBJECT;
@@ -271,6 +287,7 @@ ASTNode* create_type_dec_node(
     ASTNode** p_params, int p_param_count, ASTNode* body_block, int p_constructor
 ) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_TYPE_DEC;
     node->return_type = &TYPE_VOID;
@@ -306,6 +323,7 @@ ASTNode* create_type_dec_node(
 // method to create type instance node
 ASTNode* create_type_instance_node(char* name, ASTNode** args, int arg_count) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_TYPE_INST;
     node->scope = create_scope(NULL);
@@ -325,6 +343,7 @@ ASTNode* create_type_instance_node(char* name, ASTNode** args, int arg_count) {
 // method to create type attribute or method getter node
 ASTNode* create_attr_getter_node(ASTNode* instance, ASTNode* member) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_TYPE_GET_ATTR;
     node->scope = create_scope(NULL);
@@ -338,6 +357,7 @@ ASTNode* create_attr_getter_node(ASTNode* instance, ASTNode* member) {
 // method to create type attribute setter node
 ASTNode* create_attr_setter_node(ASTNode* instance, ASTNode* member, ASTNode* value) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_TYPE_SET_ATTR;
     node->return_type = &TYPE_OBJECT;
@@ -353,6 +373,7 @@ ASTNode* create_attr_setter_node(ASTNode* instance, ASTNode* member, ASTNode* va
 // method to create 'base' function node
 ASTNode* create_base_func_node(ASTNode** args, int arg_count) {
     ASTNode* node = malloc(sizeof(ASTNode));
+    node->flags = 0;
     node->line = line_num;
     node->type = NODE_BASE_FUNC;
     node->scope = create_scope(NULL);
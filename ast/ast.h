@@ -32,6 +32,26 @@ typedef enum {
     NODE_BASE_FUNC
 } NodeType;
 
+// hints set over the typed AST by the optimization phase
+typedef enum {
+    FLAG_IN_PLACE_APPEND = 1 << 0, // 's := s @ ...' over a uniquely owned string
+    FLAG_GC_SAFEPOINT = 1 << 1,    // loop whose iterations leave no pending temporaries
+    FLAG_STACK_INSTANCE = 1 << 2,  // 'new' whose instance never escapes the current frame
+    FLAG_TAIL_CALL = 1 << 3,       // recursive call in tail position of a global function
+    FLAG_NON_RECURSIVE = 1 << 4,   // global function that is not part of any cycle of calls
+    FLAG_INLINE = 1 << 5,          // function or method cheap enough to inline at its call sites
+    FLAG_PURE = 1 << 6,            // function or method that neither reads nor writes memory
+    FLAG_READ_ONLY = 1 << 7,       // function or method that reads memory but never writes it
+    FLAG_WILL_RETURN = 1 << 8,     // function or method that runs no loop and reaches no cycle of calls
+    FLAG_DEPTH_COUNTED = 1 << 9,   // function or method that reaches one updating the stack depth counter
+    FLAG_MEMOIZABLE = 1 << 10,     // recursive function without effects whose results can be cached
+    FLAG_INTEGRAL = 1 << 11,       // Number expression or 'let' variable that always holds an integer of at most 53 bits
+    FLAG_CLOSURE = 1 << 12,        // function declared inside a block, called with the variables it captures
+    FLAG_DISCARDED = 1 << 13,      // expression whose value is never used
+    FLAG_DEAD = 1 << 14,           // discarded expression without effects, which is not generated
+    FLAG_IMMUTABLE = 1 << 15,      // 'let' variable or parameter never reassigned, bound to its value without a slot
+} NodeFlag;
+
 typedef struct ASTNode {
     int line;
     int is_param;
@@ -42,6 +62,7 @@ typedef struct ASTNode {
     Scope* scope;
     Context* context;
     NodeList* derivations;
+    int flags; // hints from the optimization phase (NodeFlag)
     union {
         double number_value;
         char* string_value;
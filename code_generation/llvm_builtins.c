@@ -1,5 +1,9 @@
 #include "llvm_builtins.h"
 #include "llvm_core.h"
+#include "llvm_string.h"
+#include "llvm_tagged.h"
+#include "llvm_closure.h"
+#include "llvm_operators.h"
 #include "../type/type.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,16 +30,75 @@ LLVMValueRef generate_builtin_function(LLVM_Visitor* v, ASTNode* node) {
     else if (!strcmp(node->data.func_node.name, "rand")) {
         return rand_function(v, node);
     }
+    else if (!strcmp(node->data.func_node.name, "flush")) {
+        return flush_function(v, node);
+    }
 
     return generate_user_function_call(v, node);
 }
 
+// print(a @ b @@ c ...): las piezas van directo a la salida, sin construir
+// el string concatenado. Sin buffer es un solo printf con un "%s" por pieza
+static LLVMValueRef print_concatenation(LLVM_Visitor* v, ASTNode* arg_node) {
+    LLVMValueRef* pieces;
+    LLVMValueRef* lengths;
+    int count = generate_concat_pieces(v, arg_node, &pieces, &lengths);
+    LLVMValueRef result = NULL;
+
+    if (buffered_output) {
+        for (int i = 0; i < count; i++) {
+            if (pieces[i]) {
+                build_write(pieces[i], lengths[i]);
+            } else {
+                build_write(get_global_string(" ", "space"), LLVMConstInt(LLVMInt64Type(), 1, 0));
+            }
+        }
+        result = build_print_newline();
+    } else {
+        char* format = malloc(2 * count + 2);
+        LLVMValueRef* args = malloc((count + 1) * sizeof(LLVMValueRef));
+        int length = 0;
+        int arg_count = 1;
+        for (int i = 0; i < count; i++) {
+            if (pieces[i]) {
+                format[length++] = '%';
+                format[length++] = 's';
+                args[arg_count++] = pieces[i];
+            } else {
+                format[length++] = ' ';
+            }
+        }
+        format[length++] = '\n';
+        format[length] = '\0';
+        args[0] = get_global_string(format, "fmt");
+
+        LLVMValueRef printf_func = LLVMGetNamedFunction(module, "printf");
+        LLVMTypeRef printf_type = LLVMFunctionType(LLVMInt32Type(),
+            (LLVMTypeRef[]){LLVMPointerType(LLVMInt8Type(), 0)}, 1, 1);
+        result = LLVMBuildCall2(builder, printf_type, printf_func, args, arg_count, "printf_call");
+        free(format);
+        free(args);
+    }
+
+    free(pieces);
+    free(lengths);
+    return result;
+}
+
 LLVMValueRef print_function(LLVM_Visitor* v, ASTNode* node) {
+    if (node->data.func_node.arg_count > 0 && is_concat_node(node->data.func_node.args[0])) {
+        return print_concatenation(v, node->data.func_node.args[0]);
+    }
+
+    if (buffered_output) {
+        return buffered_print_function(v, node);
+    }
+
     LLVMValueRef printf_func = LLVMGetNamedFunction(module, "printf");
 
     // Si no hay argumentos, solo imprime una nueva línea
     if (node->data.func_node.arg_count == 0) {
-        LLVMValueRef format_str = LLVMBuildGlobalStringPtr(builder, "\n", "newline");
+        LLVMValueRef format_str = get_global_string("\n", "newline");
         LLVMTypeRef printf_type = LLVMFunctionType(LLVMInt32Type(),
             (LLVMTypeRef[]){LLVMPointerType(LLVMInt8Type(), 0)}, 1, 1);
         return LLVMBuildCall2(builder, printf_type, printf_func,
@@ -54,27 +117,31 @@ LLVMValueRef print_function(LLVM_Visitor* v, ASTNode* node) {
 
     // Seleccionar formato según el tipo del argumento
     if (type_equals(arg_node->return_type, &TYPE_NUMBER)) {
-        format = "%g\n";
-        format_str = LLVMBuildGlobalStringPtr(builder, format, "fmt");
+        // El número se formatea con la rutina propia y se imprime como string
+        LLVMValueRef buffer_ptr = generate_number_buffer();
+        generate_number_to_string(arg, buffer_ptr);
+
+        format = "%s\n";
+        format_str = get_global_string(format, "fmt");
         args[0] = format_str;
-        args[1] = arg;
+        args[1] = buffer_ptr;
     } else if (type_equals(arg_node->return_type, &TYPE_BOOLEAN)) {
-        format_str = LLVMBuildGlobalStringPtr(builder, "%s\n", "fmt");
-        LLVMValueRef true_str = LLVMBuildGlobalStringPtr(builder, "true", "true_str");
-        LLVMValueRef false_str = LLVMBuildGlobalStringPtr(builder, "false", "false_str");
+        format_str = get_global_string("%s\n", "fmt");
+        LLVMValueRef true_str = get_global_string("true", "true_str");
+        LLVMValueRef false_str = get_global_string("false", "false_str");
         LLVMValueRef cond_str = LLVMBuildSelect(builder, arg, true_str, false_str, "bool_str");
         args[0] = format_str;
         args[1] = cond_str;
     } else if (type_equals(arg_node->return_type, &TYPE_STRING)) {
         format = "%s\n";
-        format_str = LLVMBuildGlobalStringPtr(builder, format, "fmt");
+        format_str = get_global_string(format, "fmt");
         args[0] = format_str;
         args[1] = arg;
     } else {
         // Handle unknown type
         format = "%s\n";
-        format_str = LLVMBuildGlobalStringPtr(builder, format, "fmt");
-        LLVMValueRef unknown_str = LLVMBuildGlobalStringPtr(builder, "<unknown>", "unknown_str");
+        format_str = get_global_string(format, "fmt");
+        LLVMValueRef unknown_str = get_global_string("<unknown>", "unknown_str");
         args[0] = format_str;
         args[1] = unknown_str;
     }
@@ -85,6 +152,43 @@ LLVMValueRef print_function(LLVM_Visitor* v, ASTNode* node) {
     return LLVMBuildCall2(builder, printf_type, printf_func, args, num_args, "printf_call");
 }
 
+// print sobre el buffer de salida: una llamada especializada por tipo
+LLVMValueRef buffered_print_function(LLVM_Visitor* v, ASTNode* node) {
+    if (node->data.func_node.arg_count == 0) {
+        return build_print_newline();
+    }
+
+    ASTNode* arg_node = node->data.func_node.args[0];
+    LLVMValueRef arg = accept_gen(v, arg_node);
+    if (!arg) return NULL;
+
+    if (type_equals(arg_node->return_type, &TYPE_NUMBER)) {
+        return build_print_number(arg);
+    } else if (type_equals(arg_node->return_type, &TYPE_BOOLEAN)) {
+        return build_print_boolean(arg);
+    } else if (type_equals(arg_node->return_type, &TYPE_STRING)) {
+        return build_print_string(arg);
+    }
+
+    return build_print_string(get_string_literal("<unknown>"));
+}
+
+LLVMValueRef flush_function(LLVM_Visitor* v, ASTNode* node) {
+    if (buffered_output) {
+        return build_output_flush();
+    }
+
+    // Sin buffer propio, se vuelcan los buffers de stdio
+    LLVMTypeRef fflush_type = LLVMFunctionType(LLVMInt32Type(),
+        (LLVMTypeRef[]){LLVMPointerType(LLVMInt8Type(), 0)}, 1, 0);
+    LLVMValueRef fflush_func = LLVMGetNamedFunction(module, "fflush");
+    if (!fflush_func) {
+        fflush_func = LLVMAddFunction(module, "fflush", fflush_type);
+    }
+    LLVMValueRef null_stream = LLVMConstNull(LLVMPointerType(LLVMInt8Type(), 0));
+    return LLVMBuildCall2(builder, fflush_type, fflush_func, &null_stream, 1, "fflush_call");
+}
+
 LLVMValueRef log_function(LLVM_Visitor* v, ASTNode* node) {
     // log con 1 o 2 argumentos
     if (node->data.func_node.arg_count == 1) {
@@ -139,7 +243,8 @@ LLVMValueRef basic_functions(
 LLVMValueRef generate_user_function_call(LLVM_Visitor* v, ASTNode* node) {
     const char* name = node->data.func_node.name;
 
-    LLVMValueRef func = LLVMGetNamedFunction(module, name);    
+    Closure* closure = find_closure(name);
+    LLVMValueRef func = closure ? closure->func : LLVMGetNamedFunction(module, name);
     LLVMTypeRef func_type = LLVMGetElementType(LLVMTypeOf(func));
     unsigned param_count = LLVMCountParamTypes(func_type);
 
@@ -149,17 +254,53 @@ LLVMValueRef generate_user_function_call(LLVM_Visitor* v, ASTNode* node) {
 
     // Obtener tipos de los argumentos
     LLVMTypeRef* arg_types = malloc(arg_count * sizeof(LLVMTypeRef));
-    LLVMValueRef* arg_values = malloc(arg_count * sizeof(LLVMValueRef));
+    LLVMValueRef* arg_values = malloc((arg_count + 1) * sizeof(LLVMValueRef));
     
+    LLVMTypeRef* param_types = malloc(param_count * sizeof(LLVMTypeRef));
+    LLVMGetParamTypes(func_type, param_types);
+
     for (int i = 0; i < arg_count; i++) {
         arg_types[i] = get_llvm_type(args[i]->return_type);
         arg_values[i] = accept_gen(v, args[i]);
+
+        // Un valor que llega a un parámetro Object (la versión genérica de una
+        // función especializada) se etiqueta. Las variables de tipos definidos
+        // por el usuario llegan como T**: se pasa la instancia. Una instancia
+        // de un tipo hijo empieza como la del padre: se pasa con un bitcast
+        LLVMTypeRef value_type = LLVMTypeOf(arg_values[i]);
+        if (i < param_count && param_types[i] == LLVMPointerType(object_type, 0)) {
+            arg_values[i] = box_value(arg_values[i]);
+        } else if (i < param_count && value_type != param_types[i] &&
+            LLVMGetTypeKind(value_type) == LLVMPointerTypeKind &&
+            LLVMGetTypeKind(LLVMGetElementType(value_type)) == LLVMPointerTypeKind) {
+            arg_values[i] = LLVMBuildLoad2(builder, LLVMGetElementType(value_type), arg_values[i], "instance");
+            value_type = LLVMTypeOf(arg_values[i]);
+        }
+        if (i < param_count && value_type != param_types[i] &&
+            LLVMGetTypeKind(value_type) == LLVMPointerTypeKind &&
+            LLVMGetTypeKind(LLVMGetElementType(value_type)) == LLVMStructTypeKind &&
+            LLVMGetTypeKind(param_types[i]) == LLVMPointerTypeKind) {
+            arg_values[i] = LLVMBuildBitCast(builder, arg_values[i], param_types[i], "as_parent");
+        }
+    }
+    free(param_types);
+
+    if (closure) {
+        // La clausura recibe su entorno como último argumento
+        arg_values[arg_count++] = closure->env;
     }
     
     if (!func) {
         func = LLVMAddFunction(module, name, func_type);
     }
 
+    if (node->flags & FLAG_TAIL_CALL) {
+        LLVMValueRef result = build_tail_call(func, arg_values, arg_count, return_type);
+        free(arg_types);
+        free(arg_values);
+        return result;
+    }
+
     char* calltmp = type_equals(return_type, &TYPE_VOID) ? "" : "calltmp";
 
     // Construir llamada
@@ -9,9 +9,15 @@
 LLVMValueRef generate_builtin_function(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef print_function(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef log_function(LLVM_Visitor* v, ASTNode* node);
+LLVMValueRef buffered_print_function(LLVM_Visitor* v, ASTNode* node);
+LLVMValueRef flush_function(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef rand_function(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef basic_functions(LLVM_Visitor* v, ASTNode* node, const char* name, const char* tmp_name);
 LLVMValueRef generate_user_function_call(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef generate_function_body(LLVM_Visitor* v, ASTNode* node);
 
+// Llamada marcada con FLAG_TAIL_CALL: salto al inicio del cuerpo si es a la
+// función actual, o llamada 'tail' seguida del retorno si no
+LLVMValueRef build_tail_call(LLVMValueRef func, LLVMValueRef* args, int arg_count, Type* return_type);
+
 #endif // LLVM_BUILTINS_H
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "llvm_closure.h"
+#include "llvm_core.h"
+#include "llvm_codegen.h"
+#include "llvm_gc.h"
+#include "../scope/llvm_scope.h"
+#include "../optimization/optimization.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Clausuras visibles, la más interna primero
+static Closure* closures = NULL;
+
+static void push_closure(Closure* closure) {
+    closure->next = closures;
+    closures = closure;
+}
+
+Closure* find_closure(const char* name) {
+    for (Closure* closure = closures; closure; closure = closure->next) {
+        if (!strcmp(closure->dec->data.func_node.name, name)) {
+            return closure;
+        }
+    }
+    return NULL;
+}
+
+Closure* find_closure_dec(ASTNode* dec) {
+    for (Closure* closure = closures; closure; closure = closure->next) {
+        if (closure->dec == dec) {
+            return closure;
+        }
+    }
+    return NULL;
+}
+
+void release_closures(int count) {
+    while (count-- > 0 && closures) {
+        Closure* closure = closures;
+        closures = closure->next;
+        if (closure->owner) {
+            free(closure->captures);
+            free(closure->callees);
+        }
+        free(closure);
+    }
+}
+
+static void add_capture(Closure* closure, const char* name) {
+    for (int i = 0; i < closure->capture_count; i++) {
+        if (!strcmp(closure->captures[i], name)) {
+            return;
+        }
+    }
+    closure->captures = realloc(closure->captures, sizeof(char*) * (closure->capture_count + 1));
+    closure->captures[closure->capture_count++] = (char*)name;
+}
+
+static void add_callee(Closure* closure, Closure* callee) {
+    for (int i = 0; i < closure->callee_count; i++) {
+        if (closure->callees[i]->dec == callee->dec) {
+            return;
+        }
+    }
+    closure->callees = realloc(closure->callees, sizeof(Closure*) * (closure->callee_count + 1));
+    closure->callees[closure->callee_count++] = callee;
+}
+
+// Recoge las variables de fuera que usa el cuerpo (incluidas las que usan
+// las funciones anidadas en él, que las capturan a través de esta) y las
+// clausuras a las que llama. Un nombre que además es un parámetro o una
+// variable local se captura igual: la declaración interna lo oculta
+static void collect_captures(ASTNode* node, Closure* closure) {
+    if (!node) {
+        return;
+    }
+
+    const char* name = NULL;
+    if (node->type == NODE_VARIABLE) {
+        name = node->data.variable_name;
+    } else if (node->type == NODE_D_ASSIGNMENT) {
+        name = node->data.op_node.left->data.variable_name;
+    }
+    if (name && lookup_variable(name)) {
+        add_capture(closure, name);
+    }
+
+    if (node->type == NODE_FUNC_CALL) {
+        Closure* callee = find_closure(node->data.func_node.name);
+        // una llamada a sí misma usa el entorno que recibe
+        if (callee && callee->dec != closure->dec) {
+            add_callee(closure, callee);
+        }
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        collect_captures(children[i], closure);
+    }
+
+    free(children);
+}
+
+static void build_environment_type(Closure* closure) {
+    int field_count = closure->capture_count + closure->callee_count;
+    LLVMTypeRef* fields = malloc(sizeof(LLVMTypeRef) * (field_count > 0 ? field_count : 1));
+
+    for (int i = 0; i < closure->capture_count; i++) {
+        fields[i] = LLVMTypeOf(lookup_variable(closure->captures[i]));
+    }
+    for (int i = 0; i < closure->callee_count; i++) {
+        fields[closure->capture_count + i] = LLVMPointerType(closure->callees[i]->env_type, 0);
+    }
+
+    LLVMStructSetBody(closure->env_type, fields, field_count, 0);
+    free(fields);
+}
+
+static void fill_environment(Closure* closure) {
+    for (int i = 0; i < closure->capture_count; i++) {
+        LLVMValueRef field = LLVMBuildStructGEP2(builder, closure->env_type, closure->env, i, "capture");
+        LLVMBuildStore(builder, lookup_variable(closure->captures[i]), field);
+    }
+    for (int i = 0; i < closure->callee_count; i++) {
+        LLVMValueRef field = LLVMBuildStructGEP2(builder, closure->env_type, closure->env,
+            closure->capture_count + i, "callee_env");
+        LLVMBuildStore(builder, closure->callees[i]->env, field);
+    }
+}
+
+int declare_closures(LLVM_Visitor* v, ASTNode* block) {
+    int count = 0;
+    Closure** declared = malloc(sizeof(Closure*) * (block->data.program_node.count + 1));
+
+    // Primero se hacen visibles todas, así las que se llaman entre sí
+    // encuentran el tipo del entorno de las demás
+    for (int i = 0; i < block->data.program_node.count; i++) {
+        ASTNode* stmt = block->data.program_node.statements[i];
+        if (stmt->type != NODE_FUNC_DEC) {
+            continue;
+        }
+
+        Closure* closure = calloc(1, sizeof(Closure));
+        char env_name[256];
+        snprintf(env_name, sizeof(env_name), "%s.env", stmt->data.func_node.name);
+        closure->dec = stmt;
+        closure->env_type = LLVMStructCreateNamed(context, env_name);
+        closure->owner = 1;
+        push_closure(closure);
+        declared[count++] = closure;
+    }
+
+    for (int i = 0; i < count; i++) {
+        collect_captures(declared[i]->dec->data.func_node.body, declared[i]);
+        build_environment_type(declared[i]);
+        declared[i]->func = make_function_dec(v, declared[i]->dec);
+        declared[i]->env = build_variable_slot(declared[i]->env_type, "env");
+    }
+
+    // Los entornos se llenan al entrar al bloque, antes de cualquier llamada
+    for (int i = 0; i < count; i++) {
+        fill_environment(declared[i]);
+    }
+
+    LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
+    for (int i = 0; i < count; i++) {
+        accept_gen(v, declared[i]->dec);
+    }
+    if (count > 0) {
+        LLVMPositionBuilderAtEnd(builder, current_block);
+    }
+
+    free(declared);
+    return count;
+}
+
+int bind_closure_environment(Closure* closure) {
+    LLVMValueRef env = LLVMGetLastParam(closure->func);
+
+    for (int i = 0; i < closure->capture_count; i++) {
+        LLVMValueRef field = LLVMBuildStructGEP2(builder, closure->env_type, env, i, "capture");
+        LLVMTypeRef field_type = LLVMStructGetTypeAtIndex(closure->env_type, i);
+        LLVMValueRef address = LLVMBuildLoad2(builder, field_type, field, closure->captures[i]);
+        declare_variable(closure->captures[i], address);
+    }
+
+    // Las clausuras a las que llama (y ella misma) se ven con el entorno que
+    // llega en el parámetro
+    int count = 0;
+    for (int i = 0; i < closure->callee_count; i++) {
+        unsigned index = closure->capture_count + i;
+        LLVMValueRef field = LLVMBuildStructGEP2(builder, closure->env_type, env, index, "callee_env");
+        Closure* callee = malloc(sizeof(Closure));
+        *callee = *closure->callees[i];
+        callee->owner = 0;
+        callee->env = LLVMBuildLoad2(builder, LLVMStructGetTypeAtIndex(closure->env_type, index), field, "env");
+        push_closure(callee);
+        count++;
+    }
+
+    Closure* self = malloc(sizeof(Closure));
+    *self = *closure;
+    self->owner = 0;
+    self->env = env;
+    push_closure(self);
+    return count + 1;
+}
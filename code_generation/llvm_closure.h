@@ -0,0 +1,46 @@
+#ifndef LLVM_CLOSURE_H
+#define LLVM_CLOSURE_H
+
+#include <llvm-c/Core.h>
+#include "../ast/ast.h"
+#include "../visitor/llvm_visitor.h"
+
+// Función declarada dentro de un bloque (FLAG_CLOSURE). Se genera como una
+// función global con un parámetro más al final: un puntero a su entorno,
+// un struct con la dirección de cada variable que captura y el entorno de
+// cada función anidada a la que llama. Las funciones no son valores en
+// HULK, así que una clausura nunca sale del bloque que la declara y su
+// entorno vive en la pila de la función que contiene ese bloque
+typedef struct Closure {
+    ASTNode* dec;
+    LLVMValueRef func;
+    LLVMTypeRef env_type;
+    LLVMValueRef env;           // entorno visible desde la función actual
+    char** captures;            // variables capturadas (campos 0..n-1)
+    int capture_count;
+    struct Closure** callees;   // clausuras a las que llama (campos n..)
+    int callee_count;
+    int owner;                  // si el registro es dueño de los arreglos
+    struct Closure* next;
+} Closure;
+
+// Clausura visible con ese nombre, o NULL si no hay ninguna
+Closure* find_closure(const char* name);
+
+// Clausura visible cuya declaración es 'dec', o NULL
+Closure* find_closure_dec(ASTNode* dec);
+
+// Genera las funciones declaradas en las sentencias de un bloque: sus
+// entornos quedan en la pila de la función actual y sus nombres visibles
+// hasta release_closures. Devuelve cuántas declaró
+int declare_closures(LLVM_Visitor* v, ASTNode* block);
+
+// Deja de ver las últimas 'count' clausuras declaradas o enlazadas
+void release_closures(int count);
+
+// Dentro del cuerpo de una clausura: declara sus variables capturadas (a
+// partir de las direcciones guardadas en el entorno) y las clausuras a las
+// que llama con sus entornos. Devuelve cuántas clausuras enlazó
+int bind_closure_environment(Closure* closure);
+
+#endif // LLVM_CLOSURE_H
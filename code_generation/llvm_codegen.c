@@ -4,39 +4,146 @@
 #include "llvm_operators.h"
 #include "llvm_string.h"
 #include "llvm_builtins.h"
+#include "llvm_gc.h"
+#include "llvm_slab.h"
+#include "llvm_stack_guard.h"
+#include "llvm_memo.h"
+#include "llvm_tagged.h"
+#include "llvm_closure.h"
+#include "llvm_errors.h"
 #include "../type/type.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
 // Funciones helper para el mapeo de tipos
-static int get_type_id(const char* type_name) {
+static TypeIDMap* find_type_id(const char* type_name) {
     TypeIDMap* curr = type_id_map;
     while (curr) {
         if (strcmp(curr->type_name, type_name) == 0) {
-            return curr->id;
+            return curr;
         }
         curr = curr->next;
     }
-    return -1;
+    return NULL;
 }
 
-static void register_type_id(const char* type_name, int id) {
+static void register_type_id(const char* type_name, int id, int last_descendant) {
     TypeIDMap* new_entry = (TypeIDMap*)malloc(sizeof(TypeIDMap));
     new_entry->type_name = strdup(type_name);
     new_entry->id = id;
+    new_entry->last_descendant = last_descendant;
     new_entry->next = type_id_map;
     type_id_map = new_entry;
     printf("Debug: Registered type %s with ID %d\n", type_name, id);
 }
 
+// Numera en preorden los tipos que heredan de 'type_dec': sus ids quedan
+// en el intervalo [id, último descendiente]
+static int number_type_subtree(ASTNode* program, ASTNode* type_dec, int id) {
+    type_dec->data.type_node.id = id;
+    int last = id;
+    for (int i = 0; i < program->data.program_node.count; i++) {
+        ASTNode* stmt = program->data.program_node.statements[i];
+        if (stmt->type == NODE_TYPE_DEC &&
+            !strcmp(stmt->data.type_node.parent_name, type_dec->data.type_node.name)) {
+            last = number_type_subtree(program, stmt, last + 1);
+        }
+    }
+    register_type_id(type_dec->data.type_node.name, id, last);
+    return last;
+}
+
+static int declares_type(ASTNode* program, const char* name) {
+    for (int i = 0; i < program->data.program_node.count; i++) {
+        ASTNode* stmt = program->data.program_node.statements[i];
+        if (stmt->type == NODE_TYPE_DEC && !strcmp(stmt->data.type_node.name, name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Asigna los ids de todos los tipos antes de generarlos: un tipo y sus
+// descendientes ocupan un intervalo, así 'is' y 'as' sobre una instancia
+// son una sola comparación con el id guardado en su vtable
+static void number_types(ASTNode* program) {
+    if (!program || program->type != NODE_PROGRAM) {
+        return;
+    }
+
+    for (int i = 0; i < program->data.program_node.count; i++) {
+        ASTNode* stmt = program->data.program_node.statements[i];
+        if (stmt->type == NODE_TYPE_DEC && !declares_type(program, stmt->data.type_node.parent_name)) {
+            next_type_id = number_type_subtree(program, stmt, next_type_id) + 1;
+        }
+    }
+}
+
+static void declare_types(ASTNode* program);
+static int find_field_index(Type* type, const char* field_name);
+static LLVMValueRef coerce_argument(LLVMValueRef value, LLVMTypeRef param_type);
+
+// { i32 id, i32 último descendiente, i8* nombre }: primer campo de toda
+// vtable, al que se llega desde cualquier instancia por su cabecera
+static LLVMTypeRef get_type_info_type(void) {
+    LLVMTypeRef info_type = LLVMGetTypeByName(module, "TypeInfo");
+    if (!info_type) {
+        info_type = LLVMStructCreateNamed(context, "TypeInfo");
+        LLVMTypeRef fields[] = {
+            LLVMInt32Type(), LLVMInt32Type(), LLVMPointerType(LLVMInt8Type(), 0)
+        };
+        LLVMStructSetBody(info_type, fields, 3, 0);
+    }
+    return info_type;
+}
+
+static LLVMValueRef get_dynamic_type_info(LLVMValueRef instance) {
+    // The vtable pointer is the whole header and TypeInfo starts the vtable
+    LLVMTypeRef info_ptr = LLVMPointerType(get_type_info_type(), 0);
+    LLVMValueRef header = LLVMBuildBitCast(builder, instance, LLVMPointerType(info_ptr, 0), "header");
+    return LLVMBuildLoad2(builder, info_ptr, header, "type_info");
+}
+
 static LLVMValueRef get_dynamic_type_id(LLVMValueRef instance) {
-    // Load type ID from instance (first field, index 0)
-    LLVMValueRef id_ptr = LLVMBuildStructGEP2(builder, LLVMGetElementType(LLVMTypeOf(instance)), 
-                                             instance, 0, "type_id_ptr");
+    LLVMValueRef id_ptr = LLVMBuildStructGEP2(builder, get_type_info_type(),
+                                             get_dynamic_type_info(instance), 0, "type_id_ptr");
     return LLVMBuildLoad2(builder, LLVMInt32Type(), id_ptr, "type_id");
 }
 
+LLVMValueRef build_instance_type_test(LLVMValueRef instance, Type* type) {
+    TypeIDMap* bounds = find_type_id(type->name);
+    if (!bounds) {
+        return LLVMConstInt(LLVMInt1Type(), 0, 0);
+    }
+    if (LLVMGetTypeKind(LLVMGetElementType(LLVMTypeOf(instance))) == LLVMPointerTypeKind) {
+        instance = LLVMBuildLoad2(builder, LLVMGetElementType(LLVMTypeOf(instance)), instance, "instance");
+    }
+
+    // Una instancia nula no es de ningún tipo
+    LLVMBasicBlockRef entry_block = LLVMGetInsertBlock(builder);
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(entry_block);
+    LLVMBasicBlockRef load_block = LLVMAppendBasicBlock(current_function, "type_test.load");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(current_function, "type_test.done");
+    LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, instance, "is_null"), done_block, load_block);
+
+    // id - primero <= último - primero, sin signo
+    LLVMPositionBuilderAtEnd(builder, load_block);
+    LLVMValueRef offset = LLVMBuildSub(builder, get_dynamic_type_id(instance),
+        LLVMConstInt(LLVMInt32Type(), bounds->id, 0), "type_offset");
+    LLVMValueRef in_range = LLVMBuildICmp(builder, LLVMIntULE, offset,
+        LLVMConstInt(LLVMInt32Type(), bounds->last_descendant - bounds->id, 0), "in_range");
+    LLVMBuildBr(builder, done_block);
+    load_block = LLVMGetInsertBlock(builder);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMValueRef result = LLVMBuildPhi(builder, LLVMInt1Type(), "is_type");
+    LLVMValueRef values[] = { LLVMConstInt(LLVMInt1Type(), 0, 0), in_range };
+    LLVMBasicBlockRef blocks[] = { entry_block, load_block };
+    LLVMAddIncoming(result, values, blocks, 2);
+    return result;
+}
+
 LLVMTypeRef get_llvm_type(Type* type) {
     if (type->sub_type) {
         return get_llvm_type(type->sub_type);
@@ -56,8 +163,9 @@ LLVMTypeRef get_llvm_type(Type* type) {
         // Es un tipo personalizado
         LLVMTypeRef struct_type = LLVMGetTypeByName(module, type->name);
         if (!struct_type) {
-            fprintf(stderr, "Error: Tipo %s no encontrado\n", type->name);
-            exit(1);
+            // Las funciones globales se declaran antes que los tipos: se
+            // deja una declaración adelantada que completa generate_type_declaration
+            struct_type = LLVMStructCreateNamed(context, type->name);
         }
         // Retornamos un puntero al tipo estructurado
         return LLVMPointerType(struct_type, 0);
@@ -80,7 +188,9 @@ LLVMValueRef get_default(LLVM_Visitor* v, Type* type) {
         return generate_boolean(v, create_boolean_node("false"));
     } else if (type_equals(type, &TYPE_VOID)) {
         return generate_block(v, create_program_node(NULL, 0, NODE_BLOCK));
-    } else if (type_equals(type, &TYPE_OBJECT) || type_equals(type, &TYPE_NULL)) {
+    } else if (type_equals(type, &TYPE_OBJECT)) {
+        return build_tagged_null();
+    } else if (type_equals(type, &TYPE_NULL)) {
         // Usamos LLVMConstNull para retornar un puntero nulo del tipo object
         return LLVMConstNull(LLVMPointerType(object_type, 0));
     } else if (type->dec != NULL) {
@@ -128,8 +238,13 @@ void generate_main_function(ASTNode* ast, const char* filename) {
     
     // Declare external functions
     declare_external_functions();
+    declare_output_runtime();
+    declare_gc_runtime();
+    declare_stack_guard_runtime();
     
     // Process function and type declarations
+    number_types(ast);
+    declare_types(ast);
     find_function_dec(&visitor, ast);
     make_body_function_dec(&visitor, ast);
     
@@ -139,9 +254,14 @@ void generate_main_function(ASTNode* ast, const char* filename) {
     LLVMTypeRef main_type = LLVMFunctionType(LLVMInt32Type(), NULL, 0, 0);
     LLVMValueRef main_func = LLVMAddFunction(module, "main", main_type);
     
-    // Create entry block
+    // Create entry block (variables live there) and the body block
     LLVMBasicBlockRef entry = LLVMAppendBasicBlock(main_func, "entry");
     LLVMPositionBuilderAtEnd(builder, entry);
+    GCFrame enclosing = gc_begin_frame(entry);
+    LLVMBasicBlockRef body = LLVMAppendBasicBlock(main_func, "main_body");
+    LLVMBuildBr(builder, body);
+    LLVMPositionBuilderAtEnd(builder, body);
+    build_stack_guard_install();
 
     // Generate code for AST
     if (ast) {
@@ -152,8 +272,14 @@ void generate_main_function(ASTNode* ast, const char* filename) {
     LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
     if (!LLVMGetBasicBlockTerminator(current_block)) {
         // Return 0 from main if the block isn't already terminated
+        build_output_flush();
+        if (gc_statistics) {
+            build_gc_report();
+        }
+        gc_end_frame(enclosing, NULL);
         LLVMBuildRet(builder, LLVMConstInt(LLVMInt32Type(), 0, 0));
     }
+    finalize_runtime_errors();
     
     // Write to file
     char* error = NULL;
@@ -188,7 +314,7 @@ LLVMValueRef generate_number(LLVM_Visitor* v,ASTNode* node) {
 
 LLVMValueRef generate_string(LLVM_Visitor* v,ASTNode* node) {
     char* processed = process_string_escapes(node->data.string_value);
-    LLVMValueRef str = LLVMBuildGlobalStringPtr(builder, processed, "str");
+    LLVMValueRef str = get_string_literal(processed);
     free(processed);
     return str;
 }
@@ -200,6 +326,7 @@ LLVMValueRef generate_boolean(LLVM_Visitor* v,ASTNode* node) {
 
 LLVMValueRef generate_block(LLVM_Visitor* v,ASTNode* node) {
     push_scope();
+    int closure_count = declare_closures(v, node);
     LLVMValueRef last_val = NULL;
     for (int i = 0; i < node->data.program_node.count; i++) {
         ASTNode* stmt = node->data.program_node.statements[i];
@@ -207,16 +334,16 @@ LLVMValueRef generate_block(LLVM_Visitor* v,ASTNode* node) {
             last_val= accept_gen(v, stmt);
         }
     }
-    if (last_val)
-    {
-        pop_scope();
-    }
+    release_closures(closure_count);
+    pop_scope();
     return last_val ;
 }
 
 LLVMValueRef generate_assignment(LLVM_Visitor* v, ASTNode* node) {
     const char* var_name = node->data.op_node.left->data.variable_name;
-    LLVMValueRef value = accept_gen(v, node->data.op_node.right);
+    LLVMValueRef value = node->flags & FLAG_IN_PLACE_APPEND ?
+        generate_in_place_concatenation(v, node->data.op_node.right) :
+        accept_gen(v, node->data.op_node.right);
     
     LLVMTypeRef new_type;
     if (type_equals(node->data.op_node.right->return_type, &TYPE_STRING)) {
@@ -227,30 +354,39 @@ LLVMValueRef generate_assignment(LLVM_Visitor* v, ASTNode* node) {
         new_type = LLVMDoubleType();
     }
 
-    LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
-    LLVMBasicBlockRef entry_block = LLVMGetEntryBasicBlock(LLVMGetBasicBlockParent(current_block));
-    LLVMPositionBuilderAtEnd(builder, entry_block);
-
     LLVMValueRef existing_alloca = lookup_variable(var_name);
     LLVMValueRef alloca;
 
+    if (existing_alloca && node->type == NODE_D_ASSIGNMENT &&
+        LLVMGetElementType(LLVMTypeOf(existing_alloca)) == LLVMInt64Type()) {
+        // Variable entera: el análisis de rangos garantiza que el valor
+        // asignado también lo es
+        LLVMValueRef int_value = generate_integer(v, node->data.op_node.right);
+        LLVMBuildStore(builder, int_value, existing_alloca);
+        return LLVMBuildSIToFP(builder, int_value, LLVMDoubleType(), "to_double");
+    }
+
     if (existing_alloca) {
         if (node->type == NODE_D_ASSIGNMENT) {
             update_variable(var_name, existing_alloca);
         }
         LLVMTypeRef existing_type = LLVMGetElementType(LLVMTypeOf(existing_alloca));
+        if (existing_type == LLVMPointerType(object_type, 0)) {
+            // Variable Object: guarda el valor etiquetado
+            LLVMBuildStore(builder, box_value(value), existing_alloca);
+            return node->type == NODE_D_ASSIGNMENT ? value : NULL;
+        }
         if (existing_type != LLVMTypeOf(value)) {
-            alloca = LLVMBuildAlloca(builder, new_type, var_name);
+            alloca = build_variable_slot(new_type, var_name);
             update_variable(var_name, alloca);
         } else {
             alloca = existing_alloca;
         }
     } else {
-        alloca = LLVMBuildAlloca(builder, new_type, var_name);
+        alloca = build_variable_slot(new_type, var_name);
         declare_variable(var_name, alloca);
     }
 
-    LLVMPositionBuilderAtEnd(builder, current_block);
     LLVMBuildStore(builder, value, alloca);
     
     if (node->type == NODE_D_ASSIGNMENT) {
@@ -259,7 +395,42 @@ LLVMValueRef generate_assignment(LLVM_Visitor* v, ASTNode* node) {
     return NULL;
 }
 
+// Enlaza 'name' a 'value'. Una variable que nunca se reasigna
+// (FLAG_IMMUTABLE) se enlaza al valor mismo, sin slot, salvo los punteros
+// con --gc: el recolector solo ve las raíces que están en slots. Devuelve
+// el slot, o NULL si no hizo falta
+static LLVMValueRef bind_variable(ASTNode* binding, const char* name, LLVMValueRef value, LLVMTypeRef slot_type) {
+    int root = garbage_collection && LLVMGetTypeKind(LLVMTypeOf(value)) == LLVMPointerTypeKind;
+    if ((binding->flags & FLAG_IMMUTABLE) && !root) {
+        declare_value(name, value);
+        return NULL;
+    }
+
+    LLVMValueRef slot = build_variable_slot(slot_type, name);
+    LLVMBuildStore(builder, value, slot);
+    declare_variable(name, slot);
+    return slot;
+}
+
+// Valor de una variable tal como lo usa la expresión
+static LLVMValueRef variable_value(ASTNode* node, LLVMValueRef value) {
+    if (LLVMTypeOf(value) == LLVMInt64Type()) {
+        // Variable Number guardada como entero
+        return LLVMBuildSIToFP(builder, value, LLVMDoubleType(), "to_double");
+    }
+    if (node->return_type && type_equals(node->return_type, &TYPE_OBJECT)) {
+        // Parámetro de una función especializada que se usa como Object
+        return box_value(value);
+    }
+    return value;
+}
+
 LLVMValueRef generate_variable(LLVM_Visitor* v, ASTNode* node) {
+    LLVMValueRef bound_value = lookup_value(node->data.variable_name);
+    if (bound_value) {
+        return variable_value(node, bound_value);
+    }
+
     LLVMValueRef alloca = lookup_variable(node->data.variable_name);
     if (!alloca) {
         fprintf(stderr, "Error: Variable '%s' no declarada\n", node->data.variable_name);
@@ -271,64 +442,62 @@ LLVMValueRef generate_variable(LLVM_Visitor* v, ASTNode* node) {
     }
     else {
         LLVMTypeRef var_type = LLVMGetElementType(LLVMTypeOf(alloca));
-        return LLVMBuildLoad2(builder, var_type, alloca, "load");
+        LLVMValueRef value = LLVMBuildLoad2(builder, var_type, alloca, "load");
+        return variable_value(node, value);
     }
 }
 
+// Solo las funciones globales: las declaradas dentro de un bloque son
+// clausuras y las genera el bloque (ver llvm_closure.h)
 void find_function_dec(LLVM_Visitor* visitor, ASTNode* node) {
-    if (!node) return;
+    if (!node || node->type != NODE_PROGRAM) return;
 
-    if (node->type == NODE_FUNC_DEC) {
-        make_function_dec(visitor, node);
-        find_function_dec(visitor, node->data.func_node.body);
-        return;
-    }
-    
-    switch (node->type) {
-        case NODE_PROGRAM:
-        case NODE_BLOCK:
-            for (int i = 0; i < node->data.program_node.count; i++) {
-                find_function_dec(visitor, node->data.program_node.statements[i]);
-            }
-            break;
-        
-        case NODE_LET_IN:
-            for (int i = 0; i < node->data.func_node.arg_count; i++) {
-                if (node->data.func_node.args[i]->type == NODE_ASSIGNMENT) {
-                    find_function_dec(visitor, node->data.func_node.args[i]->data.op_node.right);
-                }
-            }
-            find_function_dec(visitor, node->data.func_node.body);
-            break;
+    for (int i = 0; i < node->data.program_node.count; i++) {
+        ASTNode* stmt = node->data.program_node.statements[i];
+        if (stmt->type == NODE_FUNC_DEC) {
+            make_function_dec(visitor, stmt);
+        }
     }
 }
 
 void make_body_function_dec(LLVM_Visitor* visitor, ASTNode* node) {
-    if (!node) return;
+    if (!node || node->type != NODE_PROGRAM) return;
+
+    for (int i = 0; i < node->data.program_node.count; i++) {
+        ASTNode* stmt = node->data.program_node.statements[i];
+        if (stmt->type == NODE_FUNC_DEC) {
+            accept_gen(visitor, stmt);
+        }
+    }
+}
+
+static int is_memoized(ASTNode* node) {
+    return memoize && (node->flags & FLAG_MEMOIZABLE);
+}
 
-    if (node->type == NODE_FUNC_DEC) {
-        accept_gen(visitor, node);
-        make_body_function_dec(visitor, node->data.func_node.body);
+// Traduce los efectos inferidos a atributos de LLVM. En modo --gc cada
+// cuerpo actualiza la pila de raíces, sin --stack-guard los que alcanzan
+// una función recursiva actualizan el contador de profundidad y las
+// funciones memoizadas escriben su tabla, así que en esos casos solo se
+// marca nounwind (HULK no tiene excepciones)
+static void add_effect_attributes(LLVMValueRef func, ASTNode* node) {
+    add_function_attribute(func, "nounwind");
+
+    int counted = !stack_guard && (node->flags & FLAG_DEPTH_COUNTED);
+    if (garbage_collection || counted || is_memoized(node)) {
         return;
     }
 
-    switch (node->type) {
-        case NODE_PROGRAM:
-        case NODE_BLOCK:
-            for (int i = 0; i < node->data.program_node.count; i++) {
-                make_body_function_dec(visitor, node->data.program_node.statements[i]);
-            }
-            break;
-        
-        case NODE_LET_IN:
-            for (int i = 0; i < node->data.func_node.arg_count; i++) {
-                if (node->data.func_node.args[i]->type == NODE_ASSIGNMENT) {
-                    make_body_function_dec(visitor, node->data.func_node.args[i]->data.op_node.right);
-                }
-            }
+    if (node->flags & FLAG_PURE) {
+        add_function_attribute(func, "readnone");
+    } else if (node->flags & FLAG_READ_ONLY) {
+        add_function_attribute(func, "readonly");
+    } else {
+        return;
+    }
 
-            make_body_function_dec(visitor, node->data.func_node.body);
-            break;
+    if (node->flags & FLAG_WILL_RETURN) {
+        add_function_attribute(func, "willreturn");
     }
 }
 
@@ -337,25 +506,89 @@ LLVMValueRef make_function_dec(LLVM_Visitor* v, ASTNode* node) {
     Type* return_type = node->data.func_node.body->return_type;
     ASTNode** params = node->data.func_node.args;
     int param_count = node->data.func_node.arg_count;
+    Closure* closure = find_closure_dec(node);
 
     // Obtener tipos de parámetros
-    LLVMTypeRef* param_types = malloc(param_count * sizeof(LLVMTypeRef));
+    LLVMTypeRef* param_types = malloc((param_count + 1) * sizeof(LLVMTypeRef));
     for (int i = 0; i < param_count; i++) {
         param_types[i] = get_llvm_type(params[i]->return_type);
     }
+    if (closure) {
+        // Una clausura recibe además el puntero a su entorno
+        param_types[param_count] = LLVMPointerType(closure->env_type, 0);
+    }
 
     LLVMTypeRef func_type = LLVMFunctionType(
         get_llvm_type(return_type),
         param_types,
-        param_count,
+        param_count + (closure != NULL),
         0
     );
     
     LLVMValueRef func = LLVMAddFunction(module, name, func_type);
+    if (node->flags & FLAG_INLINE) {
+        // Función pequeña y no recursiva: LLVM la inlinea en cada llamada
+        add_function_attribute(func, "alwaysinline");
+    }
+    add_effect_attributes(func, node);
     free(param_types);
     return func;
 }
 
+// Función global cuyo cuerpo se está generando. Las llamadas a ella misma
+// en posición de cola guardan los argumentos en sus parámetros y saltan a
+// 'loop', el inicio del cuerpo (ya con la profundidad incrementada)
+typedef struct TailFunction {
+    LLVMValueRef func;
+    LLVMBasicBlockRef loop;
+    LLVMValueRef* params;
+    int param_count;    // sin el entorno de una clausura, que no cambia
+    int counted;    // si la función incrementa la profundidad de la pila
+} TailFunction;
+
+static TailFunction tail_function;
+
+LLVMValueRef build_tail_call(LLVMValueRef func, LLVMValueRef* args, int arg_count, Type* return_type) {
+    int is_void = type_equals(return_type, &TYPE_VOID);
+
+    if (!tail_function.func) {
+        return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)),
+            func, args, arg_count, is_void ? "" : "calltmp");
+    }
+
+    if (func == tail_function.func) {
+        for (int i = 0; i < tail_function.param_count; i++) {
+            LLVMBuildStore(builder, args[i], tail_function.params[i]);
+        }
+        gc_safepoint();
+        LLVMBuildBr(builder, tail_function.loop);
+    } else {
+        // Se cierra el marco antes de llamar, así la llamada es lo último
+        // que hace la función y el backend la convierte en un salto
+        if (tail_function.counted) {
+            LLVMTypeRef int32_type = LLVMInt32Type();
+            LLVMValueRef depth = LLVMBuildLoad2(builder, int32_type, current_stack_depth_var, "load_depth_tail");
+            LLVMValueRef dec_depth = LLVMBuildSub(builder, depth, LLVMConstInt(int32_type, 1, 0), "dec_depth_tail");
+            LLVMBuildStore(builder, dec_depth, current_stack_depth_var);
+        }
+        gc_release_frame();
+
+        LLVMValueRef call = LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)),
+            func, args, arg_count, is_void ? "" : "tailcall");
+        LLVMSetTailCall(call, 1);
+        if (is_void) {
+            LLVMBuildRetVoid(builder);
+        } else {
+            LLVMBuildRet(builder, call);
+        }
+    }
+
+    // El resto de la expresión que contenía la llamada nunca se ejecuta
+    LLVMBasicBlockRef after = LLVMAppendBasicBlock(tail_function.func, "after_tail_call");
+    LLVMPositionBuilderAtEnd(builder, after);
+    return is_void ? NULL : LLVMGetUndef(get_llvm_type(return_type));
+}
+
 LLVMValueRef generate_function_body(LLVM_Visitor* v, ASTNode* node) {
     const char* name = node->data.func_node.name;
     Type* return_type = node->data.func_node.body->return_type;
@@ -368,49 +601,80 @@ LLVMValueRef generate_function_body(LLVM_Visitor* v, ASTNode* node) {
         param_types[i] = get_llvm_type(params[i]->return_type);
     }
 
-    LLVMValueRef func = LLVMGetNamedFunction(module, name);
+    Closure* closure = find_closure_dec(node);
+    LLVMValueRef func = closure ? closure->func : LLVMGetNamedFunction(module, name);
     LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
     LLVMBasicBlockRef exit_block = LLVMAppendBasicBlock(func, "function_exit");
 
     LLVMPositionBuilderAtEnd(builder, entry);
+    GCFrame enclosing = gc_begin_frame(entry);
+
+    // Antes de contar la profundidad: si el resultado ya está en la tabla
+    // se devuelve sin entrar al cuerpo
+    LLVMValueRef memo_entry = is_memoized(node) ? build_memo_lookup(func) : NULL;
     
+    // Las funciones que no forman parte de un ciclo de llamadas no pueden
+    // desbordar la pila por sí mismas, así que no cuentan la profundidad
     LLVMTypeRef int32_type = LLVMInt32Type();
-    LLVMValueRef depth_val = LLVMBuildLoad2(builder, int32_type, current_stack_depth_var, "load_depth");
-    LLVMValueRef new_depth = LLVMBuildAdd(builder, depth_val, LLVMConstInt(int32_type, 1, 0), "inc_depth");
-    LLVMBuildStore(builder, new_depth, current_stack_depth_var);
-    
-    LLVMValueRef cmp = LLVMBuildICmp(builder, LLVMIntSGT, new_depth, 
-                                    LLVMConstInt(LLVMInt32Type(), MAX_STACK_DEPTH, 0), "cmp_overflow");
-    
-    LLVMBasicBlockRef error_block = LLVMAppendBasicBlock(func, "stack_overflow");
+    int counted = !stack_guard && !(node->flags & FLAG_NON_RECURSIVE);
     LLVMBasicBlockRef continue_block = LLVMAppendBasicBlock(func, "func_body");
-    LLVMBuildCondBr(builder, cmp, error_block, continue_block);
-    
-    LLVMPositionBuilderAtEnd(builder, error_block);
-    handle_stack_overflow(
-        builder, module, current_stack_depth_var,
-        node->line, node->data.func_node.name 
-    );
+
+    if (counted) {
+        LLVMValueRef depth_val = LLVMBuildLoad2(builder, int32_type, current_stack_depth_var, "load_depth");
+        LLVMValueRef new_depth = LLVMBuildAdd(builder, depth_val, LLVMConstInt(int32_type, 1, 0), "inc_depth");
+        LLVMBuildStore(builder, new_depth, current_stack_depth_var);
+        
+        LLVMValueRef cmp = LLVMBuildICmp(builder, LLVMIntSGT, new_depth, 
+                                        LLVMConstInt(LLVMInt32Type(), MAX_STACK_DEPTH, 0), "cmp_overflow");
+        
+        LLVMBasicBlockRef error_block = LLVMAppendBasicBlock(func, "stack_overflow");
+        LLVMBuildCondBr(builder, cmp, error_block, continue_block);
+        
+        LLVMPositionBuilderAtEnd(builder, error_block);
+        build_stack_overflow_error(node->data.func_node.name, node->line);
+    } else {
+        LLVMBuildBr(builder, continue_block);
+    }
     
     LLVMPositionBuilderAtEnd(builder, continue_block);
             
     push_scope();
+    int bound_closures = closure ? bind_closure_environment(closure) : 0;
 
+    TailFunction enclosing_tail = tail_function;
+    tail_function.func = func;
+    tail_function.param_count = param_count;
+    tail_function.counted = counted;
+    tail_function.params = malloc(param_count * sizeof(LLVMValueRef));
+
+    // Los parámetros de una función con llamadas en cola siempre tienen slot
     for (int i = 0; i < param_count; i++) {
         LLVMValueRef param = LLVMGetParam(func, i);
-        LLVMValueRef alloca = LLVMBuildAlloca(builder, param_types[i], params[i]->data.variable_name);
-        LLVMBuildStore(builder, param, alloca);
-        declare_variable(params[i]->data.variable_name, alloca);
+        tail_function.params[i] = bind_variable(params[i], params[i]->data.variable_name,
+            param, param_types[i]);
     }
+
+    tail_function.loop = LLVMAppendBasicBlock(func, "tail_loop");
+    LLVMBuildBr(builder, tail_function.loop);
+    LLVMPositionBuilderAtEnd(builder, tail_function.loop);
+
     LLVMValueRef body_val = accept_gen(v, body);
+    free(tail_function.params);
+    tail_function = enclosing_tail;
 
     LLVMBuildBr(builder, exit_block);
 
     LLVMPositionBuilderAtEnd(builder, exit_block);
     
-    LLVMValueRef final_depth = LLVMBuildLoad2(builder, int32_type, current_stack_depth_var, "load_depth_final");
-    LLVMValueRef dec_depth = LLVMBuildSub(builder, final_depth, LLVMConstInt(int32_type, 1, 0), "dec_depth");
-    LLVMBuildStore(builder, dec_depth, current_stack_depth_var);
+    if (counted) {
+        LLVMValueRef final_depth = LLVMBuildLoad2(builder, int32_type, current_stack_depth_var, "load_depth_final");
+        LLVMValueRef dec_depth = LLVMBuildSub(builder, final_depth, LLVMConstInt(int32_type, 1, 0), "dec_depth");
+        LLVMBuildStore(builder, dec_depth, current_stack_depth_var);
+    }
+    if (memo_entry) {
+        build_memo_store(func, memo_entry, body_val);
+    }
+    gc_end_frame(enclosing, type_equals(return_type, &TYPE_VOID) ? NULL : body_val);
     
     // Return value handling
     if (type_equals(return_type, &TYPE_VOID)) {
@@ -423,6 +687,7 @@ LLVMValueRef generate_function_body(LLVM_Visitor* v, ASTNode* node) {
         LLVMBuildRet(builder, LLVMConstReal(LLVMDoubleType(), 0.0));
     }
 
+    release_closures(bound_closures);
     pop_scope();
     free(param_types);
 
@@ -437,6 +702,11 @@ LLVMValueRef generate_let_in(LLVM_Visitor* v, ASTNode* node) {
     for (int i = 0; i < dec_count; i++) {
         ASTNode* decl = declarations[i];
         const char* var_name = decl->data.op_node.left->data.variable_name;
+        if (decl->flags & FLAG_INTEGRAL) {
+            bind_variable(decl, var_name, generate_integer(v, decl->data.op_node.right), LLVMInt64Type());
+            continue;
+        }
+
         LLVMValueRef value = accept_gen(v, decl->data.op_node.right);
         if (!value)
         {
@@ -444,9 +714,20 @@ LLVMValueRef generate_let_in(LLVM_Visitor* v, ASTNode* node) {
         }
 
         LLVMTypeRef var_type = get_llvm_type(decl->data.op_node.right->return_type);
-        LLVMValueRef alloca = LLVMBuildAlloca(builder, var_type, var_name);
-        LLVMBuildStore(builder, value, alloca);
-        declare_variable(var_name, alloca);
+        Type* declared = decl->data.op_node.left->return_type;
+        const char* declared_type = decl->data.op_node.left->static_type;
+        if (declared_type && !strcmp(declared_type, "Object")) {
+            // Variable declarada Object: guarda el valor etiquetado
+            value = box_value(value);
+            var_type = LLVMTypeOf(value);
+        } else if (declared && declared->dec) {
+            // El slot de una instancia es del tipo de la variable (el
+            // declarado, que puede ser un ancestro del valor), y una variable
+            // de un tipo definido por el usuario llega como T**
+            var_type = get_llvm_type(declared);
+            value = coerce_argument(value, var_type);
+        }
+        bind_variable(decl, var_name, value, var_type);
     }
 
     LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
@@ -457,6 +738,17 @@ LLVMValueRef generate_let_in(LLVM_Visitor* v, ASTNode* node) {
     return result;
 }
 
+// Cierra un condicional cuyo valor no se usa tras generar la rama 'then':
+// la rama 'else' (si existe) solo se ejecuta y ninguna produce un valor
+static void finish_discarded_branches(LLVM_Visitor* v, ASTNode* false_body,
+    LLVMBasicBlockRef else_block, LLVMBasicBlockRef merge_block) {
+    LLVMBuildBr(builder, merge_block);
+    LLVMPositionBuilderAtEnd(builder, else_block);
+    accept_gen(v, false_body);
+    LLVMBuildBr(builder, merge_block);
+    LLVMPositionBuilderAtEnd(builder, merge_block);
+}
+
 LLVMValueRef generate_conditional(LLVM_Visitor* v, ASTNode* node) {
     ASTNode* condition = node->data.cond_node.cond;
     ASTNode* true_body = node->data.cond_node.body_true;
@@ -479,6 +771,12 @@ LLVMValueRef generate_conditional(LLVM_Visitor* v, ASTNode* node) {
     // Generate 'then' block
     LLVMPositionBuilderAtEnd(builder, then_block);
     LLVMValueRef then_val = accept_gen(v, true_body);
+
+    // Sin nadie que use el resultado, las ramas solo se ejecutan
+    if (node->flags & FLAG_DISCARDED) {
+        finish_discarded_branches(v, false_body, else_block, merge_block);
+        return NULL;
+    }
     
     // Cast then_val to the return type if necessary
     if (!type_equals(true_body->return_type, node->return_type)) {
@@ -572,6 +870,11 @@ LLVMValueRef generate_q_conditional(LLVM_Visitor* v, ASTNode* node) {
     // --- Bloque 'then' (cuerpo true) ---
     LLVMPositionBuilderAtEnd(builder, then_block);
     LLVMValueRef then_val = accept_gen(v, true_body);
+    // Si el resultado no se usa, no hay conversiones ni PHI
+    if (node->flags & FLAG_DISCARDED) {
+        finish_discarded_branches(v, false_body, else_block, merge_block);
+        return NULL;
+    }
     // Realizamos conversiones/casts si es necesario para que el tipo encaje.
     if (then_val && !type_equals(true_body->return_type, node->return_type)) {
         then_val = cast_value_to_type(then_val, true_body->return_type, node->return_type);
@@ -625,6 +928,12 @@ LLVMValueRef cast_value_to_type(LLVMValueRef value, Type* from_type, Type* to_ty
         return value;
     }
 
+    // Object es una palabra etiquetada: los demás valores pasan a Object
+    // sin reservar memoria
+    if (type_equals(to_type, &TYPE_OBJECT)) {
+        return type_equals(from_type, &TYPE_NULL) ? build_tagged_null() : box_value(value);
+    }
+
     // Handle primitive type conversions first
     if (is_builtin_type(to_type)) {
         if (type_equals(to_type, &TYPE_NUMBER)) {
@@ -636,14 +945,14 @@ LLVMValueRef cast_value_to_type(LLVMValueRef value, Type* from_type, Type* to_ty
         
         if (type_equals(to_type, &TYPE_STRING)) {
             if (type_equals(from_type, &TYPE_NUMBER)) {
-                return LLVMBuildGlobalStringPtr(builder, "0", "num_to_str");
+                return get_string_literal("0");
             }
             if (type_equals(from_type, &TYPE_BOOLEAN)) {
                 return LLVMBuildICmp(builder, LLVMIntNE, value, LLVMConstInt(LLVMInt1Type(), 0, 0), "bool_val") ?
-                    LLVMBuildGlobalStringPtr(builder, "true", "bool_to_str") :
-                    LLVMBuildGlobalStringPtr(builder, "false", "bool_to_str");
+                    get_string_literal("true") :
+                    get_string_literal("false");
             }
-            return LLVMBuildGlobalStringPtr(builder, "", "to_str");
+            return get_string_literal("");
         }
         
         if (type_equals(to_type, &TYPE_BOOLEAN)) {
@@ -655,18 +964,6 @@ LLVMValueRef cast_value_to_type(LLVMValueRef value, Type* from_type, Type* to_ty
         }
     }
 
-    // Manejo de conversión de tipos de usuario a un supertipo built-in, por ejemplo, a OBJECT.
-    // Esto es útil si TYPE_OBJECT es considerado built-in pero queremos admitir que
-    // un tipo definido por el usuario (como A) se pueda convertir a Object.
-    if (!is_builtin_type(from_type) && (type_equals(to_type, &TYPE_OBJECT))) {
-        LLVMTypeRef from_struct = LLVMGetTypeByName(module, from_type->name);
-        LLVMTypeRef object_struct = LLVMGetTypeByName(module, to_type->name);
-        if (from_struct && object_struct) {
-            LLVMTypeRef object_ptr = LLVMPointerType(object_struct, 0);
-            return LLVMBuildBitCast(builder, value, object_ptr, "to_object");
-        }
-    }
-    
     // Handle user-defined types
     if (!is_builtin_type(from_type) && !is_builtin_type(to_type)) {
         // Find closest common ancestor
@@ -705,11 +1002,13 @@ LLVMValueRef cast_value_to_type(LLVMValueRef value, Type* from_type, Type* to_ty
 LLVMValueRef generate_loop(LLVM_Visitor* v, ASTNode* node) {
     LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
 
-    LLVMTypeRef body_type = get_llvm_type(node->data.op_node.right->return_type);
+    // Si nadie usa el valor del ciclo no hace falta guardarlo
+    LLVMTypeRef body_type = node->flags & FLAG_DISCARDED ?
+        LLVMVoidType() : get_llvm_type(node->data.op_node.right->return_type);
 
     LLVMValueRef result_addr = NULL;
     if (LLVMGetTypeKind(body_type) != LLVMVoidTypeKind) {
-        result_addr = LLVMBuildAlloca(builder, body_type, "while.result.addr");
+        result_addr = build_variable_slot(body_type, "while.result.addr");
         LLVMBuildStore(builder, LLVMConstNull(body_type), result_addr);
     }
 
@@ -729,6 +1028,10 @@ LLVMValueRef generate_loop(LLVM_Visitor* v, ASTNode* node) {
     if (LLVMGetTypeKind(body_type) != LLVMVoidTypeKind) {
         LLVMBuildStore(builder, body_val, result_addr);
     }
+    // Al final de la iteración no queda ningún temporal pendiente
+    if (node->flags & FLAG_GC_SAFEPOINT) {
+        gc_safepoint();
+    }
     LLVMBuildBr(builder, cond_block);
 
     LLVMPositionBuilderAtEnd(builder, merge_block);
@@ -740,61 +1043,276 @@ LLVMValueRef generate_loop(LLVM_Visitor* v, ASTNode* node) {
     }
 }
 
-LLVMTypeRef generate_struct_type(const char* type_name, ASTNode* type_node) {
-    // Create struct type
-    LLVMTypeRef struct_type = LLVMStructCreateNamed(context, type_name);
-    
-    // Count fields to allocate
-    int field_count = 0;
+// Tipo definido por el usuario del que hereda 'type', o NULL
+static Type* user_parent(Type* type) {
+    Type* parent = type->parent;
+    return parent && parent->dec && !is_builtin_type(parent) ? parent : NULL;
+}
+
+static Type* declared_type(ASTNode* type_node) {
+    Symbol* defined_type = find_defined_type(type_node->scope, type_node->data.type_node.name);
+    return defined_type ? defined_type->type : NULL;
+}
+
+// Disposición de los campos de un tipo: posición en el struct y tipo en
+// LLVM de cada uno, los heredados primero (en las mismas posiciones que en
+// el padre, así una instancia de un tipo hijo se pasa como la del padre con
+// un bitcast)
+typedef struct FieldLayout {
+    char* type_name;
+    int count;
+    const char** names;             // sin el prefijo del tipo que los declara
+    LLVMTypeRef* types;             // types[i] está en la posición i + 1
+    struct FieldLayout* next;
+} FieldLayout;
+
+static FieldLayout* field_layouts = NULL;
+
+// Nombre de un campo sin el prefijo "_Tipo_" que le pone el chequeo
+// semántico: un campo heredado se nombra con el prefijo de otro tipo
+static const char* field_base_name(const char* name, const char* type_name) {
+    size_t length = strlen(type_name);
+    if (name[0] == '_' && !strncmp(name + 1, type_name, length) && name[length + 1] == '_') {
+        return name + length + 2;
+    }
+    return name;
+}
+
+// Alineación de un campo en bytes (los punteros y los Number van a 8)
+static unsigned field_alignment(LLVMTypeRef type) {
+    if (LLVMGetTypeKind(type) == LLVMIntegerTypeKind) {
+        return (LLVMGetIntTypeWidth(type) + 7) / 8;
+    }
+    return 8;
+}
+
+static FieldLayout* get_field_layout(Type* type) {
+    for (FieldLayout* layout = field_layouts; layout; layout = layout->next) {
+        if (!strcmp(layout->type_name, type->name)) {
+            return layout;
+        }
+    }
+
+    FieldLayout* parent_layout = user_parent(type) ? get_field_layout(user_parent(type)) : NULL;
+    int inherited = parent_layout ? parent_layout->count : 0;
+    ASTNode* type_node = type->dec;
+    int count = inherited;
     for (int i = 0; i < type_node->data.type_node.def_count; i++) {
-        ASTNode* def = type_node->data.type_node.definitions[i];
-        if (def->type == NODE_ASSIGNMENT) {
-            field_count++;
+        if (type_node->data.type_node.definitions[i]->type == NODE_ASSIGNMENT) {
+            count++;
         }
     }
 
-    // Create array for field types - add 3 for type id, vtable pointer and parent pointer
-    int extra_fields = type_node->data.type_node.parent_name[0] != '\0' ? 3 : 2;
-    LLVMTypeRef* field_types = malloc((field_count + extra_fields) * sizeof(LLVMTypeRef));
-    int field_idx = 0;
+    FieldLayout* layout = malloc(sizeof(FieldLayout));
+    layout->type_name = strdup(type->name);
+    layout->count = count;
+    layout->names = malloc((count + 1) * sizeof(char*));
+    layout->types = malloc((count + 1) * sizeof(LLVMTypeRef));
+    for (int i = 0; i < inherited; i++) {
+        layout->names[i] = parent_layout->names[i];
+        layout->types[i] = parent_layout->types[i];
+    }
 
-    // Add type ID as first field (32-bit integer)
-    field_types[field_idx++] = LLVMInt32Type();
+    // Los campos propios van de mayor a menor alineación (en el orden en que
+    // se declaran cuando coincide): un Boolean entre dos punteros ya no deja
+    // 7 bytes de relleno
+    int placed = inherited;
+    for (unsigned alignment = 8; alignment > 0; alignment /= 2) {
+        for (int i = 0; i < type_node->data.type_node.def_count; i++) {
+            ASTNode* def = type_node->data.type_node.definitions[i];
+            if (def->type != NODE_ASSIGNMENT) {
+                continue;
+            }
+            LLVMTypeRef field_type = get_llvm_type(def->data.op_node.right->return_type);
+            unsigned field_align = field_alignment(field_type);
+            if (field_align == alignment) {
+                layout->names[placed] = field_base_name(def->data.op_node.left->data.variable_name, type->name);
+                layout->types[placed] = field_type;
+                placed++;
+            }
+        }
+    }
+
+    layout->next = field_layouts;
+    field_layouts = layout;
+    return layout;
+}
 
-    // Add vtable pointer as second field - just create an opaque type for now
+LLVMTypeRef generate_struct_type(const char* type_name, ASTNode* type_node) {
+    // Create struct type (or use the forward declaration)
+    LLVMTypeRef struct_type = LLVMGetTypeByName(module, type_name);
+    if (!struct_type) {
+        struct_type = LLVMStructCreateNamed(context, type_name);
+    }
+
+    FieldLayout* layout = get_field_layout(declared_type(type_node));
+    LLVMTypeRef* field_types = malloc((layout->count + 1) * sizeof(LLVMTypeRef));
+
+    // La cabecera es solo el puntero a la vtable: el id del tipo, su
+    // intervalo de descendientes y su nombre están en la vtable
     char vtable_type_name[256];
     snprintf(vtable_type_name, sizeof(vtable_type_name), "%s_vtable", type_name);
-    // Don't create the vtable type here, just get a reference to it
-    LLVMTypeRef vtable_type = LLVMStructCreateNamed(context, vtable_type_name);
-    field_types[field_idx++] = LLVMPointerType(vtable_type, 0);
-
-    // Add parent pointer if inheriting
-    if (type_node->data.type_node.parent_name[0] != '\0') {
-        LLVMTypeRef parent_struct_type = LLVMGetTypeByName(module, type_node->data.type_node.parent_name);
-        if (parent_struct_type) {
-            field_types[field_idx++] = LLVMPointerType(parent_struct_type, 0);
+    LLVMTypeRef vtable_type = LLVMGetTypeByName(module, vtable_type_name);
+    if (!vtable_type) {
+        vtable_type = LLVMStructCreateNamed(context, vtable_type_name);
+    }
+    field_types[0] = LLVMPointerType(vtable_type, 0);
+
+    for (int i = 0; i < layout->count; i++) {
+        field_types[i + 1] = layout->types[i];
+    }
+    LLVMStructSetBody(struct_type, field_types, layout->count + 1, 0);
+    free(field_types);
+    
+    return struct_type;
+}
+
+// Entrada de la vtable: 'name' es el nombre del método sin el prefijo del
+// tipo y 'slot_type' el tipo del puntero con que lo declaró el primer
+// ancestro que lo tiene
+typedef struct VTableSlot {
+    const char* name;
+    ASTNode* method;
+    LLVMTypeRef slot_type;
+} VTableSlot;
+
+static int count_methods(Type* type) {
+    if (!type || !type->dec) {
+        return 0;
+    }
+
+    int count = count_methods(user_parent(type));
+    ASTNode* type_node = type->dec;
+    for (int i = 0; i < type_node->data.type_node.def_count; i++) {
+        if (type_node->data.type_node.definitions[i]->type == NODE_FUNC_DEC) {
+            count++;
         }
     }
+    return count;
+}
+
+// Como en las funciones globales, el tipo que devuelve un método es el de
+// su cuerpo
+static LLVMTypeRef method_return_type(ASTNode* method) {
+    return get_llvm_type(method->data.func_node.body->return_type);
+}
+
+static LLVMTypeRef method_pointer_type(ASTNode* method, Type* owner) {
+    int param_count = method->data.func_node.arg_count + 1;
+    LLVMTypeRef* param_types = malloc(param_count * sizeof(LLVMTypeRef));
+    param_types[0] = get_llvm_type(owner);
+    for (int i = 0; i < method->data.func_node.arg_count; i++) {
+        param_types[i + 1] = get_llvm_type(method->data.func_node.args[i]->return_type);
+    }
+
+    LLVMTypeRef func_type = LLVMFunctionType(method_return_type(method), param_types, param_count, 0);
+    free(param_types);
+    return LLVMPointerType(func_type, 0);
+}
+
+// Métodos de la vtable de un tipo: los del padre en el mismo orden, con
+// los que el tipo redefine en su lugar, y después los nuevos. Un método
+// ocupa la misma posición en las vtables de todos los descendientes
+static int collect_vtable_slots(Type* type, VTableSlot* slots) {
+    if (!type || !type->dec) {
+        return 0;
+    }
 
-    // Add this type's fields
+    int count = collect_vtable_slots(user_parent(type), slots);
+    ASTNode* type_node = type->dec;
+    size_t prefix = strlen(type->name) + 2;   // "_Tipo_"
     for (int i = 0; i < type_node->data.type_node.def_count; i++) {
         ASTNode* def = type_node->data.type_node.definitions[i];
-        if (def->type == NODE_ASSIGNMENT) {
-            Type* field_type = def->data.op_node.right->return_type;
-            field_types[field_idx++] = get_llvm_type(field_type);
+        if (def->type != NODE_FUNC_DEC) {
+            continue;
+        }
+
+        const char* name = def->data.func_node.name + prefix;
+        int slot = 0;
+        while (slot < count && strcmp(slots[slot].name, name)) {
+            slot++;
+        }
+        if (slot == count) {
+            slots[count].name = name;
+            slots[count].slot_type = method_pointer_type(def, type);
+            count++;
         }
+        slots[slot].method = def;
     }
-    
-    LLVMStructSetBody(struct_type, field_types, field_idx, 0);
+    return count;
+}
+
+// Posición del método en la vtable (el campo 0 es el TypeInfo), o -1
+static int find_method_slot(Type* type, const char* method_name) {
+    VTableSlot* slots = malloc((count_methods(type) + 1) * sizeof(VTableSlot));
+    int count = collect_vtable_slots(type, slots);
+    int index = -1;
+    for (int i = 0; i < count && index < 0; i++) {
+        if (!strcmp(slots[i].method->data.func_node.name, method_name)) {
+            index = i + 1;
+        }
+    }
+    free(slots);
+    return index;
+}
+
+// Cuerpo de T_vtable: el TypeInfo y un puntero por método. Se fija antes
+// de generar los métodos, que pueden llamarse entre sí
+static void generate_vtable_type(Type* type) {
+    VTableSlot* slots = malloc((count_methods(type) + 1) * sizeof(VTableSlot));
+    int slot_count = collect_vtable_slots(type, slots);
+    LLVMTypeRef* field_types = malloc((slot_count + 1) * sizeof(LLVMTypeRef));
+
+    field_types[0] = get_type_info_type();
+    for (int i = 0; i < slot_count; i++) {
+        field_types[i + 1] = slots[i].slot_type;
+    }
+
+    char vtable_type_name[256];
+    snprintf(vtable_type_name, sizeof(vtable_type_name), "%s_vtable", type->name);
+    LLVMStructSetBody(LLVMGetTypeByName(module, vtable_type_name), field_types, slot_count + 1, 0);
+    printf("Debug: Setting vtable type %s body with %d methods\n", vtable_type_name, slot_count);
+
+    free(slots);
     free(field_types);
-    
-    return struct_type;
+}
+
+// T_vtable_instance, una vez generados los métodos
+static void generate_vtable(Type* type) {
+    const char* type_name = type->name;
+    VTableSlot* slots = malloc((count_methods(type) + 1) * sizeof(VTableSlot));
+    int slot_count = collect_vtable_slots(type, slots);
+    LLVMValueRef* fields = malloc((slot_count + 1) * sizeof(LLVMValueRef));
+
+    TypeIDMap* bounds = find_type_id(type_name);
+    LLVMValueRef info[] = {
+        LLVMConstInt(LLVMInt32Type(), bounds ? bounds->id : 0, 0),
+        LLVMConstInt(LLVMInt32Type(), bounds ? bounds->last_descendant : 0, 0),
+        get_global_string(type_name, "type_name")
+    };
+    fields[0] = LLVMConstNamedStruct(get_type_info_type(), info, 3);
+
+    for (int i = 0; i < slot_count; i++) {
+        LLVMValueRef func = LLVMGetNamedFunction(module, slots[i].method->data.func_node.name);
+        fields[i + 1] = LLVMConstBitCast(func, slots[i].slot_type);
+    }
+
+    char vtable_type_name[256];
+    snprintf(vtable_type_name, sizeof(vtable_type_name), "%s_vtable", type_name);
+    LLVMTypeRef vtable_type = LLVMGetTypeByName(module, vtable_type_name);
+    char vtable_name[256];
+    snprintf(vtable_name, sizeof(vtable_name), "%s_vtable_instance", type_name);
+    LLVMValueRef vtable = LLVMAddGlobal(module, vtable_type, vtable_name);
+    LLVMSetInitializer(vtable, LLVMConstNamedStruct(vtable_type, fields, slot_count + 1));
+    LLVMSetGlobalConstant(vtable, 1);
+
+    free(slots);
+    free(fields);
 }
 
 void generate_type_methods(LLVM_Visitor* visitor, const char* type_name, LLVMTypeRef struct_type, ASTNode* type_node) {
     printf("\nDebug: Generating methods for type %s\n", type_name);
     
-    // First generate vtable type
     LLVMBuilderRef saved_builder = builder;
     builder = LLVMCreateBuilder();
     
@@ -815,20 +1333,13 @@ void generate_type_methods(LLVM_Visitor* visitor, const char* type_name, LLVMTyp
         return;
     }
 
-    // Arrays for storing method information
-    LLVMTypeRef* vtable_fn_types = malloc(method_count * sizeof(LLVMTypeRef));
-    LLVMValueRef* method_ptrs = malloc(method_count * sizeof(LLVMValueRef));
-    char** method_names = malloc(method_count * sizeof(char*));
     int method_idx = 0;
 
-    // First pass: Generate all method declarations and bodies
+    // Generate all method declarations and bodies (the vtable is built
+    // afterwards by generate_vtable, with the inherited ones)
     for(int i = 0; i < type_node->data.type_node.def_count; i++) {
         ASTNode* def = type_node->data.type_node.definitions[i];
         if(def->type == NODE_FUNC_DEC) {
-            // Use the method name as is, it's already properly formatted
-            method_names[method_idx] = strdup(def->data.func_node.name);
-            printf("Debug: Using method name: %s\n", method_names[method_idx]);
-            
             printf("Debug: Generating method %s (#%d)\n", def->data.func_node.name, method_idx);
             
             // Create function type with 'this' pointer as first argument
@@ -841,23 +1352,26 @@ void generate_type_methods(LLVM_Visitor* visitor, const char* type_name, LLVMTyp
             }
             
             // Get return type
-            LLVMTypeRef return_type = get_llvm_type(def->return_type);
+            LLVMTypeRef return_type = method_return_type(def);
             if (!return_type) return_type = LLVMVoidType();
             
-            // Create function type and store it for vtable
+            // Create function type
             LLVMTypeRef func_type = LLVMFunctionType(return_type, param_types, param_count, 0);
-            vtable_fn_types[method_idx] = LLVMPointerType(func_type, 0);
             
             printf("Debug: Created function type for method %s: %s\n", 
                    def->data.func_node.name, LLVMPrintTypeToString(func_type));
 
             // Add function declaration with original name
             LLVMValueRef func = LLVMAddFunction(module, def->data.func_node.name, func_type);
-            method_ptrs[method_idx] = func;
+            add_effect_attributes(func, def);
             
             // Generate method body
             LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
             LLVMPositionBuilderAtEnd(builder, entry);
+            GCFrame enclosing = gc_begin_frame(entry);
+            LLVMBasicBlockRef body = LLVMAppendBasicBlock(func, "method_body");
+            LLVMBuildBr(builder, body);
+            LLVMPositionBuilderAtEnd(builder, body);
             
             // Store old scope and create new one
             push_scope();
@@ -867,17 +1381,26 @@ void generate_type_methods(LLVM_Visitor* visitor, const char* type_name, LLVMTyp
             declare_variable("self", this_ptr);
             
             // Add parameters to scope
+            // Los Number, String y Boolean se leen de un slot o de su valor
             for(int j = 0; j < def->data.func_node.arg_count; j++) {
                 LLVMValueRef param = LLVMGetParam(func, j + 1);
-                declare_variable(def->data.func_node.args[j]->data.variable_name, param);
+                ASTNode* param_node = def->data.func_node.args[j];
+                Type* param_type = param_node->return_type;
+                if (is_builtin_type(param_type) && !type_equals(param_type, &TYPE_OBJECT)) {
+                    bind_variable(param_node, param_node->data.variable_name, param, LLVMTypeOf(param));
+                } else {
+                    declare_variable(param_node->data.variable_name, param);
+                }
             }
             
             // Generate body
             LLVMValueRef result = accept_gen(visitor, def->data.func_node.body);
             
             if (LLVMGetTypeKind(return_type) == LLVMVoidTypeKind) {
+                gc_end_frame(enclosing, NULL);
                 LLVMBuildRetVoid(builder);
             } else {
+                gc_end_frame(enclosing, result);
                 LLVMBuildRet(builder, result);
             }
             
@@ -889,236 +1412,206 @@ void generate_type_methods(LLVM_Visitor* visitor, const char* type_name, LLVMTyp
         }
     }
 
-    // Get the existing vtable type and set its body
-    char vtable_type_name[256];
-    snprintf(vtable_type_name, sizeof(vtable_type_name), "%s_vtable", type_name);
-    printf("Debug: Setting vtable type %s body with %d methods\n", vtable_type_name, method_count);
-    
-    LLVMTypeRef vtable_type = LLVMGetTypeByName(module, vtable_type_name);
-    if (!vtable_type) {
-        printf("Error: Could not find vtable type %s\n", vtable_type_name);
-        return;
+    LLVMDisposeBuilder(builder);
+    builder = saved_builder;
+}
+
+// Adapta un argumento al tipo del parámetro que lo recibe: los valores que
+// llegan a un Object se etiquetan, las variables de tipos definidos por el
+// usuario llegan como T** y una instancia de un tipo hijo se pasa como la
+// del padre
+static LLVMValueRef coerce_argument(LLVMValueRef value, LLVMTypeRef param_type) {
+    if (param_type == LLVMPointerType(object_type, 0)) {
+        return box_value(value);
     }
-    LLVMStructSetBody(vtable_type, vtable_fn_types, method_count, 0);
-    
-    // Create vtable global
-    char vtable_name[256];
-    snprintf(vtable_name, sizeof(vtable_name), "%s_vtable_instance", type_name);
-    printf("Debug: Creating vtable global %s\n", vtable_name);
-    
-    LLVMValueRef vtable = LLVMAddGlobal(module, vtable_type, vtable_name);
-    
-    // Initialize vtable with method pointers
-    LLVMValueRef vtable_init = LLVMConstStruct(method_ptrs, method_count, 0);
-    LLVMSetInitializer(vtable, vtable_init);
-    
-    printf("Debug: Vtable initialization complete. Contents:\n");
-    for(int i = 0; i < method_count; i++) {
-        printf("  Slot %d: %s -> %s\n", i, method_names[i], 
-               LLVMPrintValueToString(method_ptrs[i]));
+
+    LLVMTypeRef value_type = LLVMTypeOf(value);
+    if (value_type != param_type && LLVMGetTypeKind(value_type) == LLVMPointerTypeKind &&
+        LLVMGetTypeKind(LLVMGetElementType(value_type)) == LLVMPointerTypeKind) {
+        value = LLVMBuildLoad2(builder, LLVMGetElementType(value_type), value, "instance");
+        value_type = LLVMTypeOf(value);
     }
+    if (value_type != param_type && LLVMGetTypeKind(value_type) == LLVMPointerTypeKind &&
+        LLVMGetTypeKind(param_type) == LLVMPointerTypeKind) {
+        value = LLVMBuildBitCast(builder, value, param_type, "as_param");
+    }
+    return value;
+}
 
-    // Cleanup
-    for(int i = 0; i < method_count; i++) {
-        free(method_names[i]);
+// void T__init(T* self, parámetros...): inicializa una instancia ya
+// reservada. Se declara con la primera referencia (un 'new' puede estar en
+// una función global, que se genera antes que el tipo)
+static LLVMValueRef get_type_init(ASTNode* type_def, LLVMTypeRef struct_type) {
+    char init_name[256];
+    snprintf(init_name, sizeof(init_name), "%s__init", type_def->data.type_node.name);
+    LLVMValueRef init = LLVMGetNamedFunction(module, init_name);
+    if (init) {
+        return init;
     }
-    free(method_names);
-    free(vtable_fn_types);
-    free(method_ptrs);
-    
-    LLVMDisposeBuilder(builder);
-    builder = saved_builder;
+
+    int param_count = type_def->data.type_node.arg_count;
+    LLVMTypeRef* param_types = malloc((param_count + 1) * sizeof(LLVMTypeRef));
+    param_types[0] = LLVMPointerType(struct_type, 0);
+    for (int i = 0; i < param_count; i++) {
+        param_types[i + 1] = get_llvm_type(type_def->data.type_node.args[i]->return_type);
+    }
+
+    LLVMTypeRef init_type = LLVMFunctionType(LLVMVoidType(), param_types, param_count + 1, 0);
+    init = LLVMAddFunction(module, init_name, init_type);
+    add_function_attribute(init, "nounwind");
+    free(param_types);
+    return init;
 }
-LLVMValueRef generate_type_declaration(LLVM_Visitor* v, ASTNode* node) {
+
+// Llama a T__init sobre 'instance' (una instancia de T o de un tipo hijo)
+// con los argumentos del constructor
+static void build_init_call(LLVM_Visitor* v, Type* type, LLVMValueRef instance, ASTNode** args, int arg_count) {
+    LLVMTypeRef struct_type = LLVMGetElementType(get_llvm_type(type));
+    LLVMValueRef init = get_type_init(type->dec, struct_type);
+    LLVMTypeRef init_type = LLVMGetElementType(LLVMTypeOf(init));
+    LLVMTypeRef* param_types = malloc((arg_count + 1) * sizeof(LLVMTypeRef));
+    LLVMValueRef* call_args = malloc((arg_count + 1) * sizeof(LLVMValueRef));
+    LLVMGetParamTypes(init_type, param_types);
+
+    call_args[0] = coerce_argument(instance, param_types[0]);
+    for (int i = 0; i < arg_count; i++) {
+        call_args[i + 1] = coerce_argument(accept_gen(v, args[i]), param_types[i + 1]);
+    }
+    LLVMBuildCall2(builder, init_type, init, call_args, arg_count + 1, "");
+
+    free(param_types);
+    free(call_args);
+}
+
+// Cuerpo de T__init: inicializa la parte del padre con su T__init, guarda
+// la vtable (después, así queda la del tipo) y evalúa los inicializadores
+// de los campos con los parámetros en el scope
+static void generate_type_init(LLVM_Visitor* v, ASTNode* node, Type* type, LLVMTypeRef struct_type) {
+    LLVMValueRef init = get_type_init(node, struct_type);
     const char* type_name = node->data.type_node.name;
-    // Assign type ID
-    int type_id = next_type_id++;
-    node->data.type_node.id = type_id;
-    register_type_id(type_name, type_id);
-    printf("Debug: Assigned ID %d to type %s\n", type_id, type_name);
-    
-    // Store type parameters in scope for use in field initializations
+
+    LLVMBuilderRef saved_builder = builder;
+    builder = LLVMCreateBuilder();
+    TailFunction enclosing_tail = tail_function;
+    tail_function.func = NULL;
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(init, "entry");
+    LLVMPositionBuilderAtEnd(builder, entry);
+    GCFrame enclosing = gc_begin_frame(entry);
+    LLVMBasicBlockRef body = LLVMAppendBasicBlock(init, "init_body");
+    LLVMBuildBr(builder, body);
+    LLVMPositionBuilderAtEnd(builder, body);
     push_scope();
-    
-    // Add type parameters to scope
-    for(int i = 0; i < node->data.type_node.arg_count; i++) {
-        ASTNode* param = node->data.type_node.args[i];
-        // Create an alloca for each parameter
-        LLVMTypeRef param_type = get_llvm_type(param->return_type);
-        LLVMValueRef param_alloca = LLVMBuildAlloca(builder, param_type, param->data.variable_name);
-        declare_variable(param->data.variable_name, param_alloca);
+
+    LLVMValueRef instance = LLVMGetParam(init, 0);
+    for (int i = 0; i < node->data.type_node.arg_count; i++) {
+        LLVMValueRef param = LLVMGetParam(init, i + 1);
+        const char* param_name = node->data.type_node.args[i]->data.variable_name;
+        bind_variable(node->data.type_node.args[i], param_name, param, LLVMTypeOf(param));
     }
 
-    // Create the struct type for this class (or use existing forward declaration)
-    LLVMTypeRef struct_type = LLVMGetTypeByName(module, type_name);
-    if (!struct_type) {
-        // Create a new struct type if it doesn't exist
-        struct_type = LLVMStructCreateNamed(context, type_name);
-        printf("Debug: Created new struct type %s\n", type_name);
-    } else {
-        printf("Debug: Using existing forward declaration for %s\n", type_name);
+    // Campos heredados: la instancia empieza con la disposición del padre
+    Type* parent = user_parent(type);
+    if (parent && node->data.type_node.parent_instance) {
+        ASTNode* parent_instance = node->data.type_node.parent_instance;
+        build_init_call(v, parent, instance, parent_instance->data.type_node.args,
+                        parent_instance->data.type_node.arg_count);
     }
-    
-    // Count fields to allocate
-    int field_count = 0;
+
+    // Initialize vtable pointer (the whole header)
+    char vtable_name[256];
+    snprintf(vtable_name, sizeof(vtable_name), "%s_vtable_instance", type_name);
+    LLVMValueRef vtable_ptr = LLVMGetNamedGlobal(module, vtable_name);
+    LLVMValueRef vtable_field_ptr = LLVMBuildStructGEP2(builder, struct_type, instance, 0, "vtable_ptr");
+    LLVMBuildStore(builder, vtable_ptr, vtable_field_ptr);
+
+    // Campos del tipo, en el orden en que se declaran
     for (int i = 0; i < node->data.type_node.def_count; i++) {
         ASTNode* def = node->data.type_node.definitions[i];
-        if (def->type == NODE_ASSIGNMENT) {
-            field_count++;
+        if (def->type != NODE_ASSIGNMENT) {
+            continue;
+        }
+
+        int field_index = find_field_index(type, def->data.op_node.left->data.variable_name);
+        LLVMValueRef value = accept_gen(v, def->data.op_node.right);
+        if (field_index >= 0 && value) {
+            LLVMValueRef field_ptr = LLVMBuildStructGEP2(builder, struct_type, instance, field_index, "field_ptr");
+            LLVMBuildStore(builder, coerce_argument(value, LLVMStructGetTypeAtIndex(struct_type, field_index)), field_ptr);
         }
     }
 
-    // Create array for field types - add 3 for type id, vtable pointer and parent pointer
-    int extra_fields = node->data.type_node.parent_name[0] != '\0' ? 3 : 2;
-    LLVMTypeRef* field_types = malloc((field_count + extra_fields) * sizeof(LLVMTypeRef));
-    int field_idx = 0;
+    pop_scope();
+    gc_end_frame(enclosing, NULL);
+    LLVMBuildRetVoid(builder);
 
-    // Add type ID as first field (32-bit integer)
-    field_types[field_idx++] = LLVMInt32Type();
+    tail_function = enclosing_tail;
+    LLVMDisposeBuilder(builder);
+    builder = saved_builder;
+}
 
-    // Add vtable pointer as second field
-    char vtable_type_name[256];
-    snprintf(vtable_type_name, sizeof(vtable_type_name), "%s_vtable", type_name);
-    // Get or create vtable type (forward declaration if needed)
-    LLVMTypeRef vtable_type = LLVMGetTypeByName(module, vtable_type_name);
-    if (!vtable_type) {
-        vtable_type = LLVMStructCreateNamed(context, vtable_type_name);
+// Disposición de las instancias y de las vtables de todos los tipos, antes
+// de las funciones globales (que se generan primero y ya llaman métodos)
+static void declare_types(ASTNode* program) {
+    if (!program || program->type != NODE_PROGRAM) {
+        return;
     }
-    field_types[field_idx++] = LLVMPointerType(vtable_type, 0);
 
-    // Add parent pointer if inheriting
-    if (node->data.type_node.parent_name[0] != '\0') {
-        // Get or create parent type (forward declaration if needed)
-        LLVMTypeRef parent_struct_type = LLVMGetTypeByName(module, node->data.type_node.parent_name);
-        if (!parent_struct_type) {
-            parent_struct_type = LLVMStructCreateNamed(context, node->data.type_node.parent_name);
+    for (int i = 0; i < program->data.program_node.count; i++) {
+        ASTNode* stmt = program->data.program_node.statements[i];
+        if (stmt->type == NODE_TYPE_DEC) {
+            generate_struct_type(stmt->data.type_node.name, stmt);
+            generate_vtable_type(declared_type(stmt));
         }
-        field_types[field_idx++] = LLVMPointerType(parent_struct_type, 0);
     }
+}
 
-    // Add this type's fields
-    for (int i = 0; i < node->data.type_node.def_count; i++) {
-        ASTNode* def = node->data.type_node.definitions[i];
-        if (def->type == NODE_ASSIGNMENT) {
-            Type* field_type = def->data.op_node.right->return_type;
-            field_types[field_idx++] = get_llvm_type(field_type);
-        }
+LLVMValueRef generate_type_declaration(LLVM_Visitor* v, ASTNode* node) {
+    const char* type_name = node->data.type_node.name;
+    Type* type = declared_type(node);
+
+    // El padre se genera primero: la vtable copia sus métodos
+    char vtable_name[256];
+    snprintf(vtable_name, sizeof(vtable_name), "%s_vtable_instance", type_name);
+    if (LLVMGetNamedGlobal(module, vtable_name)) {
+        return NULL;
     }
-    
-    // Set the body of the struct (even if it was a forward declaration)
-    LLVMStructSetBody(struct_type, field_types, field_idx, 0);
-    free(field_types);
-    
+    Type* parent = user_parent(type);
+    if (parent) {
+        accept_gen(v, parent->dec);
+    }
+
+    LLVMTypeRef struct_type = LLVMGetTypeByName(module, type_name);
+
     // Generate methods for this type
     generate_type_methods(v, type_name, struct_type, node);
     printf("Debug: Generated struct type %s\n", type_name);
-    
-    pop_scope();
+
+    // Constructor (después de la vtable, que guarda en la instancia)
+    generate_vtable(type);
+    generate_type_init(v, node, type, struct_type);
     return NULL;
 }
+
 LLVMValueRef generate_type_instance(LLVM_Visitor* v, ASTNode* node) {
-    push_scope();
-    printf("Debug: Generating instance for type %s\n", node->data.type_node.name);
-    const char* type_name = node->data.type_node.name;
-    printf("Debug: Type name: %s\n", type_name);
-    LLVMTypeRef struct_type = LLVMGetTypeByName(module, type_name);
-    printf("Debug: Struct type: %s\n", LLVMPrintTypeToString(struct_type));
-    LLVMValueRef instance = LLVMBuildMalloc(builder, struct_type, "instance");
-    printf("Debug: Allocated instance: %s\n", LLVMPrintValueToString(instance));
     Type* type = node->return_type;
-    ASTNode* type_def = type->dec;
-    printf("Debug: Type definition found for %s\n", type_name);
+    LLVMTypeRef struct_type = LLVMGetElementType(get_llvm_type(type));
 
-    // Almacenamos los parámetros del constructor en el scope antes de cualquier inicialización
-    for (int i = 0; i < node->data.type_node.arg_count; i++) {
-        LLVMValueRef arg_value = accept_gen(v, node->data.type_node.args[i]);
-        const char* param_name = type_def->data.type_node.args[i]->data.variable_name;
-        
-        // Crear alloca para el parámetro y almacenarlo en el scope
-        LLVMValueRef param_alloca = LLVMBuildAlloca(builder, LLVMTypeOf(arg_value), "param_alloca");
-        LLVMBuildStore(builder, arg_value, param_alloca);
-        declare_variable(param_name, param_alloca);
-        printf("Debug: Declared constructor parameter '%s' in scope\n", param_name);
-    }
-    // Initialize type ID field (index 0)
-    LLVMValueRef id_ptr = LLVMBuildStructGEP2(builder, struct_type, instance, 0, "type_id_ptr");
-    printf("Debug: Type ID pointer: %s\n", LLVMPrintValueToString(id_ptr));
-    LLVMBuildStore(builder, LLVMConstInt(LLVMInt32Type(), type_def->data.type_node.id, 0), id_ptr);
-    printf("Debug: Set type ID to %d\n", type_def->data.type_node.id);
-    // Initialize vtable pointer (index 1)
-    char vtable_name[256];
-    snprintf(vtable_name, sizeof(vtable_name), "%s_vtable_instance", type_name);
-    LLVMValueRef vtable_ptr = LLVMGetNamedGlobal(module, vtable_name);
-    if (vtable_ptr) {
-        LLVMValueRef vtable_field_ptr = LLVMBuildStructGEP2(builder, struct_type, instance, 1, "vtable_ptr");
-        LLVMBuildStore(builder, vtable_ptr, vtable_field_ptr);
-    }
-    printf("Debug: Set vtable pointer for %s\n", vtable_name);
-    // Initialize parent instance if it exists (index 2)
-    if (type_def->data.type_node.parent_name[0] != '\0' && type_def->data.type_node.parent_instance) {
-        printf("Debug: Creating parent instance of type %s\n", type_def->data.type_node.parent_name);
-        
-        // Generar la instancia del padre - los parámetros ya están en el scope actual
-        LLVMValueRef parent_instance = accept_gen(v, type_def->data.type_node.parent_instance);
-        if (parent_instance) {
-            LLVMValueRef parent_ptr = LLVMBuildStructGEP2(builder, struct_type, instance, 2, "parent_ptr");
-            LLVMBuildStore(builder, parent_instance, parent_ptr);
-            printf("Debug: Parent instance created and stored in child\n");
-        }
+    LLVMValueRef instance = NULL;
+    if (node->flags & FLAG_STACK_INSTANCE) {
+        // La instancia no escapa de la función: vive en su pila
+        instance = build_instance_slot(struct_type);
     }
-    printf("Debug: Initialized parent instance if exists\n");
-    // Initialize constructor parameters and fields
-    for (int i = 0; i < node->data.type_node.arg_count; i++) {
-        const char* param_name = type_def->data.type_node.args[i]->data.variable_name;
-
-        /* obtén el alloca que creaste antes */
-        LLVMValueRef param_alloca = lookup_variable(param_name);   // o como lo llames
-
-        /* usa su valor tal cual, sin volver a generar código */
-        LLVMValueRef arg_value = LLVMBuildLoad(builder, param_alloca, "param_val");
-
-        // LLVMValueRef arg_value = accept_gen(v, node->data.type_node.args[i]);
-        
-        int field_index = -1;
-        
-        for (int j = 0; j < type_def->data.type_node.def_count; j++) {
-            ASTNode* def = type_def->data.type_node.definitions[j];
-            if (def->type == NODE_ASSIGNMENT) {
-                if (def->data.op_node.right->type == NODE_VARIABLE &&
-                    strcmp(def->data.op_node.right->data.variable_name, param_name) == 0) {
-                    field_index = find_field_index(type, def->data.op_node.left->data.variable_name);
-                    break;
-                }
-            }
-        }
-    printf("Debug: Parameter '%s' maps to field index %d\n", param_name, field_index);
-        if (field_index >= 0) {
-            LLVMValueRef field_ptr = LLVMBuildStructGEP2(
-                builder, struct_type, instance, field_index, "field_ptr");
-            printf("Debug: Field pointer for '%s': %s\n", param_name, LLVMPrintValueToString(field_ptr));
-            LLVMBuildStore(builder, arg_value, field_ptr);
-        }
-    printf("Debug: Set field '%s' to value %s\n", param_name, LLVMPrintValueToString(arg_value));
+    if (!instance && garbage_collection) {
+        // Bloque del recolector en cero, para que sus punteros empiecen en null
+        LLVMValueRef memory = build_gc_alloc(LLVMSizeOf(struct_type), get_gc_type_map(struct_type));
+        LLVMBuildMemSet(builder, memory, LLVMConstInt(LLVMInt8Type(), 0, 0), LLVMSizeOf(struct_type), 8);
+        instance = LLVMBuildBitCast(builder, memory, LLVMPointerType(struct_type, 0), "instance");
+    } else if (!instance) {
+        instance = build_slab_alloc(struct_type);
     }
-    
-    // Initialize default field values for non-parameter fields
-    if (node->data.type_node.arg_count == 0) {
-        for (int j = 0; j < type_def->data.type_node.def_count; j++) {
-            ASTNode* def = type_def->data.type_node.definitions[j];
-            if (def->type == NODE_ASSIGNMENT) {
-                if (def->data.op_node.right->type != NODE_VARIABLE) {
-                    LLVMValueRef def_val = accept_gen(v, def->data.op_node.right);
-                    const char* field_name = def->data.op_node.left->data.variable_name;
-                    int field_index = find_field_index(type, field_name);
-                    if (field_index >= 0) {
-                        LLVMValueRef field_ptr = LLVMBuildStructGEP2(builder, struct_type, instance, field_index, "field_ptr_default");
-                        LLVMBuildStore(builder, def_val, field_ptr);
-                    }
-                }
-            }
-        }
-    }
-    pop_scope();
+
+    // El resto del constructor es una llamada a T__init
+    build_init_call(v, type, instance, node->data.type_node.args, node->data.type_node.arg_count);
     return instance;
 }
 
@@ -1187,36 +1680,20 @@ static char* find_method_in_hierarchy(const char* method_name, Type* type) {
 }
 
 static int find_field_index(Type* type, const char* field_name) {
-    int current_index = 0;
-    
-    // Add base offsets for type ID and vtable pointer
-    current_index = 2;
-    
-    // If this type has a parent, then it has a parent pointer at index 2
-    // and its fields start after that
-    if (type->parent && !is_builtin_type(type->parent)) {
-        current_index++;
+    if (!type->dec || is_builtin_type(type)) {
+        return -1;
     }
-    
-    // First look in the current type's fields
-    ASTNode* type_node = type->dec;
-    if (type_node) {
-        for(int i = 0; i < type_node->data.type_node.def_count; i++) {
-            ASTNode* def = type_node->data.type_node.definitions[i];
-            if (def->type == NODE_ASSIGNMENT) {
-                if (strcmp(def->data.op_node.left->data.variable_name, field_name) == 0) {
-                    return current_index;
-                }
-                current_index++;
-            }
+
+    // The type's own fields come after the inherited ones, so searching
+    // backwards finds a redefined field before the parent's
+    FieldLayout* layout = get_field_layout(type);
+    const char* base_name = field_base_name(field_name, type->name);
+    for (int i = layout->count - 1; i >= 0; i--) {
+        if (strcmp(layout->names[i], base_name) == 0) {
+            return i + 1;   // index 0 is the vtable pointer
         }
     }
     
-    // If not found and we have a parent, look in parent fields
-    if (type->parent && !is_builtin_type(type->parent)) {
-        return find_field_index(type->parent, field_name);
-    }
-    
     return -1; // Field not found
 }
 
@@ -1268,33 +1745,108 @@ char* extract_type_from_method_name(const char* method_full_name) {
     return type;
 }
 
+// Busca la definición del método llamado en el tipo estático del receptor
+// o sus ancestros. Devuelve la definición solo si está marcada con
+// FLAG_INLINE, junto con el tipo que la define
+static ASTNode* find_inline_method(ASTNode* node, Type** owner) {
+    Type* instance_type = node->data.op_node.left->return_type;
+    if (!instance_type || !instance_type->dec || is_builtin_type(instance_type)) {
+        return NULL;
+    }
+
+    char* method_name = delete_underscore_from_str(
+        node->data.op_node.right->data.func_node.name, instance_type->name
+    );
+    ASTNode* found = NULL;
+
+    for (Type* current = instance_type; !found && current && current->dec && !is_builtin_type(current); current = current->parent) {
+        char name[256];
+        snprintf(name, sizeof(name), "_%s_%s", current->name, method_name);
+        ASTNode* type_def = current->dec;
+        for (int i = 0; i < type_def->data.type_node.def_count; i++) {
+            ASTNode* def = type_def->data.type_node.definitions[i];
+            if (def->type == NODE_FUNC_DEC && !strcmp(def->data.func_node.name, name)) {
+                found = def;
+                *owner = current;
+                break;
+            }
+        }
+    }
+
+    free(method_name);
+    return found && (found->flags & FLAG_INLINE) ? found : NULL;
+}
+
+// Genera el cuerpo de un método pequeño en el lugar de la llamada: sin
+// vtable, sin contador de profundidad y sin llamada
+static LLVMValueRef generate_inline_method(LLVM_Visitor* v, ASTNode* node, ASTNode* method_def, Type* owner) {
+    LLVMValueRef instance = accept_gen(v, node->data.op_node.left);
+    if (LLVMGetTypeKind(LLVMGetElementType(LLVMTypeOf(instance))) == LLVMPointerTypeKind) {
+        instance = LLVMBuildLoad2(builder, LLVMGetElementType(LLVMTypeOf(instance)), instance, "inline_instance");
+    }
+
+    // Si el método es heredado, 'self' se ve como una instancia del tipo que
+    // lo define
+    if (owner != node->data.op_node.left->return_type) {
+        instance = LLVMBuildBitCast(builder, instance, get_llvm_type(owner), "owner_instance");
+    }
+
+    // Los argumentos se evalúan en el scope de quien llama, antes de ver
+    // 'self' y los parámetros del método
+    ASTNode* call = node->data.op_node.right;
+    int arg_count = method_def->data.func_node.arg_count;
+    LLVMValueRef* values = malloc((arg_count + 1) * sizeof(LLVMValueRef));
+    for (int i = 0; i < arg_count; i++) {
+        values[i] = accept_gen(v, call->data.func_node.args[i]);
+    }
+
+    push_scope();
+    declare_variable("self", instance);
+
+    for (int i = 0; i < arg_count; i++) {
+        ASTNode* param = method_def->data.func_node.args[i];
+        bind_variable(param, param->data.variable_name, values[i], LLVMTypeOf(values[i]));
+    }
+    free(values);
+
+    LLVMValueRef result = accept_gen(v, method_def->data.func_node.body);
+    pop_scope();
+    return result;
+}
+
 LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
-    // Stack depth tracking
+    Type* owner = NULL;
+    ASTNode* inline_method = find_inline_method(node, &owner);
+    if (inline_method) {
+        return generate_inline_method(v, node, inline_method, owner);
+    }
+
+    // Stack depth tracking (con --stack-guard lo detecta la página de guarda)
     LLVMValueRef current_stack_depth_var = LLVMGetNamedGlobal(module, "current_stack_depth");
-    LLVMValueRef current_depth = LLVMBuildLoad2(builder, LLVMInt32Type(), current_stack_depth_var, "current_depth");
-    LLVMValueRef new_depth = LLVMBuildAdd(builder, current_depth, LLVMConstInt(LLVMInt32Type(), 1, 0), "new_depth");
-    LLVMBuildStore(builder, new_depth, current_stack_depth_var);
-
-    // Stack overflow check
-    LLVMValueRef cmp = LLVMBuildICmp(builder, LLVMIntSGT,
-                                     new_depth, LLVMConstInt(LLVMInt32Type(), MAX_STACK_DEPTH, 0),
-                                     "cmp_overflow_call");
-
-    // Create basic blocks for overflow handling
-    LLVMBasicBlockRef current_bb = LLVMGetInsertBlock(builder);
-    LLVMValueRef current_func = LLVMGetBasicBlockParent(current_bb);
-    LLVMBasicBlockRef error_block = LLVMAppendBasicBlock(current_func, "stack_overflow_call");
-    LLVMBasicBlockRef call_block = LLVMAppendBasicBlock(current_func, "method_call_body");
-
-    LLVMBuildCondBr(builder, cmp, error_block, call_block);
-
-    LLVMPositionBuilderAtEnd(builder, error_block);
-    handle_stack_overflow(
-        builder, module, current_stack_depth_var, node->line,
-        node->data.op_node.right->data.func_node.name
-    );
-    
-    LLVMPositionBuilderAtEnd(builder, call_block);
+    LLVMValueRef current_depth = NULL;
+    if (!stack_guard) {
+        current_depth = LLVMBuildLoad2(builder, LLVMInt32Type(), current_stack_depth_var, "current_depth");
+        LLVMValueRef new_depth = LLVMBuildAdd(builder, current_depth, LLVMConstInt(LLVMInt32Type(), 1, 0), "new_depth");
+        LLVMBuildStore(builder, new_depth, current_stack_depth_var);
+
+        // Stack overflow check
+        LLVMValueRef cmp = LLVMBuildICmp(builder, LLVMIntSGT,
+                                         new_depth, LLVMConstInt(LLVMInt32Type(), MAX_STACK_DEPTH, 0),
+                                         "cmp_overflow_call");
+
+        // Create basic blocks for overflow handling
+        LLVMBasicBlockRef current_bb = LLVMGetInsertBlock(builder);
+        LLVMValueRef current_func = LLVMGetBasicBlockParent(current_bb);
+        LLVMBasicBlockRef error_block = LLVMAppendBasicBlock(current_func, "stack_overflow_call");
+        LLVMBasicBlockRef call_block = LLVMAppendBasicBlock(current_func, "method_call_body");
+
+        LLVMBuildCondBr(builder, cmp, error_block, call_block);
+
+        LLVMPositionBuilderAtEnd(builder, error_block);
+        build_stack_overflow_error(node->data.op_node.right->data.func_node.name, node->line);
+        
+        LLVMPositionBuilderAtEnd(builder, call_block);
+    }
 
     // Get instance and method info
     LLVMValueRef instance_ptr = accept_gen(v, node->data.op_node.left);
@@ -1314,7 +1866,7 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
     Type* method_class = NULL;
     // snprintf(mangled_name, sizeof(mangled_name), "_%s_%s", instance_type->name, method_name);
     
-    if (LLVMGetNamedFunction(module, method_name)) {
+    if (find_method_slot(instance_type, method_name) >= 0) {
         method_class = instance_type;
         printf("Debug: Found method %s directly in type %s\n", method_name, instance_type->name);
     } else {
@@ -1331,7 +1883,7 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
                 snprintf(parent_method, sizeof(parent_method), "_%s_%s", current_type->name, base_method);
                 printf("Debug: Looking for method %s in parent type %s\n", parent_method, current_type->name);
                 
-                if (LLVMGetNamedFunction(module, parent_method)) {
+                if (find_method_slot(current_type, parent_method) >= 0) {
                     method_class = current_type;
                     method_name = strdup(parent_method);
                     printf("Debug: Found method %s in parent type %s\n", method_name, current_type->name);
@@ -1356,23 +1908,13 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
         return NULL;
     }
 
-    // If the method is in a different class than the instance type, we need to get the parent instance
+    // If the method is in a parent class, the instance starts with its layout
     if (method_class != instance_type) {
-        printf("Debug: Method is in parent class %s, getting parent instance\n", method_class->name);
-        // First get the current instance
-        LLVMValueRef current_instance;
         if (LLVMGetTypeKind(LLVMTypeOf(target_instance)) == LLVMPointerTypeKind &&
             LLVMGetTypeKind(LLVMGetElementType(LLVMTypeOf(target_instance))) == LLVMPointerTypeKind) {
-            current_instance = LLVMBuildLoad2(builder, LLVMGetElementType(LLVMTypeOf(target_instance)), target_instance, "loaded_instance");
-        } else {
-            current_instance = target_instance;
+            target_instance = LLVMBuildLoad2(builder, LLVMGetElementType(LLVMTypeOf(target_instance)), target_instance, "loaded_instance");
         }
-
-        // Get the parent instance pointer (at index 2)
-        LLVMTypeRef current_struct = LLVMGetTypeByName(module, instance_type->name);
-        LLVMValueRef parent_ptr = LLVMBuildStructGEP2(builder, current_struct, current_instance, 2, "parent_ptr");
-        target_instance = LLVMBuildLoad2(builder, LLVMPointerType(source_struct, 0), parent_ptr, "parent_instance");
-        printf("Debug: Got parent instance of type %s\n", method_class->name);
+        target_instance = LLVMBuildBitCast(builder, target_instance, LLVMPointerType(source_struct, 0), "parent_instance");
     }
     
     // Use the target instance (either original or parent)
@@ -1400,26 +1942,18 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
     // Print struct layout
     printf("Debug: Source struct type: %s\n", LLVMPrintTypeToString(source_struct));
     
-    // Get vtable pointer from instance (using the correct type's vtable)
+    // Get vtable pointer from instance: the whole header. The instance may
+    // be of a descendant, whose vtable starts like this type's
     LLVMValueRef vtable_ptr_ptr = LLVMBuildStructGEP2(builder, 
                                                       source_struct,
                                                       instance,
-                                                      1,  // vtable pointer is at index 1
+                                                      0,  // vtable pointer is at index 0
                                                       "vtable_ptr_ptr");
     printf("Debug: vtable_ptr_ptr: %s\n", LLVMPrintValueToString(vtable_ptr_ptr));
     
-    // Get the actual vtable global (using the method class's vtable)
-    char vtable_instance_name[256];
-    snprintf(vtable_instance_name, sizeof(vtable_instance_name), "%s_vtable_instance", method_class->name);
-    LLVMValueRef vtable_global = LLVMGetNamedGlobal(module, vtable_instance_name);
-    if (!vtable_global) {
-        printf("Error: Could not find vtable instance %s\n", vtable_instance_name);
-        return NULL;
-    }
-    printf("Debug: Found vtable global: %s\n", LLVMPrintValueToString(vtable_global));
-    
-    // Load vtable pointer
-    LLVMValueRef vtable_ptr = LLVMBuildLoad2(builder, LLVMTypeOf(vtable_global), vtable_ptr_ptr, "vtable_ptr");
+    // Load vtable pointer (typed as the method class's vtable)
+    LLVMTypeRef vtable_ptr_type = LLVMStructGetTypeAtIndex(source_struct, 0);
+    LLVMValueRef vtable_ptr = LLVMBuildLoad2(builder, vtable_ptr_type, vtable_ptr_ptr, "vtable_ptr");
     printf("Debug: vtable_ptr loaded: %s\n", LLVMPrintValueToString(vtable_ptr));
 
     // Get method from vtable
@@ -1428,21 +1962,10 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
     snprintf(method_mangled_name, sizeof(method_mangled_name), "%s_%s", method_class->name, method_name);
     printf("Debug: Looking for method: %s\n", method_mangled_name);
     
-    // Find method index in vtable
-    int method_index = -1;
-    int current_method_index = 0;  // Solo contar métodos, no campos
+    // Find method index in vtable (the same in every descendant's vtable)
     ASTNode* class_def = method_class->dec;
-    for (int i = 0; i < class_def->data.type_node.def_count; i++) {
-        ASTNode* def = class_def->data.type_node.definitions[i];
-        if (def->type == NODE_FUNC_DEC) {
-            if (strcmp(def->data.func_node.name, method_name) == 0) {
-                method_index = current_method_index;
-                printf("Debug: Found method %s at index %d in vtable\n", method_name, method_index);
-                break;
-            }
-            current_method_index++;  // Incrementar solo cuando encontramos un método
-        }
-    }
+    int method_index = find_method_slot(method_class, method_name);
+    printf("Debug: Found method %s at index %d in vtable\n", method_name, method_index);
 
     if (method_index >= 0) {
         printf("Debug: Accessing method at index %d in vtable\n", method_index);
@@ -1487,7 +2010,7 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
             param_types[i + 1] = get_llvm_type(method_def->data.func_node.args[i]->return_type);
         }
         
-        LLVMTypeRef return_type = get_llvm_type(method_def->return_type);
+        LLVMTypeRef return_type = method_return_type(method_def);
         if (!return_type) return_type = LLVMVoidType();
         
         LLVMTypeRef func_type = LLVMFunctionType(return_type, param_types, param_count, 0);
@@ -1495,7 +2018,12 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
         
         printf("Debug: Function type created: %s\n", LLVMPrintTypeToString(func_ptr_type));
         
-        method = LLVMBuildLoad2(builder, func_ptr_type, func_ptr_ptr, "method_ptr");
+        // The slot keeps the type of the ancestor that declared the method
+        LLVMTypeRef slot_type = LLVMGetElementType(LLVMTypeOf(func_ptr_ptr));
+        method = LLVMBuildLoad2(builder, slot_type, func_ptr_ptr, "method_ptr");
+        if (slot_type != func_ptr_type) {
+            method = LLVMBuildBitCast(builder, method, func_ptr_type, "method");
+        }
         free(param_types);
         printf("Debug: method ptr loaded: %s\n", LLVMPrintValueToString(method));
     } else {
@@ -1538,12 +2066,14 @@ LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node) {
         result = NULL;
     } else {
         // For methods that return a value, use LLVMBuildCall2 and assign a name
-        result = LLVMBuildCall2(builder, func_type, method, call_args, arg_count + 1, "call_result");
+        result = LLVMBuildCall2(builder, actual_func_type, method, call_args, arg_count + 1, "call_result");
     }
     free(call_args);
     
     // Restore stack depth
-    LLVMBuildStore(builder, current_depth, current_stack_depth_var);
+    if (current_depth) {
+        LLVMBuildStore(builder, current_depth, current_stack_depth_var);
+    }
 
     return result;
 }
@@ -1593,11 +2123,83 @@ LLVMValueRef generate_test_type(LLVM_Visitor* v, ASTNode* node) {
         return LLVMConstInt(LLVMInt1Type(), 0, 0);
     }
 
+    if (type_equals(dynamic_type, &TYPE_OBJECT)) {
+        // El tipo de un Object está en su etiqueta
+        return build_tag_test(exp, test_type);
+    }
+
+    if (!is_builtin_type(dynamic_type) && !is_builtin_type(test_type) &&
+        !is_ancestor_type(test_type, dynamic_type) && is_ancestor_type(dynamic_type, test_type)) {
+        // Un descendiente del tipo estático: lo dice el id de la instancia
+        return build_instance_type_test(exp, test_type);
+    }
+
     int is_descendant = same_branch_in_type_hierarchy(dynamic_type, test_type);
     
     return LLVMConstInt(LLVMInt1Type(), is_descendant, 0);
 }
 
+// Convierte un Object al tipo 'to_type' si su etiqueta lo permite; si no,
+// termina el programa con un error
+static LLVMValueRef build_object_cast(LLVMValueRef boxed, Type* to_type, int line) {
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMBasicBlockRef fail_block = LLVMAppendBasicBlock(current_function, "cast.fail");
+    LLVMBasicBlockRef ok_block = LLVMAppendBasicBlock(current_function, "cast.ok");
+    LLVMBuildCondBr(builder, build_tag_test(boxed, to_type), ok_block, fail_block);
+
+    LLVMPositionBuilderAtEnd(builder, fail_block);
+    build_cast_error(get_global_string("Object", "type_name"), to_type->name, line);
+
+    LLVMPositionBuilderAtEnd(builder, ok_block);
+    return unbox_value(boxed, to_type);
+}
+
+// Convierte una instancia al tipo descendiente 'to_type' si su id está en
+// el intervalo del tipo; si no, termina el programa con un error que
+// nombra su tipo dinámico
+static LLVMValueRef build_downcast(LLVMValueRef instance, Type* to_type, int line) {
+    if (LLVMGetTypeKind(LLVMGetElementType(LLVMTypeOf(instance))) == LLVMPointerTypeKind) {
+        instance = LLVMBuildLoad2(builder, LLVMGetElementType(LLVMTypeOf(instance)), instance, "instance");
+    }
+
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMValueRef is_type = build_instance_type_test(instance, to_type);
+    LLVMBasicBlockRef fail_block = LLVMAppendBasicBlock(current_function, "cast.fail");
+    LLVMBasicBlockRef ok_block = LLVMAppendBasicBlock(current_function, "cast.ok");
+    LLVMBuildCondBr(builder, is_type, ok_block, fail_block);
+
+    // El nombre del tipo dinámico está en la vtable (una instancia nula no tiene)
+    LLVMPositionBuilderAtEnd(builder, fail_block);
+    LLVMBasicBlockRef name_block = LLVMAppendBasicBlock(current_function, "cast.type_name");
+    LLVMBasicBlockRef report_block = LLVMAppendBasicBlock(current_function, "cast.report");
+    LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, instance, "is_null"), report_block, name_block);
+
+    LLVMPositionBuilderAtEnd(builder, name_block);
+    LLVMValueRef name_ptr = LLVMBuildStructGEP2(builder, get_type_info_type(),
+        get_dynamic_type_info(instance), 2, "type_name_ptr");
+    LLVMValueRef dynamic_name = LLVMBuildLoad2(builder, LLVMPointerType(LLVMInt8Type(), 0), name_ptr, "type_name");
+    LLVMBuildBr(builder, report_block);
+
+    LLVMPositionBuilderAtEnd(builder, report_block);
+    LLVMValueRef type_name = LLVMBuildPhi(builder, LLVMPointerType(LLVMInt8Type(), 0), "type_name");
+    LLVMValueRef names[] = { get_global_string("Null", "type_name"), dynamic_name };
+    LLVMBasicBlockRef blocks[] = { fail_block, name_block };
+    LLVMAddIncoming(type_name, names, blocks, 2);
+    build_cast_error(type_name, to_type->name, line);
+
+    LLVMPositionBuilderAtEnd(builder, ok_block);
+    return LLVMBuildBitCast(builder, instance, get_llvm_type(to_type), "downcast");
+}
+
+// Conversión que siempre falla: termina el programa y el código que sigue
+// queda en un bloque inalcanzable
+static LLVMValueRef build_static_cast_error(Type* from_type, Type* to_type, const char* to_name, int line) {
+    build_cast_error(get_global_string(from_type->name, "type_name"), to_name, line);
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(current_function, "cast.dead"));
+    return LLVMConstNull(get_llvm_type(to_type));
+}
+
 LLVMValueRef generate_cast_type(LLVM_Visitor* v, ASTNode* node) {
     LLVMValueRef exp = accept_gen(v, node->data.op_node.left);
     Type* from_type = node->data.op_node.left->return_type;
@@ -1605,39 +2207,29 @@ LLVMValueRef generate_cast_type(LLVM_Visitor* v, ASTNode* node) {
     const char* type_name = node->static_type;
     Type* to_type = node->return_type;
 
+    if (type_equals(from_type, &TYPE_OBJECT) && !type_equals(to_type, &TYPE_OBJECT)) {
+        return build_object_cast(exp, to_type, node->line);
+    }
+
+    if (!is_builtin_type(from_type) && !is_builtin_type(to_type)) {
+        if (is_ancestor_type(to_type, from_type)) {
+            // Hacia un ancestro: la instancia empieza con su disposición
+            return coerce_argument(exp, get_llvm_type(to_type));
+        }
+        if (is_ancestor_type(from_type, to_type)) {
+            return build_downcast(exp, to_type, node->line);
+        }
+    }
+
     if(!is_ancestor_type(from_type, to_type)|| !is_ancestor_type(to_type,from_type)) {
         printf("Casting from type '%s' to type '%s'\n", 
             from_type->name, to_type->name);
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg),
-            RED"!!RUNTIME ERROR: Type '%s' cannot be cast to type '%s'. Line: %d."RESET,
-            from_type->name, to_type->name, node->line);
-
-        LLVMValueRef error_msg_global = LLVMBuildGlobalStringPtr(builder, error_msg, "error_msg");
-        LLVMValueRef puts_func = LLVMGetNamedFunction(module, "puts");
-        LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(puts_func)), puts_func, &error_msg_global, 1, "");
-        return LLVMConstNull(get_llvm_type(to_type));
+        return build_static_cast_error(from_type, to_type, to_type->name, node->line);
     }
     else if (!same_branch_in_type_hierarchy(from_type, to_type)) {
         printf("Error: Cannot cast type '%s' to '%s' at line %d\n", 
             from_type->name, type_name, node->line);
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg),
-            RED"!!RUNTIME ERROR: Type '%s' cannot be cast to type '%s'. Line: %d."RESET,
-            from_type->name, type_name, node->line);
-
-        LLVMValueRef error_msg_global = LLVMBuildGlobalStringPtr(builder, error_msg, "error_msg");
-        LLVMValueRef puts_func = LLVMGetNamedFunction(module, "puts");
-        LLVMTypeRef puts_type = LLVMFunctionType(LLVMInt32Type(), (LLVMTypeRef[]){LLVMPointerType(LLVMInt8Type(), 0)}, 1, 0);
-        LLVMBuildCall2(builder, puts_type, puts_func, &error_msg_global, 1, "");
-
-        LLVMValueRef exit_func = LLVMGetNamedFunction(module, "exit");
-        LLVMValueRef exit_code = LLVMConstInt(LLVMInt32Type(), 1, 0);
-        LLVMBuildCall(builder, exit_func, &exit_code, 1, 0);
-
-        LLVMBuildUnreachable(builder);
-
-        return LLVMConstNull(get_llvm_type(to_type));
+        return build_static_cast_error(from_type, to_type, type_name, node->line);
     }
 
     return cast_value_to_type(exp, from_type, to_type);
@@ -7,6 +7,7 @@
 typedef struct TypeIDMap {
     char* type_name;
     int id;
+    int last_descendant;        // los descendientes tienen ids en (id, last_descendant]
     struct TypeIDMap* next;
 } TypeIDMap;
 
@@ -35,6 +36,10 @@ LLVMValueRef generate_q_conditional(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef generate_loop(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef cast_value_to_type(LLVMValueRef value, Type* from_type, Type* to_type);
 
+// i1: si la instancia (que puede ser nula) es de ese tipo o de un
+// descendiente, según el id guardado en su vtable
+LLVMValueRef build_instance_type_test(LLVMValueRef instance, Type* type);
+
 // Type-related codegen functions
 LLVMValueRef generate_type_declaration(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef generate_type_instance(LLVM_Visitor* v, ASTNode* node);
@@ -43,6 +48,5 @@ LLVMValueRef generate_set_attr(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef generate_method_call(LLVM_Visitor* v, ASTNode* node);
 LLVMValueRef generate_test_type(LLVM_Visitor* v, ASTNode* node); // is operator
 LLVMValueRef generate_cast_type(LLVM_Visitor* v, ASTNode* node); // as operator
-static int find_field_index(Type* type, const char* field_name);
 
 #endif // LLVM_CODEGEN_H
\ No newline at end of file
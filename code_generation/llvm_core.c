@@ -1,6 +1,8 @@
 #include "llvm_core.h"
+#include "llvm_gc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 LLVMModuleRef module;
 LLVMBuilderRef builder;
@@ -9,6 +11,109 @@ LLVMValueRef current_stack_depth_var;
 LLVMTypeRef object_type;
 const int MAX_STACK_DEPTH = 10000;
 
+// Pool de constantes string del módulo, indexado por contenido
+#define STRING_POOL_SIZE 1024
+
+typedef struct StringPoolEntry {
+    char* value;
+    int prefixed;
+    LLVMValueRef ptr;
+    struct StringPoolEntry* next;
+} StringPoolEntry;
+
+static StringPoolEntry* string_pool[STRING_POOL_SIZE];
+
+static unsigned long hash_string(const char* str) {
+    unsigned long hash = 5381;
+    for (; *str; str++) {
+        hash = ((hash << 5) + hash) + (unsigned char)*str;
+    }
+    return hash % STRING_POOL_SIZE;
+}
+
+static void clear_string_pool(void) {
+    for (int i = 0; i < STRING_POOL_SIZE; i++) {
+        StringPoolEntry* entry = string_pool[i];
+        while (entry) {
+            StringPoolEntry* next = entry->next;
+            free(entry->value);
+            free(entry);
+            entry = next;
+        }
+        string_pool[i] = NULL;
+    }
+}
+
+// Busca o crea la constante. Con 'prefixed' el global es { i64, i64, [n x i8] }:
+// capacidad (0, no se puede ampliar) y longitud delante de los caracteres,
+// como en los strings de HULK. Con el recolector activo lleva además una
+// cabecera de bloque ya marcada, que el recolector nunca libera
+static LLVMValueRef pooled_string(const char* value, const char* name, int prefixed) {
+    unsigned long index = hash_string(value);
+    for (StringPoolEntry* entry = string_pool[index]; entry; entry = entry->next) {
+        if (entry->prefixed == prefixed && strcmp(entry->value, value) == 0) {
+            return entry->ptr;
+        }
+    }
+
+    // Crear el global una sola vez: constante privada y sin dirección relevante
+    size_t length = strlen(value);
+    LLVMValueRef init = LLVMConstStringInContext(context, value, length, 0);
+    unsigned chars_index = 0;
+    if (prefixed) {
+        LLVMTypeRef i8_ptr = LLVMPointerType(LLVMInt8Type(), 0);
+        LLVMValueRef fields[7];
+        if (garbage_collection) {
+            fields[chars_index++] = LLVMConstNull(i8_ptr);
+            fields[chars_index++] = LLVMConstNull(i8_ptr);
+            fields[chars_index++] = LLVMConstInt(LLVMInt64Type(), 0, 0);
+            fields[chars_index++] = LLVMConstInt(LLVMInt64Type(), 1, 0);
+        }
+        fields[chars_index++] = LLVMConstInt(LLVMInt64Type(), 0, 0);
+        fields[chars_index++] = LLVMConstInt(LLVMInt64Type(), length, 0);
+        fields[chars_index] = init;
+        init = LLVMConstStructInContext(context, fields, chars_index + 1, 0);
+    }
+    LLVMValueRef global = LLVMAddGlobal(module, LLVMTypeOf(init), name);
+    LLVMSetInitializer(global, init);
+    LLVMSetGlobalConstant(global, 1);
+    LLVMSetLinkage(global, LLVMPrivateLinkage);
+    LLVMSetUnnamedAddress(global, LLVMGlobalUnnamedAddr);
+    LLVMSetAlignment(global, prefixed ? 8 : 1);
+
+    // Puntero i8* al primer carácter, válido fuera de cualquier función
+    LLVMValueRef zero = LLVMConstInt(LLVMInt32Type(), 0, 0);
+    LLVMValueRef ptr;
+    if (prefixed) {
+        LLVMValueRef indices[] = { zero, LLVMConstInt(LLVMInt32Type(), chars_index, 0), zero };
+        ptr = LLVMConstInBoundsGEP2(LLVMTypeOf(init), global, indices, 3);
+    } else {
+        LLVMValueRef indices[] = { zero, zero };
+        ptr = LLVMConstInBoundsGEP2(LLVMTypeOf(init), global, indices, 2);
+    }
+
+    StringPoolEntry* entry = malloc(sizeof(StringPoolEntry));
+    entry->value = strdup(value);
+    entry->prefixed = prefixed;
+    entry->ptr = ptr;
+    entry->next = string_pool[index];
+    string_pool[index] = entry;
+    return ptr;
+}
+
+LLVMValueRef get_global_string(const char* value, const char* name) {
+    return pooled_string(value, name, 0);
+}
+
+LLVMValueRef get_string_literal(const char* value) {
+    return pooled_string(value, "str", 1);
+}
+
+void add_function_attribute(LLVMValueRef func, const char* name) {
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+    LLVMAddAttributeAtIndex(func, LLVMAttributeFunctionIndex, LLVMCreateEnumAttribute(context, kind, 0));
+}
+
 void init_llvm(void) {
     LLVMInitializeNativeTarget();
     LLVMInitializeNativeAsmPrinter();
@@ -16,6 +121,7 @@ void init_llvm(void) {
     context = LLVMGetGlobalContext();
     module = LLVMModuleCreateWithNameInContext("program", context);
     builder = LLVMCreateBuilderInContext(context);
+    clear_string_pool();
 
     // Crear el tipo Object como un struct vacío
     // Esto crea un tipo nombrado "Object" en el contexto
@@ -36,6 +142,7 @@ void init_llvm(void) {
 void free_llvm_resources(void) {
     LLVMDisposeBuilder(builder);
     LLVMDisposeModule(module);
+    clear_string_pool();
     current_stack_depth_var = NULL;
 }
 
@@ -58,11 +165,14 @@ void declare_external_functions(void) {
     // Funciones matemáticas
     LLVMTypeRef double_func_type = LLVMFunctionType(LLVMDoubleType(),
         (LLVMTypeRef[]){LLVMDoubleType()}, 1, 0);
-    LLVMAddFunction(module, "sqrt", double_func_type);
-    LLVMAddFunction(module, "sin", double_func_type);
-    LLVMAddFunction(module, "cos", double_func_type);
-    LLVMAddFunction(module, "exp", double_func_type);
-    LLVMAddFunction(module, "log", double_func_type);
+    // HULK nunca lee errno, así que solo dependen de su argumento
+    const char* math_functions[] = { "sqrt", "sin", "cos", "exp", "log" };
+    for (int i = 0; i < 5; i++) {
+        LLVMValueRef math_func = LLVMAddFunction(module, math_functions[i], double_func_type);
+        add_function_attribute(math_func, "readnone");
+        add_function_attribute(math_func, "nounwind");
+        add_function_attribute(math_func, "willreturn");
+    }
     
     // Otras funciones estándar
     LLVMTypeRef rand_type = LLVMFunctionType(LLVMInt32Type(), NULL, 0, 0);
@@ -7,6 +7,7 @@
 #include <llvm-c/Analysis.h>
 #include <llvm-c/BitWriter.h>
 #include "ast/ast.h"
+#include "llvm_output.h"
 
 #define RED     "\x1B[31m"
 #define RESET   "\x1B[0m"
@@ -22,29 +23,15 @@ void init_llvm(void);
 void free_llvm_resources(void);
 void declare_external_functions(void);
 
-static inline void handle_stack_overflow(
-    LLVMBuilderRef builder, LLVMModuleRef module, 
-    LLVMValueRef current_stack_depth_var, int line, char* name
-) {
-    // Construir mensaje de error con nombre de función y línea
-    char error_msg[256];
-    snprintf(error_msg, sizeof(error_msg), 
-    RED"!!RUNTIME ERROR: Stack overflow detected in function '%s'. Line: %d.\n" RESET,
-    name, line);
-
-    LLVMValueRef error_msg_global = LLVMBuildGlobalStringPtr(builder, error_msg, "error_msg");
-
-    // Llamar a puts para imprimir el mensaje
-    LLVMValueRef puts_func = LLVMGetNamedFunction(module, "puts");
-    LLVMBuildCall(builder, puts_func, &error_msg_global, 1, "");
-
-    // Llamar a exit(1)
-    LLVMValueRef exit_func = LLVMGetNamedFunction(module, "exit");
-    LLVMValueRef exit_code = LLVMConstInt(LLVMInt32Type(), 0, 0);
-    LLVMBuildCall(builder, exit_func, &exit_code, 1, "");
-
-    // Marcar como unreachable
-    LLVMBuildUnreachable(builder);
-}
+// Devuelve un i8* a una constante global con ese contenido, reutilizando
+// la existente si el string ya fue emitido
+LLVMValueRef get_global_string(const char* value, const char* name);
+
+// Igual que get_global_string pero para valores String de HULK: la constante
+// lleva su cabecera (capacidad 0 y longitud) justo antes del primer carácter
+LLVMValueRef get_string_literal(const char* value);
+
+// Añade a la función un atributo de LLVM sin valor (nounwind, readnone...)
+void add_function_attribute(LLVMValueRef func, const char* name);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "llvm_errors.h"
+#include "llvm_core.h"
+#include <stdlib.h>
+#include <string.h>
+
+static LLVMValueRef stack_overflow_func = NULL;
+static LLVMValueRef cast_error_func = NULL;
+
+// Nombres de las funciones que pueden desbordar la pila: la llamada de
+// error pasa el índice en esta tabla en vez de su propio mensaje
+static char** function_names = NULL;
+static int function_count = 0;
+
+static LLVMTypeRef i8_ptr_type(void) {
+    return LLVMPointerType(LLVMInt8Type(), 0);
+}
+
+static LLVMValueRef i32_const(int value) {
+    return LLVMConstInt(LLVMInt32Type(), value, 0);
+}
+
+static LLVMValueRef call_function(LLVMValueRef func, LLVMValueRef* args, unsigned count) {
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func, args, count, "");
+}
+
+static LLVMValueRef declare_error_function(const char* name, LLVMTypeRef* params, unsigned count) {
+    LLVMValueRef func = LLVMAddFunction(module, name,
+        LLVMFunctionType(LLVMVoidType(), params, count, 0));
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    add_function_attribute(func, "cold");
+    add_function_attribute(func, "noinline");
+    add_function_attribute(func, "noreturn");
+    add_function_attribute(func, "nounwind");
+    return func;
+}
+
+static int function_name_id(const char* name) {
+    for (int i = 0; i < function_count; i++) {
+        if (!strcmp(function_names[i], name)) {
+            return i;
+        }
+    }
+    function_names = realloc(function_names, sizeof(char*) * (function_count + 1));
+    function_names[function_count] = strdup(name);
+    return function_count++;
+}
+
+// Llama a la función de error y cierra el bloque: no se vuelve de ella
+static void build_error_call(LLVMValueRef func, LLVMValueRef* args, unsigned count) {
+    call_function(func, args, count);
+    LLVMBuildUnreachable(builder);
+}
+
+void build_stack_overflow_error(const char* name, int line) {
+    if (!stack_overflow_func) {
+        stack_overflow_func = declare_error_function("hulk_stack_overflow_error",
+            (LLVMTypeRef[]){ LLVMInt32Type(), LLVMInt32Type() }, 2);
+    }
+    build_error_call(stack_overflow_func,
+        (LLVMValueRef[]){ i32_const(function_name_id(name)), i32_const(line) }, 2);
+}
+
+void build_cast_error(LLVMValueRef from, const char* to_name, int line) {
+    if (!cast_error_func) {
+        cast_error_func = declare_error_function("hulk_cast_error",
+            (LLVMTypeRef[]){ i8_ptr_type(), i8_ptr_type(), LLVMInt32Type() }, 3);
+    }
+    build_error_call(cast_error_func,
+        (LLVMValueRef[]){ from, get_global_string(to_name, "type_name"), i32_const(line) }, 3);
+}
+
+// Vuelca la salida pendiente, imprime el mensaje con printf y termina
+static void build_report(const char* format, LLVMValueRef* args, unsigned count, int exit_code) {
+    build_output_flush();
+    LLVMValueRef* printf_args = malloc(sizeof(LLVMValueRef) * (count + 1));
+    printf_args[0] = get_global_string(format, "error_msg");
+    for (unsigned i = 0; i < count; i++) {
+        printf_args[i + 1] = args[i];
+    }
+    call_function(LLVMGetNamedFunction(module, "printf"), printf_args, count + 1);
+    free(printf_args);
+
+    LLVMValueRef code = i32_const(exit_code);
+    call_function(LLVMGetNamedFunction(module, "exit"), &code, 1);
+    LLVMBuildUnreachable(builder);
+}
+
+// void hulk_stack_overflow_error(i32 function_id, i32 line)
+static void define_stack_overflow_error(void) {
+    LLVMTypeRef table_type = LLVMArrayType(i8_ptr_type(), function_count);
+    LLVMValueRef* names = malloc(sizeof(LLVMValueRef) * function_count);
+    for (int i = 0; i < function_count; i++) {
+        names[i] = get_global_string(function_names[i], "func_name");
+    }
+    LLVMValueRef table = LLVMAddGlobal(module, table_type, "hulk_function_names");
+    LLVMSetInitializer(table, LLVMConstArray(i8_ptr_type(), names, function_count));
+    LLVMSetGlobalConstant(table, 1);
+    LLVMSetLinkage(table, LLVMPrivateLinkage);
+    free(names);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(stack_overflow_func, "entry"));
+    LLVMValueRef name_ptr = LLVMBuildGEP2(builder, table_type, table,
+        (LLVMValueRef[]){ i32_const(0), LLVMGetParam(stack_overflow_func, 0) }, 2, "name_ptr");
+    LLVMValueRef name = LLVMBuildLoad2(builder, i8_ptr_type(), name_ptr, "name");
+    build_report(RED"!!RUNTIME ERROR: Stack overflow detected in function '%s'. Line: %d.\n"RESET"\n",
+        (LLVMValueRef[]){ name, LLVMGetParam(stack_overflow_func, 1) }, 2, 0);
+}
+
+// void hulk_cast_error(i8* from, i8* to, i32 line)
+static void define_cast_error(void) {
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(cast_error_func, "entry"));
+    build_report(RED"!!RUNTIME ERROR: Type '%s' cannot be cast to type '%s'. Line: %d."RESET"\n",
+        (LLVMValueRef[]){
+            LLVMGetParam(cast_error_func, 0), LLVMGetParam(cast_error_func, 1), LLVMGetParam(cast_error_func, 2)
+        }, 3, 1);
+}
+
+void finalize_runtime_errors(void) {
+    if (stack_overflow_func) {
+        define_stack_overflow_error();
+    }
+    if (cast_error_func) {
+        define_cast_error();
+    }
+
+    for (int i = 0; i < function_count; i++) {
+        free(function_names[i]);
+    }
+    free(function_names);
+    function_names = NULL;
+    function_count = 0;
+    stack_overflow_func = NULL;
+    cast_error_func = NULL;
+}
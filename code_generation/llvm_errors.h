@@ -0,0 +1,25 @@
+#ifndef LLVM_ERRORS_H
+#define LLVM_ERRORS_H
+
+#include <llvm-c/Core.h>
+
+// Los errores en tiempo de ejecución se reportan con funciones compartidas
+// (cold, noinline, noreturn): el código que puede fallar solo lleva la
+// comparación y un salto a un bloque con la llamada, y el mensaje se arma
+// una sola vez en el módulo
+
+// Termina el programa con el error de desbordamiento de la pila de la
+// función 'name' (declarada en la línea 'line'). Deja el bloque actual
+// terminado en unreachable
+void build_stack_overflow_error(const char* name, int line);
+
+// Termina el programa con el error de conversión del tipo 'from' (un i8*
+// con su nombre) al tipo 'to_name'. Deja el bloque actual terminado en
+// unreachable
+void build_cast_error(LLVMValueRef from, const char* to_name, int line);
+
+// Emite la tabla de nombres de funciones y los cuerpos de las funciones de
+// error que se usaron (antes de escribir el módulo)
+void finalize_runtime_errors(void);
+
+#endif // LLVM_ERRORS_H
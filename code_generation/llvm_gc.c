@@ -0,0 +1,746 @@
+#include "llvm_gc.h"
+#include "llvm_core.h"
+#include "llvm_string.h"
+#include "llvm_tagged.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int garbage_collection = 0;
+int gc_statistics = 0;
+
+// Recolector mark-sweep preciso. Todos los bloques del heap forman una
+// lista enlazada a través de su cabecera. Las raíces son:
+//  - la pila de raíces (shadow stack): direcciones de las variables que
+//    guardan punteros del heap, registradas al entrar a cada función
+//  - la pila de temporales: bloques reservados (y valores devueltos) en el
+//    marco actual que todavía no se guardaron en una variable
+// Cada entrada es { i8* puntero, i64 offset }: el offset es la distancia
+// entre el valor y el inicio de su bloque (16 para los strings, que apuntan
+// a sus caracteres, y 0 para las instancias). Los Object guardan un valor
+// etiquetado: su entrada lleva GC_TAGGED_OFFSET y se decodifica al marcarla
+
+// Ningún bloque tiene un valor a esta distancia de su inicio
+#define GC_TAGGED_OFFSET 1
+
+typedef struct GCStack {
+    LLVMValueRef data;      // GCEntry*
+    LLVMValueRef count;     // i64
+    LLVMValueRef capacity;  // i64
+    LLVMValueRef push;      // void (i8*, i64)
+} GCStack;
+
+static LLVMTypeRef header_type;
+static LLVMTypeRef entry_type;
+
+static GCStack roots;
+static GCStack temps;
+static GCStack gray;    // bloques marcados cuyos punteros falta recorrer
+
+static LLVMValueRef gc_blocks;
+static LLVMValueRef free_lists;     // bloques libres por clase de tamaño
+static LLVMValueRef heap_bytes;
+static LLVMValueRef threshold;
+static LLVMValueRef collections;
+static LLVMValueRef allocated_bytes;
+static LLVMValueRef peak_bytes;
+static LLVMValueRef pause_total;
+static LLVMValueRef pause_max;
+
+static GCFrame current_frame;
+
+static LLVMTypeRef i8_ptr_type(void) {
+    return LLVMPointerType(LLVMInt8Type(), 0);
+}
+
+static LLVMValueRef i64_const(long long value) {
+    return LLVMConstInt(LLVMInt64Type(), value, 1);
+}
+
+static LLVMValueRef call_function(LLVMValueRef func, LLVMValueRef* args, unsigned count, const char* tmp) {
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func, args, count, tmp);
+}
+
+static LLVMValueRef declare_libc(const char* name, LLVMTypeRef type) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, name);
+    return func ? func : LLVMAddFunction(module, name, type);
+}
+
+static LLVMValueRef add_private_global(const char* name, LLVMTypeRef type, LLVMValueRef init) {
+    LLVMValueRef global = LLVMAddGlobal(module, type, name);
+    LLVMSetInitializer(global, init);
+    LLVMSetLinkage(global, LLVMPrivateLinkage);
+    return global;
+}
+
+static LLVMValueRef add_counter(const char* name, long long init) {
+    return add_private_global(name, LLVMInt64Type(), i64_const(init));
+}
+
+static LLVMValueRef load_i64(LLVMValueRef global, const char* name) {
+    return LLVMBuildLoad2(builder, LLVMInt64Type(), global, name);
+}
+
+static void increment(LLVMValueRef global, LLVMValueRef amount) {
+    LLVMValueRef value = load_i64(global, "");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, value, amount, ""), global);
+}
+
+static LLVMValueRef build_max(LLVMValueRef a, LLVMValueRef b, const char* name) {
+    return LLVMBuildSelect(builder, LLVMBuildICmp(builder, LLVMIntSGT, a, b, ""), a, b, name);
+}
+
+static LLVMValueRef header_of(LLVMValueRef block) {
+    LLVMValueRef header = LLVMBuildGEP2(builder, LLVMInt8Type(), block,
+        (LLVMValueRef[]){i64_const(-GC_HEADER_SIZE)}, 1, "header_raw");
+    return LLVMBuildBitCast(builder, header, LLVMPointerType(header_type, 0), "header");
+}
+
+static LLVMValueRef header_field(LLVMValueRef header, unsigned index, const char* name) {
+    return LLVMBuildStructGEP2(builder, header_type, header, index, name);
+}
+
+// Distancia entre un valor de ese tipo y el inicio de su bloque, o -1 si
+// el tipo no es un puntero del heap
+static long long value_offset(LLVMTypeRef type) {
+    if (LLVMGetTypeKind(type) != LLVMPointerTypeKind) {
+        return -1;
+    }
+
+    LLVMTypeRef pointee = LLVMGetElementType(type);
+    if (pointee == object_type) {
+        return GC_TAGGED_OFFSET;
+    }
+    if (LLVMGetTypeKind(pointee) == LLVMIntegerTypeKind && LLVMGetIntTypeWidth(pointee) == 8) {
+        return STRING_HEADER_SIZE;
+    }
+
+    if (LLVMGetTypeKind(pointee) == LLVMStructTypeKind) {
+        // las vtables son globales, no bloques del heap
+        const char* name = LLVMGetStructName(pointee);
+        size_t length = name ? strlen(name) : 0;
+        if (name && (length < 7 || strcmp(name + length - 7, "_vtable"))) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+// void hulk_gc_push_<name>(i8* ptr, i64 offset): agrega una entrada a la
+// pila, duplicando su capacidad cuando está llena
+static GCStack declare_stack(const char* name) {
+    GCStack stack;
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef data_type = LLVMPointerType(entry_type, 0);
+    char symbol[64];
+
+    snprintf(symbol, sizeof(symbol), "gc_%s", name);
+    stack.data = add_private_global(symbol, data_type, LLVMConstNull(data_type));
+    snprintf(symbol, sizeof(symbol), "gc_%s_count", name);
+    stack.count = add_counter(symbol, 0);
+    snprintf(symbol, sizeof(symbol), "gc_%s_capacity", name);
+    stack.capacity = add_counter(symbol, 0);
+
+    snprintf(symbol, sizeof(symbol), "hulk_gc_push_%s", name);
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ i8_ptr_type(), i64 }, 2, 0);
+    stack.push = LLVMAddFunction(module, symbol, func_type);
+    LLVMSetLinkage(stack.push, LLVMPrivateLinkage);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(stack.push, "entry");
+    LLVMBasicBlockRef grow_block = LLVMAppendBasicBlock(stack.push, "grow");
+    LLVMBasicBlockRef push_block = LLVMAppendBasicBlock(stack.push, "push");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef count = load_i64(stack.count, "count");
+    LLVMValueRef capacity = load_i64(stack.capacity, "capacity");
+    LLVMValueRef full = LLVMBuildICmp(builder, LLVMIntEQ, count, capacity, "full");
+    LLVMBuildCondBr(builder, full, grow_block, push_block);
+
+    LLVMPositionBuilderAtEnd(builder, grow_block);
+    LLVMValueRef empty = LLVMBuildICmp(builder, LLVMIntEQ, capacity, i64_const(0), "empty");
+    LLVMValueRef new_capacity = LLVMBuildSelect(builder, empty, i64_const(256),
+        LLVMBuildMul(builder, capacity, i64_const(2), ""), "new_capacity");
+    LLVMValueRef old_data = LLVMBuildLoad2(builder, data_type, stack.data, "old_data");
+    LLVMValueRef new_data = call_function(LLVMGetNamedFunction(module, "realloc"), (LLVMValueRef[]){
+        LLVMBuildBitCast(builder, old_data, i8_ptr_type(), ""),
+        LLVMBuildMul(builder, new_capacity, LLVMSizeOf(entry_type), "bytes")
+    }, 2, "new_data");
+    LLVMBuildStore(builder, LLVMBuildBitCast(builder, new_data, data_type, ""), stack.data);
+    LLVMBuildStore(builder, new_capacity, stack.capacity);
+    LLVMBuildBr(builder, push_block);
+
+    LLVMPositionBuilderAtEnd(builder, push_block);
+    LLVMValueRef data = LLVMBuildLoad2(builder, data_type, stack.data, "data");
+    LLVMValueRef slot = LLVMBuildGEP2(builder, entry_type, data, &count, 1, "slot");
+    LLVMBuildStore(builder, LLVMGetParam(stack.push, 0), LLVMBuildStructGEP2(builder, entry_type, slot, 0, ""));
+    LLVMBuildStore(builder, LLVMGetParam(stack.push, 1), LLVMBuildStructGEP2(builder, entry_type, slot, 1, ""));
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, count, i64_const(1), ""), stack.count);
+    LLVMBuildRetVoid(builder);
+
+    return stack;
+}
+
+// void hulk_gc_mark(i8* value, i64 offset): marca el bloque del valor y,
+// si tiene punteros, lo deja en la pila gris para recorrerlos
+static LLVMValueRef declare_mark_function(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ i8_ptr_type(), LLVMInt64Type() }, 2, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_gc_mark", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    LLVMValueRef value = LLVMGetParam(func, 0);
+    LLVMValueRef offset = LLVMGetParam(func, 1);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef tagged_block = LLVMAppendBasicBlock(func, "tagged");
+    LLVMBasicBlockRef decode_block = LLVMAppendBasicBlock(func, "decode");
+    LLVMBasicBlockRef check_block = LLVMAppendBasicBlock(func, "check");
+    LLVMBasicBlockRef mark_block = LLVMAppendBasicBlock(func, "mark");
+    LLVMBasicBlockRef gray_block = LLVMAppendBasicBlock(func, "gray");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(func, "done");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef is_null = LLVMBuildIsNull(builder, value, "is_null");
+    LLVMBuildCondBr(builder, is_null, done_block, tagged_block);
+
+    LLVMPositionBuilderAtEnd(builder, tagged_block);
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntEQ, offset, i64_const(GC_TAGGED_OFFSET), "is_tagged"),
+        decode_block, check_block);
+
+    // Solo los String y las instancias (no nulas) de un Object son bloques
+    LLVMPositionBuilderAtEnd(builder, decode_block);
+    LLVMValueRef bits = LLVMBuildPtrToInt(builder, value, LLVMInt64Type(), "bits");
+    LLVMValueRef tag = LLVMBuildLShr(builder, bits, i64_const(TAG_SHIFT), "tag");
+    LLVMValueRef payload = LLVMBuildAnd(builder, bits, i64_const(TAG_PAYLOAD_MASK), "payload");
+    LLVMValueRef is_string = LLVMBuildICmp(builder, LLVMIntEQ, tag, i64_const(TAG_STRING), "is_string");
+    LLVMValueRef is_pointer = LLVMBuildOr(builder, is_string,
+        LLVMBuildICmp(builder, LLVMIntEQ, tag, i64_const(TAG_INSTANCE), ""), "is_pointer");
+    is_pointer = LLVMBuildAnd(builder, is_pointer,
+        LLVMBuildICmp(builder, LLVMIntNE, payload, i64_const(0), ""), "is_block");
+    LLVMValueRef decoded = LLVMBuildIntToPtr(builder, payload, i8_ptr_type(), "decoded");
+    LLVMValueRef decoded_offset = LLVMBuildSelect(builder, is_string,
+        i64_const(STRING_HEADER_SIZE), i64_const(0), "decoded_offset");
+    LLVMBuildCondBr(builder, is_pointer, check_block, done_block);
+
+    // Los literales tienen una cabecera estática ya marcada
+    LLVMPositionBuilderAtEnd(builder, check_block);
+    LLVMValueRef value_phi = LLVMBuildPhi(builder, i8_ptr_type(), "block_value");
+    LLVMAddIncoming(value_phi, (LLVMValueRef[]){ value, decoded }, (LLVMBasicBlockRef[]){ tagged_block, decode_block }, 2);
+    LLVMValueRef offset_phi = LLVMBuildPhi(builder, LLVMInt64Type(), "block_offset");
+    LLVMAddIncoming(offset_phi, (LLVMValueRef[]){ offset, decoded_offset }, (LLVMBasicBlockRef[]){ tagged_block, decode_block }, 2);
+    value = value_phi;
+    offset = offset_phi;
+    LLVMValueRef block = LLVMBuildGEP2(builder, LLVMInt8Type(), value,
+        (LLVMValueRef[]){LLVMBuildNeg(builder, offset, "")}, 1, "block");
+    LLVMValueRef header = header_of(block);
+    LLVMValueRef mark_ptr = header_field(header, 3, "mark_ptr");
+    LLVMValueRef marked = LLVMBuildICmp(builder, LLVMIntNE,
+        load_i64(mark_ptr, "mark"), i64_const(0), "marked");
+    LLVMBuildCondBr(builder, marked, done_block, mark_block);
+
+    LLVMPositionBuilderAtEnd(builder, mark_block);
+    LLVMBuildStore(builder, i64_const(1), mark_ptr);
+    LLVMValueRef map = LLVMBuildLoad2(builder, i8_ptr_type(), header_field(header, 1, "map_ptr"), "map");
+    LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, map, "leaf"), done_block, gray_block);
+
+    LLVMPositionBuilderAtEnd(builder, gray_block);
+    call_function(gray.push, (LLVMValueRef[]){block, i64_const(0)}, 2, "");
+    LLVMBuildBr(builder, done_block);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMBuildRetVoid(builder);
+    return func;
+}
+
+// Recorre una pila de raíces llamando a hulk_gc_mark por cada entrada. Si
+// 'indirect', la entrada es la dirección de la variable que guarda el valor
+static void build_mark_stack(LLVMValueRef func, LLVMValueRef mark, GCStack* stack, int indirect, const char* name) {
+    LLVMTypeRef data_type = LLVMPointerType(entry_type, 0);
+    LLVMBasicBlockRef cond_block = LLVMAppendBasicBlock(func, "roots.cond");
+    LLVMBasicBlockRef body_block = LLVMAppendBasicBlock(func, "roots.body");
+    LLVMBasicBlockRef end_block = LLVMAppendBasicBlock(func, "roots.end");
+
+    LLVMValueRef index = LLVMBuildAlloca(builder, LLVMInt64Type(), name);
+    LLVMBuildStore(builder, i64_const(0), index);
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, cond_block);
+    LLVMValueRef i = load_i64(index, "i");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntULT, i, load_i64(stack->count, "count"), ""),
+        body_block, end_block);
+
+    LLVMPositionBuilderAtEnd(builder, body_block);
+    LLVMValueRef data = LLVMBuildLoad2(builder, data_type, stack->data, "data");
+    LLVMValueRef slot = LLVMBuildGEP2(builder, entry_type, data, &i, 1, "slot");
+    LLVMValueRef ptr = LLVMBuildLoad2(builder, i8_ptr_type(),
+        LLVMBuildStructGEP2(builder, entry_type, slot, 0, ""), "ptr");
+    LLVMValueRef offset = LLVMBuildLoad2(builder, LLVMInt64Type(),
+        LLVMBuildStructGEP2(builder, entry_type, slot, 1, ""), "offset");
+    if (indirect) {
+        LLVMValueRef variable = LLVMBuildBitCast(builder, ptr, LLVMPointerType(i8_ptr_type(), 0), "variable");
+        ptr = LLVMBuildLoad2(builder, i8_ptr_type(), variable, "value");
+    }
+    call_function(mark, (LLVMValueRef[]){ptr, offset}, 2, "");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, i, i64_const(1), ""), index);
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, end_block);
+}
+
+// Vacía la pila gris marcando los punteros de cada bloque según su mapa:
+// { i64 n, [n x { i64 posición del campo, i64 offset del valor }] }
+static void build_trace(LLVMValueRef func, LLVMValueRef mark) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef data_type = LLVMPointerType(entry_type, 0);
+    LLVMBasicBlockRef cond_block = LLVMAppendBasicBlock(func, "trace.cond");
+    LLVMBasicBlockRef pop_block = LLVMAppendBasicBlock(func, "trace.pop");
+    LLVMBasicBlockRef field_cond = LLVMAppendBasicBlock(func, "fields.cond");
+    LLVMBasicBlockRef field_body = LLVMAppendBasicBlock(func, "fields.body");
+    LLVMBasicBlockRef end_block = LLVMAppendBasicBlock(func, "trace.end");
+
+    LLVMValueRef index = LLVMBuildAlloca(builder, i64, "field_index");
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, cond_block);
+    LLVMValueRef count = load_i64(gray.count, "gray_count");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntNE, count, i64_const(0), ""),
+        pop_block, end_block);
+
+    LLVMPositionBuilderAtEnd(builder, pop_block);
+    LLVMValueRef top = LLVMBuildSub(builder, count, i64_const(1), "top");
+    LLVMBuildStore(builder, top, gray.count);
+    LLVMValueRef data = LLVMBuildLoad2(builder, data_type, gray.data, "data");
+    LLVMValueRef block = LLVMBuildLoad2(builder, i8_ptr_type(), LLVMBuildStructGEP2(builder, entry_type,
+        LLVMBuildGEP2(builder, entry_type, data, &top, 1, ""), 0, ""), "block");
+    LLVMValueRef map = LLVMBuildLoad2(builder, i8_ptr_type(),
+        header_field(header_of(block), 1, "map_ptr"), "map");
+    map = LLVMBuildBitCast(builder, map, LLVMPointerType(i64, 0), "map_words");
+    LLVMValueRef field_count = LLVMBuildLoad2(builder, i64, map, "field_count");
+    LLVMBuildStore(builder, i64_const(0), index);
+    LLVMBuildBr(builder, field_cond);
+
+    LLVMPositionBuilderAtEnd(builder, field_cond);
+    LLVMValueRef j = load_i64(index, "j");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntULT, j, field_count, ""),
+        field_body, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, field_body);
+    LLVMValueRef word = LLVMBuildAdd(builder, LLVMBuildMul(builder, j, i64_const(2), ""), i64_const(1), "word");
+    LLVMValueRef position = LLVMBuildLoad2(builder, i64, LLVMBuildGEP2(builder, i64, map, &word, 1, ""), "position");
+    word = LLVMBuildAdd(builder, word, i64_const(1), "");
+    LLVMValueRef offset = LLVMBuildLoad2(builder, i64, LLVMBuildGEP2(builder, i64, map, &word, 1, ""), "offset");
+    LLVMValueRef field = LLVMBuildGEP2(builder, LLVMInt8Type(), block, &position, 1, "field");
+    field = LLVMBuildBitCast(builder, field, LLVMPointerType(i8_ptr_type(), 0), "");
+    LLVMValueRef child = LLVMBuildLoad2(builder, i8_ptr_type(), field, "child");
+    call_function(mark, (LLVMValueRef[]){child, offset}, 2, "");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, j, i64_const(1), ""), index);
+    LLVMBuildBr(builder, field_cond);
+
+    LLVMPositionBuilderAtEnd(builder, end_block);
+}
+
+// Lista libre de la clase de tamaño de un bloque de 'size' bytes
+static LLVMValueRef free_list_of(LLVMValueRef size) {
+    LLVMValueRef size_class = LLVMBuildUDiv(builder, size, i64_const(GC_SIZE_CLASS), "size_class");
+    return LLVMBuildInBoundsGEP2(builder, LLVMGetElementType(LLVMTypeOf(free_lists)), free_lists,
+        (LLVMValueRef[]){i64_const(0), size_class}, 2, "free_list");
+}
+
+// Libera los bloques sin marcar y desmarca el resto. Los bloques pequeños
+// no vuelven a malloc: se reciclan en la lista libre de su clase
+static void build_sweep(LLVMValueRef func) {
+    LLVMTypeRef link_type = LLVMPointerType(i8_ptr_type(), 0);
+    LLVMBasicBlockRef cond_block = LLVMAppendBasicBlock(func, "sweep.cond");
+    LLVMBasicBlockRef body_block = LLVMAppendBasicBlock(func, "sweep.body");
+    LLVMBasicBlockRef keep_block = LLVMAppendBasicBlock(func, "sweep.keep");
+    LLVMBasicBlockRef free_block = LLVMAppendBasicBlock(func, "sweep.free");
+    LLVMBasicBlockRef recycle_block = LLVMAppendBasicBlock(func, "sweep.recycle");
+    LLVMBasicBlockRef release_block = LLVMAppendBasicBlock(func, "sweep.release");
+    LLVMBasicBlockRef end_block = LLVMAppendBasicBlock(func, "sweep.end");
+
+    // 'previous' apunta al enlace que lleva al bloque actual
+    LLVMValueRef previous = LLVMBuildAlloca(builder, link_type, "previous");
+    LLVMBuildStore(builder, gc_blocks, previous);
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, cond_block);
+    LLVMValueRef link = LLVMBuildLoad2(builder, link_type, previous, "link");
+    LLVMValueRef current = LLVMBuildLoad2(builder, i8_ptr_type(), link, "current");
+    LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, current, ""), end_block, body_block);
+
+    LLVMPositionBuilderAtEnd(builder, body_block);
+    LLVMValueRef header = LLVMBuildBitCast(builder, current, LLVMPointerType(header_type, 0), "header");
+    LLVMValueRef mark_ptr = header_field(header, 3, "mark_ptr");
+    LLVMValueRef marked = LLVMBuildICmp(builder, LLVMIntNE, load_i64(mark_ptr, "mark"), i64_const(0), "marked");
+    LLVMBuildCondBr(builder, marked, keep_block, free_block);
+
+    LLVMPositionBuilderAtEnd(builder, keep_block);
+    LLVMBuildStore(builder, i64_const(0), mark_ptr);
+    LLVMBuildStore(builder, header_field(header, 0, "next_ptr"), previous);
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, free_block);
+    LLVMValueRef next = LLVMBuildLoad2(builder, i8_ptr_type(), header_field(header, 0, "next_ptr"), "next");
+    LLVMBuildStore(builder, next, link);
+    LLVMValueRef size = load_i64(header_field(header, 2, "size_ptr"), "size");
+    LLVMBuildStore(builder, LLVMBuildSub(builder, load_i64(heap_bytes, "heap"), size, ""), heap_bytes);
+    LLVMValueRef small = LLVMBuildICmp(builder, LLVMIntULE, size, i64_const(GC_MAX_RECYCLED), "small");
+    LLVMBuildCondBr(builder, small, recycle_block, release_block);
+
+    LLVMPositionBuilderAtEnd(builder, recycle_block);
+    LLVMValueRef free_list = free_list_of(size);
+    LLVMBuildStore(builder, LLVMBuildLoad2(builder, i8_ptr_type(), free_list, "free_head"),
+        header_field(header, 0, ""));
+    LLVMBuildStore(builder, current, free_list);
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, release_block);
+    call_function(LLVMGetNamedFunction(module, "free"), &current, 1, "");
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, end_block);
+}
+
+// Nanosegundos de un reloj monótono
+static LLVMValueRef build_now(LLVMValueRef timespec) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef timespec_type = LLVMGetElementType(LLVMTypeOf(timespec));
+    call_function(LLVMGetNamedFunction(module, "clock_gettime"),
+        (LLVMValueRef[]){
+            LLVMConstInt(LLVMInt32Type(), 1, 0),    // CLOCK_MONOTONIC
+            LLVMBuildBitCast(builder, timespec, i8_ptr_type(), "")
+        }, 2, "");
+    LLVMValueRef seconds = LLVMBuildLoad2(builder, i64,
+        LLVMBuildStructGEP2(builder, timespec_type, timespec, 0, ""), "seconds");
+    LLVMValueRef nanoseconds = LLVMBuildLoad2(builder, i64,
+        LLVMBuildStructGEP2(builder, timespec_type, timespec, 1, ""), "nanoseconds");
+    return LLVMBuildAdd(builder, LLVMBuildMul(builder, seconds, i64_const(1000000000), ""),
+        nanoseconds, "now");
+}
+
+// void hulk_gc_collect(): marca desde las raíces, barre el heap y fija el
+// próximo umbral en el doble de lo que sobrevivió
+static LLVMValueRef declare_collect_function(LLVMValueRef mark) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_gc_collect", LLVMFunctionType(LLVMVoidType(), NULL, 0, 0));
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(func, "entry"));
+    LLVMTypeRef timespec_type = LLVMStructType((LLVMTypeRef[]){ i64, i64 }, 2, 0);
+    LLVMValueRef timespec = LLVMBuildAlloca(builder, timespec_type, "timespec");
+    LLVMValueRef start = build_now(timespec);
+
+    build_mark_stack(func, mark, &roots, 1, "root_index");
+    build_mark_stack(func, mark, &temps, 0, "temp_index");
+    build_trace(func, mark);
+    build_sweep(func);
+
+    LLVMValueRef live = load_i64(heap_bytes, "live");
+    LLVMBuildStore(builder, build_max(LLVMBuildMul(builder, live, i64_const(2), ""),
+        i64_const(GC_MIN_THRESHOLD), "next_threshold"), threshold);
+    increment(collections, i64_const(1));
+
+    LLVMValueRef pause = LLVMBuildSub(builder, build_now(timespec), start, "pause");
+    increment(pause_total, pause);
+    LLVMBuildStore(builder, build_max(load_i64(pause_max, ""), pause, ""), pause_max);
+    LLVMBuildRetVoid(builder);
+    return func;
+}
+
+// i8* hulk_gc_alloc(i64 size, i8* map): reserva un bloque (recolectando
+// antes si el heap pasa el umbral) y lo registra como temporal. Los bloques
+// pequeños se toman primero de la lista libre de su clase de tamaño
+static void declare_alloc_function(LLVMValueRef collect) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef func_type = LLVMFunctionType(i8_ptr_type(), (LLVMTypeRef[]){ i64, i8_ptr_type() }, 2, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_gc_alloc", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef collect_block = LLVMAppendBasicBlock(func, "collect");
+    LLVMBasicBlockRef alloc_block = LLVMAppendBasicBlock(func, "alloc");
+    LLVMBasicBlockRef recycled_block = LLVMAppendBasicBlock(func, "recycled");
+    LLVMBasicBlockRef pop_block = LLVMAppendBasicBlock(func, "pop");
+    LLVMBasicBlockRef malloc_block = LLVMAppendBasicBlock(func, "malloc");
+    LLVMBasicBlockRef init_block = LLVMAppendBasicBlock(func, "init");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef total = LLVMBuildAdd(builder, LLVMGetParam(func, 0),
+        i64_const(GC_HEADER_SIZE + GC_SIZE_CLASS - 1), "");
+    total = LLVMBuildAnd(builder, total, i64_const(-GC_SIZE_CLASS), "total");
+    LLVMValueRef after = LLVMBuildAdd(builder, load_i64(heap_bytes, "heap"), total, "after");
+    LLVMValueRef over = LLVMBuildICmp(builder, LLVMIntUGT, after, load_i64(threshold, "threshold"), "over");
+    LLVMBuildCondBr(builder, over, collect_block, alloc_block);
+
+    LLVMPositionBuilderAtEnd(builder, collect_block);
+    call_function(collect, NULL, 0, "");
+    LLVMBuildBr(builder, alloc_block);
+
+    LLVMPositionBuilderAtEnd(builder, alloc_block);
+    LLVMValueRef small = LLVMBuildICmp(builder, LLVMIntULE, total, i64_const(GC_MAX_RECYCLED), "small");
+    LLVMBuildCondBr(builder, small, recycled_block, malloc_block);
+
+    LLVMPositionBuilderAtEnd(builder, recycled_block);
+    LLVMValueRef free_list = free_list_of(total);
+    LLVMValueRef free_head = LLVMBuildLoad2(builder, i8_ptr_type(), free_list, "free_head");
+    LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, free_head, ""), malloc_block, pop_block);
+
+    LLVMPositionBuilderAtEnd(builder, pop_block);
+    LLVMValueRef free_next = LLVMBuildLoad2(builder, i8_ptr_type(),
+        LLVMBuildBitCast(builder, free_head, LLVMPointerType(i8_ptr_type(), 0), ""), "free_next");
+    LLVMBuildStore(builder, free_next, free_list);
+    LLVMBuildBr(builder, init_block);
+
+    LLVMPositionBuilderAtEnd(builder, malloc_block);
+    LLVMValueRef fresh = call_function(LLVMGetNamedFunction(module, "malloc"), &total, 1, "fresh");
+    LLVMBuildBr(builder, init_block);
+
+    LLVMPositionBuilderAtEnd(builder, init_block);
+    LLVMValueRef memory = LLVMBuildPhi(builder, i8_ptr_type(), "memory");
+    LLVMAddIncoming(memory, (LLVMValueRef[]){free_head, fresh},
+        (LLVMBasicBlockRef[]){pop_block, malloc_block}, 2);
+    LLVMValueRef header = LLVMBuildBitCast(builder, memory, LLVMPointerType(header_type, 0), "header");
+    LLVMBuildStore(builder, LLVMBuildLoad2(builder, i8_ptr_type(), gc_blocks, "first"), header_field(header, 0, ""));
+    LLVMBuildStore(builder, LLVMGetParam(func, 1), header_field(header, 1, ""));
+    LLVMBuildStore(builder, total, header_field(header, 2, ""));
+    LLVMBuildStore(builder, i64_const(0), header_field(header, 3, ""));
+    LLVMBuildStore(builder, memory, gc_blocks);
+
+    increment(heap_bytes, total);
+    increment(allocated_bytes, total);
+    LLVMBuildStore(builder, build_max(load_i64(peak_bytes, ""), load_i64(heap_bytes, ""), ""), peak_bytes);
+
+    LLVMValueRef block = LLVMBuildGEP2(builder, LLVMInt8Type(), memory,
+        (LLVMValueRef[]){i64_const(GC_HEADER_SIZE)}, 1, "block");
+    call_function(temps.push, (LLVMValueRef[]){block, i64_const(0)}, 2, "");
+    LLVMBuildRet(builder, block);
+}
+
+// void hulk_gc_report(): estadísticas en stderr
+static void declare_report_function(void) {
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_gc_report", LLVMFunctionType(LLVMVoidType(), NULL, 0, 0));
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(func, "entry"));
+    LLVMValueRef format = get_global_string(
+        "GC: %ld collections, %ld bytes allocated, peak heap %ld bytes, "
+        "live heap %ld bytes, total pause %.3f ms, max pause %.3f ms\n", "gc_report");
+    LLVMValueRef ms = LLVMConstReal(LLVMDoubleType(), 1e6);
+    LLVMValueRef total_ms = LLVMBuildFDiv(builder,
+        LLVMBuildSIToFP(builder, load_i64(pause_total, ""), LLVMDoubleType(), ""), ms, "total_ms");
+    LLVMValueRef max_ms = LLVMBuildFDiv(builder,
+        LLVMBuildSIToFP(builder, load_i64(pause_max, ""), LLVMDoubleType(), ""), ms, "max_ms");
+    call_function(LLVMGetNamedFunction(module, "dprintf"), (LLVMValueRef[]){
+        LLVMConstInt(LLVMInt32Type(), 2, 0), format,
+        load_i64(collections, ""), load_i64(allocated_bytes, ""),
+        load_i64(peak_bytes, ""), load_i64(heap_bytes, ""), total_ms, max_ms
+    }, 8, "");
+    LLVMBuildRetVoid(builder);
+}
+
+void declare_gc_runtime(void) {
+    current_frame = (GCFrame){ NULL, NULL, NULL };
+    if (!garbage_collection) {
+        return;
+    }
+
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef i8_ptr = i8_ptr_type();
+
+    // Funciones de C que usa el recolector
+    declare_libc("realloc", LLVMFunctionType(i8_ptr, (LLVMTypeRef[]){ i8_ptr, i64 }, 2, 0));
+    declare_libc("free", LLVMFunctionType(LLVMVoidType(), &i8_ptr, 1, 0));
+    declare_libc("clock_gettime", LLVMFunctionType(LLVMInt32Type(),
+        (LLVMTypeRef[]){ LLVMInt32Type(), i8_ptr }, 2, 0));
+    declare_libc("dprintf", LLVMFunctionType(LLVMInt32Type(),
+        (LLVMTypeRef[]){ LLVMInt32Type(), i8_ptr }, 2, 1));
+
+    header_type = LLVMStructCreateNamed(context, "GCHeader");
+    LLVMStructSetBody(header_type, (LLVMTypeRef[]){ i8_ptr, i8_ptr, i64, i64 }, 4, 0);
+    entry_type = LLVMStructCreateNamed(context, "GCEntry");
+    LLVMStructSetBody(entry_type, (LLVMTypeRef[]){ i8_ptr, i64 }, 2, 0);
+
+    gc_blocks = add_private_global("gc_blocks", i8_ptr, LLVMConstNull(i8_ptr));
+    LLVMTypeRef lists_type = LLVMArrayType(i8_ptr, GC_MAX_RECYCLED / GC_SIZE_CLASS + 1);
+    free_lists = add_private_global("gc_free_lists", lists_type, LLVMConstNull(lists_type));
+    heap_bytes = add_counter("gc_heap_bytes", 0);
+    threshold = add_counter("gc_threshold", GC_MIN_THRESHOLD);
+    collections = add_counter("gc_collections", 0);
+    allocated_bytes = add_counter("gc_allocated_bytes", 0);
+    peak_bytes = add_counter("gc_peak_bytes", 0);
+    pause_total = add_counter("gc_pause_total", 0);
+    pause_max = add_counter("gc_pause_max", 0);
+
+    LLVMBasicBlockRef saved_block = LLVMGetInsertBlock(builder);
+
+    roots = declare_stack("roots");
+    temps = declare_stack("temps");
+    gray = declare_stack("gray");
+    LLVMValueRef mark = declare_mark_function();
+    declare_alloc_function(declare_collect_function(mark));
+    declare_report_function();
+
+    if (saved_block) {
+        LLVMPositionBuilderAtEnd(builder, saved_block);
+    }
+}
+
+GCFrame gc_begin_frame(LLVMBasicBlockRef entry) {
+    GCFrame enclosing = current_frame;
+    current_frame = (GCFrame){ entry, NULL, NULL };
+
+    if (garbage_collection) {
+        current_frame.root_height = load_i64(roots.count, "root_height");
+        current_frame.temp_height = load_i64(temps.count, "temp_height");
+    }
+    return enclosing;
+}
+
+void gc_release_frame(void) {
+    if (garbage_collection && current_frame.entry) {
+        LLVMBuildStore(builder, current_frame.root_height, roots.count);
+        LLVMBuildStore(builder, current_frame.temp_height, temps.count);
+    }
+}
+
+void gc_end_frame(GCFrame enclosing, LLVMValueRef result) {
+    gc_release_frame();
+    if (garbage_collection && current_frame.entry) {
+        long long offset = result ? value_offset(LLVMTypeOf(result)) : -1;
+        if (offset >= 0) {
+            LLVMValueRef value = LLVMBuildBitCast(builder, result, i8_ptr_type(), "result");
+            call_function(temps.push, (LLVMValueRef[]){value, i64_const(offset)}, 2, "");
+        }
+    }
+    current_frame = enclosing;
+}
+
+void gc_safepoint(void) {
+    if (garbage_collection && current_frame.entry) {
+        LLVMBuildStore(builder, current_frame.temp_height, temps.count);
+    }
+}
+
+LLVMValueRef build_variable_slot(LLVMTypeRef type, const char* name) {
+    if (!current_frame.entry) {
+        return LLVMBuildAlloca(builder, type, name);
+    }
+
+    // Al final del bloque de entrada (antes de su salto), una vez por llamada
+    LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
+    LLVMValueRef terminator = LLVMGetBasicBlockTerminator(current_frame.entry);
+    if (terminator) {
+        LLVMPositionBuilderBefore(builder, terminator);
+    } else {
+        LLVMPositionBuilderAtEnd(builder, current_frame.entry);
+    }
+
+    LLVMValueRef slot = LLVMBuildAlloca(builder, type, name);
+    long long offset = value_offset(type);
+    if (garbage_collection && offset >= 0) {
+        LLVMBuildStore(builder, LLVMConstNull(type), slot);
+        LLVMValueRef address = LLVMBuildBitCast(builder, slot, i8_ptr_type(), "root");
+        call_function(roots.push, (LLVMValueRef[]){address, i64_const(offset)}, 2, "");
+    }
+
+    LLVMPositionBuilderAtEnd(builder, current_block);
+    return slot;
+}
+
+LLVMValueRef build_instance_slot(LLVMTypeRef struct_type) {
+    if (!current_frame.entry) {
+        return NULL;
+    }
+
+    LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
+    LLVMValueRef terminator = LLVMGetBasicBlockTerminator(current_frame.entry);
+    if (terminator) {
+        LLVMPositionBuilderBefore(builder, terminator);
+    } else {
+        LLVMPositionBuilderAtEnd(builder, current_frame.entry);
+    }
+
+    LLVMValueRef instance;
+    if (garbage_collection) {
+        // { cabecera, instancia }: la marca en 1 hace que el recolector no
+        // la recorra ni la libere, así que cada campo puntero es una raíz
+        LLVMTypeRef block_type = LLVMStructType((LLVMTypeRef[]){ header_type, struct_type }, 2, 0);
+        LLVMValueRef block = LLVMBuildAlloca(builder, block_type, "stack_block");
+        LLVMValueRef header = LLVMConstNamedStruct(header_type, (LLVMValueRef[]){
+            LLVMConstNull(i8_ptr_type()), LLVMConstNull(i8_ptr_type()), i64_const(0), i64_const(1)
+        }, 4);
+        LLVMBuildStore(builder, header, LLVMBuildStructGEP2(builder, block_type, block, 0, ""));
+        instance = LLVMBuildStructGEP2(builder, block_type, block, 1, "stack_instance");
+        LLVMBuildStore(builder, LLVMConstNull(struct_type), instance);
+
+        unsigned count = LLVMCountStructElementTypes(struct_type);
+        for (unsigned i = 0; i < count; i++) {
+            long long offset = value_offset(LLVMStructGetTypeAtIndex(struct_type, i));
+            if (offset < 0) {
+                continue;
+            }
+            LLVMValueRef field = LLVMBuildStructGEP2(builder, struct_type, instance, i, "");
+            LLVMValueRef address = LLVMBuildBitCast(builder, field, i8_ptr_type(), "root");
+            call_function(roots.push, (LLVMValueRef[]){address, i64_const(offset)}, 2, "");
+        }
+    } else {
+        instance = LLVMBuildAlloca(builder, struct_type, "stack_instance");
+    }
+
+    LLVMPositionBuilderAtEnd(builder, current_block);
+    return instance;
+}
+
+LLVMValueRef build_gc_alloc(LLVMValueRef size, LLVMValueRef map) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, "hulk_gc_alloc");
+    if (!map) {
+        map = LLVMConstNull(i8_ptr_type());
+    }
+    return call_function(func, (LLVMValueRef[]){size, map}, 2, "gc_memory");
+}
+
+LLVMValueRef get_gc_type_map(LLVMTypeRef struct_type) {
+    char map_name[256];
+    snprintf(map_name, sizeof(map_name), "%s_gc_map", LLVMGetStructName(struct_type));
+    LLVMValueRef map = LLVMGetNamedGlobal(module, map_name);
+    if (map) {
+        return LLVMConstBitCast(map, i8_ptr_type());
+    }
+
+    unsigned count = LLVMCountStructElementTypes(struct_type);
+    LLVMValueRef* words = malloc((2 * count + 1) * sizeof(LLVMValueRef));
+    LLVMValueRef null_instance = LLVMConstNull(LLVMPointerType(struct_type, 0));
+    int pointers = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        long long offset = value_offset(LLVMStructGetTypeAtIndex(struct_type, i));
+        if (offset < 0) {
+            continue;
+        }
+        // posición del campo: &((T*)null)->campo
+        LLVMValueRef indices[] = {
+            LLVMConstInt(LLVMInt32Type(), 0, 0), LLVMConstInt(LLVMInt32Type(), i, 0)
+        };
+        LLVMValueRef field = LLVMConstInBoundsGEP2(struct_type, null_instance, indices, 2);
+        words[1 + 2 * pointers] = LLVMConstPtrToInt(field, LLVMInt64Type());
+        words[2 + 2 * pointers] = i64_const(offset);
+        pointers++;
+    }
+
+    if (!pointers) {
+        free(words);
+        return NULL;
+    }
+
+    words[0] = i64_const(pointers);
+    LLVMValueRef init = LLVMConstArray(LLVMInt64Type(), words, 2 * pointers + 1);
+    map = add_private_global(map_name, LLVMTypeOf(init), init);
+    LLVMSetGlobalConstant(map, 1);
+    free(words);
+    return LLVMConstBitCast(map, i8_ptr_type());
+}
+
+LLVMValueRef build_gc_report(void) {
+    return call_function(LLVMGetNamedFunction(module, "hulk_gc_report"), NULL, 0, "");
+}
@@ -0,0 +1,73 @@
+#ifndef LLVM_GC_H
+#define LLVM_GC_H
+
+#include <llvm-c/Core.h>
+
+// Cabecera que el recolector pone delante de cada bloque del heap:
+// { i8* siguiente bloque, i8* mapa de punteros, i64 tamaño total, i64 marca }
+#define GC_HEADER_SIZE 32
+
+// Los bloques se redondean a múltiplos de GC_SIZE_CLASS bytes. Los que no
+// pasan de GC_MAX_RECYCLED se reciclan en una lista libre por tamaño
+#define GC_SIZE_CLASS 16
+#define GC_MAX_RECYCLED 512
+
+// Tamaño mínimo del heap (en bytes) a partir del cual se recolecta
+#define GC_MIN_THRESHOLD (1 << 20)
+
+// Si es distinto de 0, strings e instancias se reservan en el heap del
+// recolector (se activa con el flag --gc del compilador)
+extern int garbage_collection;
+
+// Si es distinto de 0, el programa imprime en stderr las estadísticas del
+// recolector al terminar (flag --gc-stats, implica --gc)
+extern int gc_statistics;
+
+// Marco de la función que se está generando: su bloque de entrada y la
+// altura de las pilas de raíces y temporales al entrar
+typedef struct GCFrame {
+    LLVMBasicBlockRef entry;
+    LLVMValueRef root_height;
+    LLVMValueRef temp_height;
+} GCFrame;
+
+// Emite en el módulo el heap y las rutinas del recolector
+void declare_gc_runtime(void);
+
+// Abre el marco de la función cuyo bloque de entrada es 'entry' (el builder
+// debe estar al final de ese bloque). Devuelve el marco que la contiene
+GCFrame gc_begin_frame(LLVMBasicBlockRef entry);
+
+// Cierra el marco actual: descarta sus raíces y temporales y, si 'result'
+// es un puntero del heap, lo registra como temporal de quien llama
+void gc_end_frame(GCFrame enclosing, LLVMValueRef result);
+
+// Descarta las raíces y temporales del marco actual antes de una llamada en
+// posición de cola, sin cerrarlo (la función sigue generándose)
+void gc_release_frame(void);
+
+// Descarta los temporales del marco actual (fin de una iteración de un
+// bucle marcado con FLAG_GC_SAFEPOINT)
+void gc_safepoint(void);
+
+// Variable en el bloque de entrada de la función actual. Si guarda un
+// puntero del heap, empieza en null y se registra como raíz
+LLVMValueRef build_variable_slot(LLVMTypeRef type, const char* name);
+
+// Instancia de 'struct_type' en la pila de la función actual (para un 'new'
+// con FLAG_STACK_INSTANCE), o NULL si no hay un marco abierto. Con el
+// recolector lleva delante una cabecera ya marcada y sus punteros se
+// registran como raíces
+LLVMValueRef build_instance_slot(LLVMTypeRef struct_type);
+
+// Reserva 'size' bytes en el heap del recolector. 'map' describe los
+// punteros del bloque (NULL si no tiene)
+LLVMValueRef build_gc_alloc(LLVMValueRef size, LLVMValueRef map);
+
+// Mapa de punteros de las instancias de un struct (NULL si no tiene)
+LLVMValueRef get_gc_type_map(LLVMTypeRef struct_type);
+
+// Imprime las estadísticas del recolector
+LLVMValueRef build_gc_report(void);
+
+#endif // LLVM_GC_H
@@ -0,0 +1,194 @@
+#include "llvm_memo.h"
+#include "llvm_core.h"
+#include "llvm_gc.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int memoize = 0;
+
+// Cada función memoizada tiene una tabla global (<función>_memo) de
+// entradas { válida, argumentos..., resultado }. Los argumentos String se
+// copian con strdup, así la tabla no depende de la vida del string original
+// (ni del recolector), y se liberan cuando su entrada se reemplaza
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static LLVMTypeRef i8_ptr_type(void) {
+    return LLVMPointerType(LLVMInt8Type(), 0);
+}
+
+static LLVMValueRef i64_const(unsigned long long value) {
+    return LLVMConstInt(LLVMInt64Type(), value, 0);
+}
+
+static LLVMValueRef declare_libc(const char* name, LLVMTypeRef type) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, name);
+    return func ? func : LLVMAddFunction(module, name, type);
+}
+
+static LLVMValueRef call_function(LLVMValueRef func, LLVMValueRef* args, unsigned count, const char* tmp) {
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func, args, count, tmp);
+}
+
+static int is_string_key(LLVMValueRef value) {
+    return LLVMGetTypeKind(LLVMTypeOf(value)) == LLVMPointerTypeKind;
+}
+
+// Construye i64 hulk_memo_hash(i8* s): FNV-1a sobre los caracteres
+static LLVMValueRef declare_string_hash(void) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef func_type = LLVMFunctionType(i64, (LLVMTypeRef[]){ i8_ptr_type() }, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_memo_hash", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    LLVMValueRef str = LLVMGetParam(func, 0);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef loop = LLVMAppendBasicBlock(func, "loop");
+    LLVMBasicBlockRef step = LLVMAppendBasicBlock(func, "step");
+    LLVMBasicBlockRef done = LLVMAppendBasicBlock(func, "done");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMBuildBr(builder, loop);
+
+    LLVMPositionBuilderAtEnd(builder, loop);
+    LLVMValueRef index = LLVMBuildPhi(builder, i64, "index");
+    LLVMValueRef hash = LLVMBuildPhi(builder, i64, "hash");
+    LLVMValueRef char_ptr = LLVMBuildGEP2(builder, LLVMInt8Type(), str, &index, 1, "char_ptr");
+    LLVMValueRef c = LLVMBuildLoad2(builder, LLVMInt8Type(), char_ptr, "char");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntEQ, c, LLVMConstInt(LLVMInt8Type(), 0, 0), "end"),
+        done, step);
+
+    LLVMPositionBuilderAtEnd(builder, step);
+    LLVMValueRef mixed = LLVMBuildXor(builder, hash, LLVMBuildZExt(builder, c, i64, ""), "");
+    LLVMValueRef next_hash = LLVMBuildMul(builder, mixed, i64_const(FNV_PRIME), "next_hash");
+    LLVMValueRef next_index = LLVMBuildAdd(builder, index, i64_const(1), "next_index");
+    LLVMBuildBr(builder, loop);
+
+    LLVMAddIncoming(index, (LLVMValueRef[]){ i64_const(0), next_index }, (LLVMBasicBlockRef[]){ entry, step }, 2);
+    LLVMAddIncoming(hash, (LLVMValueRef[]){ i64_const(FNV_OFFSET), next_hash }, (LLVMBasicBlockRef[]){ entry, step }, 2);
+
+    LLVMPositionBuilderAtEnd(builder, done);
+    LLVMBuildRet(builder, hash);
+    add_function_attribute(func, "readonly");
+    add_function_attribute(func, "nounwind");
+    return func;
+}
+
+// Palabra de 64 bits que representa un argumento en el hash
+static LLVMValueRef key_word(LLVMValueRef value) {
+    if (!is_string_key(value)) {
+        return LLVMBuildBitCast(builder, value, LLVMInt64Type(), "key_bits");
+    }
+
+    LLVMValueRef hash_func = LLVMGetNamedFunction(module, "hulk_memo_hash");
+    if (!hash_func) {
+        LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
+        hash_func = declare_string_hash();
+        LLVMPositionBuilderAtEnd(builder, current_block);
+    }
+    return call_function(hash_func, &value, 1, "key_hash");
+}
+
+// Mezcla final de MurmurHash3: los Number enteros solo difieren en los
+// bits altos y el índice se toma de los bajos
+static LLVMValueRef finalize_hash(LLVMValueRef hash) {
+    hash = LLVMBuildXor(builder, hash, LLVMBuildLShr(builder, hash, i64_const(33), ""), "");
+    hash = LLVMBuildMul(builder, hash, i64_const(0xff51afd7ed558ccdULL), "");
+    hash = LLVMBuildXor(builder, hash, LLVMBuildLShr(builder, hash, i64_const(33), ""), "");
+    hash = LLVMBuildMul(builder, hash, i64_const(0xc4ceb9fe1a85ec53ULL), "");
+    return LLVMBuildXor(builder, hash, LLVMBuildLShr(builder, hash, i64_const(33), ""), "memo_hash");
+}
+
+static LLVMValueRef get_memo_table(LLVMValueRef func, LLVMTypeRef entry_type) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s_memo", LLVMGetValueName(func));
+    LLVMTypeRef table_type = LLVMArrayType(entry_type, MEMO_TABLE_SIZE);
+    LLVMValueRef table = LLVMAddGlobal(module, table_type, name);
+    LLVMSetInitializer(table, LLVMConstNull(table_type));
+    LLVMSetLinkage(table, LLVMPrivateLinkage);
+    return table;
+}
+
+LLVMValueRef build_memo_lookup(LLVMValueRef func) {
+    int param_count = LLVMCountParams(func);
+    LLVMTypeRef* fields = malloc((param_count + 2) * sizeof(LLVMTypeRef));
+    fields[0] = LLVMInt1Type();
+    for (int i = 0; i < param_count; i++) {
+        fields[i + 1] = LLVMTypeOf(LLVMGetParam(func, i));
+    }
+    fields[param_count + 1] = LLVMGetReturnType(LLVMGetElementType(LLVMTypeOf(func)));
+    LLVMTypeRef entry_type = LLVMStructType(fields, param_count + 2, 0);
+    free(fields);
+
+    LLVMValueRef table = get_memo_table(func, entry_type);
+
+    LLVMValueRef hash = i64_const(FNV_OFFSET);
+    for (int i = 0; i < param_count; i++) {
+        hash = LLVMBuildXor(builder, hash, key_word(LLVMGetParam(func, i)), "");
+        hash = LLVMBuildMul(builder, hash, i64_const(FNV_PRIME), "");
+    }
+    LLVMValueRef index = LLVMBuildAnd(builder, finalize_hash(hash), i64_const(MEMO_TABLE_SIZE - 1), "memo_index");
+    LLVMValueRef entry = LLVMBuildGEP2(builder, LLVMArrayType(entry_type, MEMO_TABLE_SIZE), table,
+        (LLVMValueRef[]){ i64_const(0), index }, 2, "memo_entry");
+
+    LLVMBasicBlockRef compare_block = LLVMAppendBasicBlock(func, "memo.compare");
+    LLVMBasicBlockRef hit_block = LLVMAppendBasicBlock(func, "memo.hit");
+    LLVMBasicBlockRef miss_block = LLVMAppendBasicBlock(func, "memo.miss");
+
+    LLVMValueRef valid = LLVMBuildLoad2(builder, LLVMInt1Type(),
+        LLVMBuildStructGEP2(builder, entry_type, entry, 0, ""), "memo_valid");
+    LLVMBuildCondBr(builder, valid, compare_block, miss_block);
+
+    // Los Number se comparan por sus bits y los String por su contenido
+    LLVMPositionBuilderAtEnd(builder, compare_block);
+    LLVMValueRef same = LLVMConstInt(LLVMInt1Type(), 1, 0);
+    for (int i = 0; i < param_count; i++) {
+        LLVMValueRef arg = LLVMGetParam(func, i);
+        LLVMValueRef key = LLVMBuildLoad2(builder, LLVMTypeOf(arg),
+            LLVMBuildStructGEP2(builder, entry_type, entry, i + 1, ""), "memo_key");
+        LLVMValueRef equal;
+        if (is_string_key(arg)) {
+            LLVMValueRef cmp = call_function(LLVMGetNamedFunction(module, "strcmp"),
+                (LLVMValueRef[]){ key, arg }, 2, "key_cmp");
+            equal = LLVMBuildICmp(builder, LLVMIntEQ, cmp, LLVMConstInt(LLVMInt32Type(), 0, 0), "");
+        } else {
+            equal = LLVMBuildICmp(builder, LLVMIntEQ, key_word(key), key_word(arg), "");
+        }
+        same = LLVMBuildAnd(builder, same, equal, "memo_same");
+    }
+    LLVMBuildCondBr(builder, same, hit_block, miss_block);
+
+    LLVMPositionBuilderAtEnd(builder, hit_block);
+    LLVMValueRef cached = LLVMBuildLoad2(builder, LLVMStructGetTypeAtIndex(entry_type, param_count + 1),
+        LLVMBuildStructGEP2(builder, entry_type, entry, param_count + 1, ""), "memo_result");
+    gc_release_frame();
+    LLVMBuildRet(builder, cached);
+
+    LLVMPositionBuilderAtEnd(builder, miss_block);
+    return entry;
+}
+
+void build_memo_store(LLVMValueRef func, LLVMValueRef entry, LLVMValueRef result) {
+    int param_count = LLVMCountParams(func);
+    LLVMTypeRef entry_type = LLVMGetElementType(LLVMTypeOf(entry));
+    LLVMTypeRef i8_ptr = i8_ptr_type();
+    LLVMValueRef free_func = declare_libc("free", LLVMFunctionType(LLVMVoidType(), &i8_ptr, 1, 0));
+    LLVMValueRef strdup_func = declare_libc("strdup", LLVMFunctionType(i8_ptr, &i8_ptr, 1, 0));
+
+    // La entrada reemplazada libera sus copias de los argumentos (free
+    // acepta NULL, que es lo que hay en una entrada nunca usada)
+    for (int i = 0; i < param_count; i++) {
+        LLVMValueRef arg = LLVMGetParam(func, i);
+        LLVMValueRef key_ptr = LLVMBuildStructGEP2(builder, entry_type, entry, i + 1, "");
+        if (is_string_key(arg)) {
+            LLVMValueRef old_key = LLVMBuildLoad2(builder, i8_ptr, key_ptr, "old_key");
+            call_function(free_func, &old_key, 1, "");
+            arg = call_function(strdup_func, &arg, 1, "key_copy");
+        }
+        LLVMBuildStore(builder, arg, key_ptr);
+    }
+
+    LLVMBuildStore(builder, result, LLVMBuildStructGEP2(builder, entry_type, entry, param_count + 1, ""));
+    LLVMBuildStore(builder, LLVMConstInt(LLVMInt1Type(), 1, 0), LLVMBuildStructGEP2(builder, entry_type, entry, 0, ""));
+}
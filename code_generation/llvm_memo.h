@@ -0,0 +1,24 @@
+#ifndef LLVM_MEMO_H
+#define LLVM_MEMO_H
+
+#include <llvm-c/Core.h>
+
+// Entradas de la tabla de cada función memoizada (potencia de 2). La tabla
+// es de correspondencia directa: una entrada nueva reemplaza a la que ocupa
+// su posición
+#define MEMO_TABLE_SIZE 4096
+
+// Si es distinto de 0, las funciones puras y recursivas con parámetros
+// Number o String guardan sus resultados en una tabla indexada por los
+// argumentos (se activa con el flag --memoize)
+extern int memoize;
+
+// Busca los argumentos de la función en su tabla al inicio del cuerpo. Si
+// están, devuelve el resultado guardado; si no, deja el builder al inicio
+// del camino normal. Devuelve la entrada que corresponde a los argumentos
+LLVMValueRef build_memo_lookup(LLVMValueRef func);
+
+// Guarda el resultado en la entrada de los argumentos (al salir del cuerpo)
+void build_memo_store(LLVMValueRef func, LLVMValueRef entry, LLVMValueRef result);
+
+#endif // LLVM_MEMO_H
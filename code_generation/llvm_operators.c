@@ -2,6 +2,7 @@
 #include "llvm_core.h"
 #include "llvm_string.h"
 #include "../type/type.h"
+#include "../scope/llvm_scope.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -54,68 +55,184 @@ LLVMValueRef handle_object_operation(LLVMValueRef left, LLVMValueRef right, int
     return phi;
 }
 
-LLVMValueRef generate_binary_operation(LLVM_Visitor* v, ASTNode* node) {
-    LLVMValueRef L = accept_gen(v, node->data.op_node.left);
-    LLVMValueRef R = accept_gen(v, node->data.op_node.right);
+int is_concat_node(ASTNode* node) {
+    return node->type == NODE_BINARY_OP && (
+        node->data.op_node.op == OP_CONCAT ||
+        node->data.op_node.op == OP_DCONCAT
+    );
+}
 
-    // Manejo de operaciones con strings (concatenación)
-    if (node->data.op_node.op == OP_CONCAT || node->data.op_node.op == OP_DCONCAT) {
-        // Convertir números a strings si es necesario
-        if (type_equals(node->data.op_node.left->return_type, &TYPE_NUMBER)) {
-            LLVMTypeRef snprintf_type = LLVMFunctionType(LLVMInt32Type(),
-                (LLVMTypeRef[]){
-                    LLVMPointerType(LLVMInt8Type(), 0),
-                    LLVMInt64Type(),
-                    LLVMPointerType(LLVMInt8Type(), 0)
-                }, 3, 1);
-            LLVMValueRef snprintf_func = LLVMGetNamedFunction(module, "snprintf");
-
-            // Buffer para el número
-            LLVMValueRef num_buffer = LLVMBuildAlloca(builder, 
-                LLVMArrayType(LLVMInt8Type(), 32), "num_buffer");
-            LLVMValueRef buffer_ptr = LLVMBuildBitCast(builder, num_buffer,
-                LLVMPointerType(LLVMInt8Type(), 0), "buffer_cast");
-            
-            LLVMValueRef format = LLVMBuildGlobalStringPtr(builder, "%g", "num_format");
-            LLVMBuildCall2(builder, snprintf_type, snprintf_func,
-                (LLVMValueRef[]){
-                    buffer_ptr,
-                    LLVMConstInt(LLVMInt64Type(), 32, 0),
-                    format,
-                    L
-                }, 4, "");
-            
-            L = buffer_ptr;
+// Cantidad de piezas de una cadena de '@'/'@@' (operandos más espacios)
+static int count_concat_pieces(ASTNode* node) {
+    if (!is_concat_node(node)) {
+        return 1;
+    }
+
+    return count_concat_pieces(node->data.op_node.left) +
+        count_concat_pieces(node->data.op_node.right) +
+        (node->data.op_node.op == OP_DCONCAT);
+}
+
+// Recorre la cadena de izquierda a derecha generando cada operando
+static void collect_concat_pieces(
+    LLVM_Visitor* v, ASTNode* node,
+    LLVMValueRef* pieces, LLVMValueRef* lengths, int* count
+) {
+    if (is_concat_node(node)) {
+        collect_concat_pieces(v, node->data.op_node.left, pieces, lengths, count);
+        if (node->data.op_node.op == OP_DCONCAT) {
+            pieces[*count] = NULL;
+            lengths[(*count)++] = NULL;
         }
+        collect_concat_pieces(v, node->data.op_node.right, pieces, lengths, count);
+        return;
+    }
+
+    LLVMValueRef value = accept_gen(v, node);
+    if (type_equals(node->return_type, &TYPE_NUMBER)) {
+        // Convertir números a strings
+        LLVMValueRef buffer_ptr = generate_number_buffer();
+        lengths[*count] = generate_number_to_string(value, buffer_ptr);
+        pieces[(*count)++] = buffer_ptr;
+    } else {
+        lengths[*count] = generate_string_length(value);
+        pieces[(*count)++] = value;
+    }
+}
+
+int generate_concat_pieces(LLVM_Visitor* v, ASTNode* node, LLVMValueRef** pieces, LLVMValueRef** lengths) {
+    int total = count_concat_pieces(node);
+    *pieces = malloc(total * sizeof(LLVMValueRef));
+    *lengths = malloc(total * sizeof(LLVMValueRef));
+    int count = 0;
+
+    collect_concat_pieces(v, node, *pieces, *lengths, &count);
+    return count;
+}
+
+// a @ b @@ c ... se genera como una sola concatenación de n piezas
+static LLVMValueRef generate_concatenation(LLVM_Visitor* v, ASTNode* node) {
+    LLVMValueRef* pieces;
+    LLVMValueRef* lengths;
+    int count = generate_concat_pieces(v, node, &pieces, &lengths);
+    LLVMValueRef result = generate_string_join(pieces, lengths, count);
+
+    free(pieces);
+    free(lengths);
+    return result;
+}
+
+// s := s @ ... sobre un string de un único dueño: crece el buffer de s
+LLVMValueRef generate_in_place_concatenation(LLVM_Visitor* v, ASTNode* node) {
+    int total = count_concat_pieces(node);
+    LLVMValueRef* pieces = malloc(total * sizeof(LLVMValueRef));
+    LLVMValueRef* lengths = malloc(total * sizeof(LLVMValueRef));
+    int count = 0;
+
+    collect_concat_pieces(v, node, pieces, lengths, &count);
+    LLVMValueRef result = generate_string_append(pieces, lengths, count);
+
+    free(pieces);
+    free(lengths);
+    return result;
+}
+
+// x^n con n constante: multiplicación por cuadrados, sin pasar de x^n
+static LLVMValueRef build_integer_power(LLVMValueRef base, long long exponent) {
+    LLVMValueRef result = LLVMConstInt(LLVMInt64Type(), 1, 0);
+    while (exponent > 0) {
+        if (exponent & 1) {
+            result = LLVMBuildMul(builder, result, base, "pow_int");
+        }
+        exponent >>= 1;
+        if (exponent > 0) {
+            base = LLVMBuildMul(builder, base, base, "square_int");
+        }
+    }
+    return result;
+}
+
+LLVMValueRef generate_integer(LLVM_Visitor* v, ASTNode* node) {
+    LLVMTypeRef i64 = LLVMInt64Type();
 
-        if (type_equals(node->data.op_node.right->return_type, &TYPE_NUMBER)) {
-            LLVMTypeRef snprintf_type = LLVMFunctionType(LLVMInt32Type(),
-                (LLVMTypeRef[]){
-                    LLVMPointerType(LLVMInt8Type(), 0),
-                    LLVMInt64Type(),
-                    LLVMPointerType(LLVMInt8Type(), 0)
-                }, 3, 1);
-            LLVMValueRef snprintf_func = LLVMGetNamedFunction(module, "snprintf");
-
-            LLVMValueRef num_buffer = LLVMBuildAlloca(builder,
-                LLVMArrayType(LLVMInt8Type(), 32), "num_buffer");
-            LLVMValueRef buffer_ptr = LLVMBuildBitCast(builder, num_buffer,
-                LLVMPointerType(LLVMInt8Type(), 0), "buffer_cast");
-            
-            LLVMValueRef format = LLVMBuildGlobalStringPtr(builder, "%g", "num_format");
-            LLVMBuildCall2(builder, snprintf_type, snprintf_func,
-                (LLVMValueRef[]){
-                    buffer_ptr,
-                    LLVMConstInt(LLVMInt64Type(), 32, 0),
-                    format,
-                    R
-                }, 4, "");
-            
-            R = buffer_ptr;
+    if (node->type == NODE_NUMBER) {
+        return LLVMConstInt(i64, (long long)node->data.number_value, 1);
+    }
+    if (node->type == NODE_VARIABLE) {
+        LLVMValueRef value = lookup_value(node->data.variable_name);
+        if (value && LLVMTypeOf(value) == i64) {
+            return value;
+        }
+        LLVMValueRef slot = lookup_variable(node->data.variable_name);
+        if (slot && LLVMGetElementType(LLVMTypeOf(slot)) == i64) {
+            return LLVMBuildLoad2(builder, i64, slot, "load_int");
+        }
+    }
+    if (node->type == NODE_UNARY_OP && (node->flags & FLAG_INTEGRAL)) {
+        return LLVMBuildNSWNeg(builder, generate_integer(v, node->data.op_node.left), "neg_int");
+    }
+    if (node->type == NODE_BINARY_OP && (node->flags & FLAG_INTEGRAL)) {
+        // Los operandos y el resultado caben en 53 bits: no hay desbordamiento
+        LLVMValueRef L = generate_integer(v, node->data.op_node.left);
+        switch (node->data.op_node.op) {
+            case OP_POW:
+                return build_integer_power(L, (long long)node->data.op_node.right->data.number_value);
+            case OP_ADD:
+                return LLVMBuildNSWAdd(builder, L, generate_integer(v, node->data.op_node.right), "add_int");
+            case OP_SUB:
+                return LLVMBuildNSWSub(builder, L, generate_integer(v, node->data.op_node.right), "sub_int");
+            case OP_MUL:
+                return LLVMBuildNSWMul(builder, L, generate_integer(v, node->data.op_node.right), "mul_int");
+            case OP_MOD:
+                // El divisor nunca es 0 y el resto lleva el signo del dividendo, como fmod
+                return LLVMBuildSRem(builder, L, generate_integer(v, node->data.op_node.right), "mod_int");
+            default:
+                break;
         }
+    }
+
+    return LLVMBuildFPToSI(builder, accept_gen(v, node), i64, "to_int");
+}
 
-        return generate_string_concatenation(L, R, node->data.op_node.op == OP_DCONCAT);
+static int is_integral_comparison(ASTNode* node) {
+    switch (node->data.op_node.op) {
+        case OP_EQ: case OP_NEQ: case OP_GR: case OP_GRE: case OP_LS: case OP_LSE:
+            return (node->data.op_node.left->flags & FLAG_INTEGRAL) &&
+                (node->data.op_node.right->flags & FLAG_INTEGRAL);
+        default:
+            return 0;
     }
+}
+
+static LLVMValueRef generate_integer_comparison(LLVM_Visitor* v, ASTNode* node) {
+    LLVMValueRef L = generate_integer(v, node->data.op_node.left);
+    LLVMValueRef R = generate_integer(v, node->data.op_node.right);
+    switch (node->data.op_node.op) {
+        case OP_EQ: return LLVMBuildICmp(builder, LLVMIntEQ, L, R, "eq_int");
+        case OP_NEQ: return LLVMBuildICmp(builder, LLVMIntNE, L, R, "neq_int");
+        case OP_GR: return LLVMBuildICmp(builder, LLVMIntSGT, L, R, "gt_int");
+        case OP_GRE: return LLVMBuildICmp(builder, LLVMIntSGE, L, R, "ge_int");
+        case OP_LS: return LLVMBuildICmp(builder, LLVMIntSLT, L, R, "lt_int");
+        default: return LLVMBuildICmp(builder, LLVMIntSLE, L, R, "le_int");
+    }
+}
+
+LLVMValueRef generate_binary_operation(LLVM_Visitor* v, ASTNode* node) {
+    // Manejo de operaciones con strings (concatenación)
+    if (is_concat_node(node)) {
+        return generate_concatenation(v, node);
+    }
+
+    // Aritmética entera: solo se vuelve a double donde se usa el valor
+    if (node->flags & FLAG_INTEGRAL) {
+        return LLVMBuildSIToFP(builder, generate_integer(v, node), LLVMDoubleType(), "to_double");
+    }
+    if (is_integral_comparison(node)) {
+        return generate_integer_comparison(v, node);
+    }
+
+    LLVMValueRef L = accept_gen(v, node->data.op_node.left);
+    LLVMValueRef R = accept_gen(v, node->data.op_node.right);
 
     // Si los operandos son números
     if (type_equals(node->data.op_node.left->return_type, &TYPE_NUMBER)) {
@@ -216,6 +333,10 @@ LLVMValueRef generate_binary_operation(LLVM_Visitor* v, ASTNode* node) {
 }
 
 LLVMValueRef generate_unary_operation(LLVM_Visitor* v, ASTNode* node) {
+    if (node->flags & FLAG_INTEGRAL) {
+        return LLVMBuildSIToFP(builder, generate_integer(v, node), LLVMDoubleType(), "to_double");
+    }
+
     LLVMValueRef operand = accept_gen(v, node->data.op_node.left);
     
     switch (node->data.op_node.op) {
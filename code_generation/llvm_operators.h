@@ -8,6 +8,22 @@
 // Genera código LLVM para operaciones binarias (suma, resta, comparaciones, etc.)
 LLVMValueRef generate_binary_operation(LLVM_Visitor* v, ASTNode* node);
 
+// Si el nodo es un '@' o un '@@'
+int is_concat_node(ASTNode* node);
+
+// Genera los operandos de una cadena de '@'/'@@' sin unirlos: cada pieza es
+// un i8* terminado en '\0' (NULL para el espacio de '@@') con su longitud.
+// Devuelve cuántas hay; el llamador libera los dos arreglos
+int generate_concat_pieces(LLVM_Visitor* v, ASTNode* node, LLVMValueRef** pieces, LLVMValueRef** lengths);
+
+// Genera código LLVM para 's := s @ ...' reutilizando el buffer de s
+LLVMValueRef generate_in_place_concatenation(LLVM_Visitor* v, ASTNode* node);
+
+// Genera como i64 una expresión Number que siempre es un entero exacto
+// (FLAG_INTEGRAL): las operaciones marcadas se hacen con enteros y el resto
+// se convierte desde double
+LLVMValueRef generate_integer(LLVM_Visitor* v, ASTNode* node);
+
 // Genera código LLVM para operaciones unarias (negación, not)
 LLVMValueRef generate_unary_operation(LLVM_Visitor* v, ASTNode* node);
 
@@ -0,0 +1,208 @@
+#include "llvm_output.h"
+#include "llvm_core.h"
+#include "llvm_string.h"
+
+int buffered_output = 0;
+
+static LLVMValueRef output_buffer;
+static LLVMValueRef output_length;
+
+static LLVMTypeRef i8_ptr_type(void) {
+    return LLVMPointerType(LLVMInt8Type(), 0);
+}
+
+static LLVMValueRef call_named(const char* name, LLVMValueRef* args, unsigned count, const char* tmp) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, name);
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func, args, count, tmp);
+}
+
+// void hulk_flush(): escribe el contenido del buffer en stdout
+static void declare_flush_function(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(), NULL, 0, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_flush", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef write_block = LLVMAppendBasicBlock(func, "write");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(func, "done");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef len = LLVMBuildLoad2(builder, LLVMInt64Type(), output_length, "len");
+    LLVMValueRef not_empty = LLVMBuildICmp(builder, LLVMIntNE, len,
+        LLVMConstInt(LLVMInt64Type(), 0, 0), "not_empty");
+    LLVMBuildCondBr(builder, not_empty, write_block, done_block);
+
+    LLVMPositionBuilderAtEnd(builder, write_block);
+    LLVMValueRef zero = LLVMConstInt(LLVMInt64Type(), 0, 0);
+    LLVMValueRef data = LLVMBuildInBoundsGEP2(builder, LLVMGetElementType(LLVMTypeOf(output_buffer)),
+        output_buffer, (LLVMValueRef[]){zero, zero}, 2, "data");
+    call_named("write", (LLVMValueRef[]){LLVMConstInt(LLVMInt32Type(), 1, 0), data, len}, 3, "");
+    LLVMBuildStore(builder, zero, output_length);
+    LLVMBuildBr(builder, done_block);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMBuildRetVoid(builder);
+}
+
+// void hulk_write(i8* str, i64 n): agrega n bytes al buffer, volcándolo si
+// no caben. Los bloques más grandes que el buffer se escriben directamente
+static void declare_write_function(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ i8_ptr_type(), LLVMInt64Type() }, 2, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_write", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMValueRef str = LLVMGetParam(func, 0);
+    LLVMValueRef n = LLVMGetParam(func, 1);
+    LLVMValueRef capacity = LLVMConstInt(LLVMInt64Type(), OUTPUT_BUFFER_SIZE, 0);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef full_block = LLVMAppendBasicBlock(func, "full");
+    LLVMBasicBlockRef direct_block = LLVMAppendBasicBlock(func, "direct");
+    LLVMBasicBlockRef copy_block = LLVMAppendBasicBlock(func, "copy");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef len = LLVMBuildLoad2(builder, LLVMInt64Type(), output_length, "len");
+    LLVMValueRef total = LLVMBuildAdd(builder, len, n, "total");
+    LLVMValueRef fits = LLVMBuildICmp(builder, LLVMIntULE, total, capacity, "fits");
+    LLVMBuildCondBr(builder, fits, copy_block, full_block);
+
+    LLVMPositionBuilderAtEnd(builder, full_block);
+    call_named("hulk_flush", NULL, 0, "");
+    LLVMValueRef too_big = LLVMBuildICmp(builder, LLVMIntUGT, n, capacity, "too_big");
+    LLVMBuildCondBr(builder, too_big, direct_block, copy_block);
+
+    LLVMPositionBuilderAtEnd(builder, direct_block);
+    call_named("write", (LLVMValueRef[]){LLVMConstInt(LLVMInt32Type(), 1, 0), str, n}, 3, "");
+    LLVMBuildRetVoid(builder);
+
+    LLVMPositionBuilderAtEnd(builder, copy_block);
+    LLVMValueRef offset = LLVMBuildLoad2(builder, LLVMInt64Type(), output_length, "offset");
+    LLVMValueRef dest = LLVMBuildInBoundsGEP2(builder, LLVMGetElementType(LLVMTypeOf(output_buffer)),
+        output_buffer, (LLVMValueRef[]){LLVMConstInt(LLVMInt64Type(), 0, 0), offset}, 2, "dest");
+    LLVMBuildMemCpy(builder, dest, 1, str, 1, n);
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, offset, n, "new_len"), output_length);
+    LLVMBuildRetVoid(builder);
+}
+
+// void hulk_print_number(double): formatea el número en un buffer local
+static void declare_print_number_function(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ LLVMDoubleType() }, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_print_number", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(func, "entry"));
+    LLVMTypeRef digits_type = LLVMArrayType(LLVMInt8Type(), 32);
+    LLVMValueRef digits = LLVMBuildAlloca(builder, digits_type, "digits");
+    LLVMValueRef zero = LLVMConstInt(LLVMInt64Type(), 0, 0);
+    LLVMValueRef data = LLVMBuildInBoundsGEP2(builder, digits_type, digits,
+        (LLVMValueRef[]){zero, zero}, 2, "data");
+
+    LLVMValueRef len = generate_number_to_string(LLVMGetParam(func, 0), data);
+    LLVMValueRef newline_ptr = LLVMBuildGEP2(builder, LLVMInt8Type(), data, &len, 1, "newline_ptr");
+    LLVMBuildStore(builder, LLVMConstInt(LLVMInt8Type(), '\n', 0), newline_ptr);
+    LLVMValueRef line_len = LLVMBuildAdd(builder, len, LLVMConstInt(LLVMInt64Type(), 1, 0), "line_len");
+    call_named("hulk_write", (LLVMValueRef[]){data, line_len}, 2, "");
+    LLVMBuildRetVoid(builder);
+}
+
+// void hulk_print_string(i8*)
+static void declare_print_string_function(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ i8_ptr_type() }, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_print_string", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(func, "entry"));
+    LLVMValueRef str = LLVMGetParam(func, 0);
+    LLVMValueRef len = generate_string_length(str);
+    call_named("hulk_write", (LLVMValueRef[]){str, len}, 2, "");
+    call_named("hulk_write", (LLVMValueRef[]){
+        get_global_string("\n", "newline"), LLVMConstInt(LLVMInt64Type(), 1, 0)
+    }, 2, "");
+    LLVMBuildRetVoid(builder);
+}
+
+// void hulk_print_boolean(i1)
+static void declare_print_boolean_function(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ LLVMInt1Type() }, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_print_boolean", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlock(func, "entry"));
+    LLVMValueRef value = LLVMGetParam(func, 0);
+    LLVMValueRef str = LLVMBuildSelect(builder, value,
+        get_global_string("true\n", "true_line"),
+        get_global_string("false\n", "false_line"), "bool_str");
+    LLVMValueRef len = LLVMBuildSelect(builder, value,
+        LLVMConstInt(LLVMInt64Type(), 5, 0),
+        LLVMConstInt(LLVMInt64Type(), 6, 0), "bool_len");
+    call_named("hulk_write", (LLVMValueRef[]){str, len}, 2, "");
+    LLVMBuildRetVoid(builder);
+}
+
+void declare_output_runtime(void) {
+    if (!buffered_output) {
+        return;
+    }
+
+    // i64 write(i32 fd, i8* buf, i64 count)
+    if (!LLVMGetNamedFunction(module, "write")) {
+        LLVMTypeRef write_type = LLVMFunctionType(LLVMInt64Type(),
+            (LLVMTypeRef[]){ LLVMInt32Type(), i8_ptr_type(), LLVMInt64Type() }, 3, 0);
+        LLVMAddFunction(module, "write", write_type);
+    }
+
+    LLVMTypeRef buffer_type = LLVMArrayType(LLVMInt8Type(), OUTPUT_BUFFER_SIZE);
+    output_buffer = LLVMAddGlobal(module, buffer_type, "output_buffer");
+    LLVMSetInitializer(output_buffer, LLVMConstNull(buffer_type));
+    LLVMSetLinkage(output_buffer, LLVMPrivateLinkage);
+
+    output_length = LLVMAddGlobal(module, LLVMInt64Type(), "output_length");
+    LLVMSetInitializer(output_length, LLVMConstInt(LLVMInt64Type(), 0, 0));
+    LLVMSetLinkage(output_length, LLVMPrivateLinkage);
+
+    LLVMBasicBlockRef saved_block = LLVMGetInsertBlock(builder);
+
+    declare_flush_function();
+    declare_write_function();
+    declare_print_number_function();
+    declare_print_string_function();
+    declare_print_boolean_function();
+
+    if (saved_block) {
+        LLVMPositionBuilderAtEnd(builder, saved_block);
+    }
+}
+
+LLVMValueRef build_print_number(LLVMValueRef value) {
+    return call_named("hulk_print_number", &value, 1, "");
+}
+
+LLVMValueRef build_print_string(LLVMValueRef value) {
+    return call_named("hulk_print_string", &value, 1, "");
+}
+
+LLVMValueRef build_print_boolean(LLVMValueRef value) {
+    return call_named("hulk_print_boolean", &value, 1, "");
+}
+
+LLVMValueRef build_print_newline(void) {
+    return call_named("hulk_write", (LLVMValueRef[]){
+        get_global_string("\n", "newline"), LLVMConstInt(LLVMInt64Type(), 1, 0)
+    }, 2, "");
+}
+
+LLVMValueRef build_write(LLVMValueRef str, LLVMValueRef length) {
+    return call_named("hulk_write", (LLVMValueRef[]){str, length}, 2, "");
+}
+
+LLVMValueRef build_output_flush(void) {
+    if (!buffered_output) {
+        return NULL;
+    }
+
+    return call_named("hulk_flush", NULL, 0, "");
+}
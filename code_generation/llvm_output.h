@@ -0,0 +1,28 @@
+#ifndef LLVM_OUTPUT_H
+#define LLVM_OUTPUT_H
+
+#include <llvm-c/Core.h>
+
+// Tamaño del buffer de salida del programa generado
+#define OUTPUT_BUFFER_SIZE 8192
+
+// Si es distinto de 0, print escribe en un buffer en vez de llamar a printf
+// (se activa con el flag --buffered-output del compilador)
+extern int buffered_output;
+
+// Emite en el módulo el buffer global y las funciones de escritura
+void declare_output_runtime(void);
+
+// Llamadas a las rutinas de escritura del buffer
+LLVMValueRef build_print_number(LLVMValueRef value);
+LLVMValueRef build_print_string(LLVMValueRef value);
+LLVMValueRef build_print_boolean(LLVMValueRef value);
+LLVMValueRef build_print_newline(void);
+
+// Agrega 'length' (i64) bytes de 'str' al buffer, sin salto de línea
+LLVMValueRef build_write(LLVMValueRef str, LLVMValueRef length);
+
+// Vuelca la salida pendiente (no hace nada si la salida no usa el buffer)
+LLVMValueRef build_output_flush(void);
+
+#endif // LLVM_OUTPUT_H
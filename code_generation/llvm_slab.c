@@ -0,0 +1,103 @@
+#include "llvm_slab.h"
+#include "llvm_core.h"
+#include <stdio.h>
+
+// Cada tipo tiene una lista libre global (<Tipo>_slab) de instancias sin
+// usar, enlazadas por su primera palabra. Las instancias de un slab son
+// del tamaño exacto del struct, conocido al generar el código
+
+static LLVMTypeRef i8_ptr_type(void) {
+    return LLVMPointerType(LLVMInt8Type(), 0);
+}
+
+// Construye i8* hulk_slab_refill(i64 size, i8** list): reserva un bloque de
+// SLAB_OBJECTS instancias, devuelve la primera y deja el resto enlazadas en
+// la lista libre
+static LLVMValueRef declare_slab_refill(void) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef link_type = LLVMPointerType(i8_ptr_type(), 0);
+    LLVMTypeRef func_type = LLVMFunctionType(i8_ptr_type(), (LLVMTypeRef[]){ i64, link_type }, 2, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_slab_refill", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    LLVMValueRef size = LLVMGetParam(func, 0);
+    LLVMValueRef list = LLVMGetParam(func, 1);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef link_block = LLVMAppendBasicBlock(func, "link");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(func, "done");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef malloc_func = LLVMGetNamedFunction(module, "malloc");
+    LLVMValueRef chunk = LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(malloc_func)), malloc_func,
+        (LLVMValueRef[]){LLVMBuildMul(builder, size, LLVMConstInt(i64, SLAB_OBJECTS, 0), "chunk_size")},
+        1, "chunk");
+    LLVMValueRef last = LLVMBuildGEP2(builder, LLVMInt8Type(), chunk,
+        (LLVMValueRef[]){LLVMBuildMul(builder, size, LLVMConstInt(i64, SLAB_OBJECTS - 1, 0), "")}, 1, "last");
+    LLVMBuildBr(builder, link_block);
+
+    // Del final hacia el principio: cada instancia apunta a la siguiente
+    LLVMPositionBuilderAtEnd(builder, link_block);
+    LLVMValueRef current = LLVMBuildPhi(builder, i8_ptr_type(), "current");
+    LLVMValueRef next = LLVMBuildPhi(builder, i8_ptr_type(), "next");
+    LLVMBuildStore(builder, next, LLVMBuildBitCast(builder, current, link_type, "link"));
+    LLVMValueRef previous = LLVMBuildGEP2(builder, LLVMInt8Type(), current,
+        (LLVMValueRef[]){LLVMBuildNeg(builder, size, "")}, 1, "previous");
+    LLVMValueRef finished = LLVMBuildICmp(builder, LLVMIntEQ, previous, chunk, "finished");
+    LLVMBuildCondBr(builder, finished, done_block, link_block);
+    LLVMAddIncoming(current, (LLVMValueRef[]){last, previous},
+        (LLVMBasicBlockRef[]){entry, link_block}, 2);
+    LLVMAddIncoming(next, (LLVMValueRef[]){LLVMConstNull(i8_ptr_type()), current},
+        (LLVMBasicBlockRef[]){entry, link_block}, 2);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMBuildStore(builder, current, list);
+    LLVMBuildRet(builder, chunk);
+    return func;
+}
+
+static LLVMValueRef get_free_list(LLVMTypeRef struct_type) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s_slab", LLVMGetStructName(struct_type));
+    LLVMValueRef list = LLVMGetNamedGlobal(module, name);
+    if (!list) {
+        list = LLVMAddGlobal(module, i8_ptr_type(), name);
+        LLVMSetInitializer(list, LLVMConstNull(i8_ptr_type()));
+        LLVMSetLinkage(list, LLVMPrivateLinkage);
+    }
+    return list;
+}
+
+LLVMValueRef build_slab_alloc(LLVMTypeRef struct_type) {
+    LLVMValueRef refill = LLVMGetNamedFunction(module, "hulk_slab_refill");
+    LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
+    if (!refill) {
+        refill = declare_slab_refill();
+        LLVMPositionBuilderAtEnd(builder, current_block);
+    }
+
+    LLVMValueRef function = LLVMGetBasicBlockParent(current_block);
+    LLVMBasicBlockRef pop_block = LLVMAppendBasicBlock(function, "slab.pop");
+    LLVMBasicBlockRef refill_block = LLVMAppendBasicBlock(function, "slab.refill");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(function, "slab.done");
+    LLVMValueRef list = get_free_list(struct_type);
+
+    // Camino rápido: sacar la primera instancia de la lista
+    LLVMValueRef head = LLVMBuildLoad2(builder, i8_ptr_type(), list, "slab_head");
+    LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, head, "slab_empty"), refill_block, pop_block);
+
+    LLVMPositionBuilderAtEnd(builder, pop_block);
+    LLVMValueRef link = LLVMBuildBitCast(builder, head, LLVMPointerType(i8_ptr_type(), 0), "slab_link");
+    LLVMBuildStore(builder, LLVMBuildLoad2(builder, i8_ptr_type(), link, "slab_next"), list);
+    LLVMBuildBr(builder, done_block);
+
+    LLVMPositionBuilderAtEnd(builder, refill_block);
+    LLVMValueRef fresh = LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(refill)), refill,
+        (LLVMValueRef[]){LLVMSizeOf(struct_type), list}, 2, "slab_fresh");
+    LLVMBuildBr(builder, done_block);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMValueRef memory = LLVMBuildPhi(builder, i8_ptr_type(), "slab_memory");
+    LLVMAddIncoming(memory, (LLVMValueRef[]){head, fresh},
+        (LLVMBasicBlockRef[]){pop_block, refill_block}, 2);
+    return LLVMBuildBitCast(builder, memory, LLVMPointerType(struct_type, 0), "instance");
+}
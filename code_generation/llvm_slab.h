@@ -0,0 +1,14 @@
+#ifndef LLVM_SLAB_H
+#define LLVM_SLAB_H
+
+#include <llvm-c/Core.h>
+
+// Cantidad de instancias que se reservan juntas cuando se vacía la lista
+// libre de un tipo
+#define SLAB_OBJECTS 64
+
+// Reserva una instancia del struct sacándola de la lista libre de su tipo.
+// Solo se llama a la rutina de relleno cuando la lista está vacía
+LLVMValueRef build_slab_alloc(LLVMTypeRef struct_type);
+
+#endif // LLVM_SLAB_H
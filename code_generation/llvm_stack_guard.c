@@ -0,0 +1,170 @@
+#include "llvm_stack_guard.h"
+#include "llvm_core.h"
+#include <stdio.h>
+
+int stack_guard = 0;
+
+// Constantes de Linux x86-64
+#define SIGSEGV_NUMBER 11
+#define SA_SIGINFO_FLAG 0x4
+#define SA_ONSTACK_FLAG 0x08000000
+#define RLIMIT_STACK_RESOURCE 3
+#define SIGINFO_ADDR_OFFSET 16
+
+static LLVMValueRef stack_base;     // dirección de una variable de main
+static LLVMValueRef stack_limit;    // límite del tamaño de la pila
+
+static LLVMTypeRef i8_ptr_type(void) {
+    return LLVMPointerType(LLVMInt8Type(), 0);
+}
+
+static LLVMValueRef i64_const(long long value) {
+    return LLVMConstInt(LLVMInt64Type(), value, 0);
+}
+
+static LLVMValueRef declare_libc(const char* name, LLVMTypeRef type) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, name);
+    return func ? func : LLVMAddFunction(module, name, type);
+}
+
+static LLVMValueRef call_function(LLVMValueRef func, LLVMValueRef* args, unsigned count, const char* tmp) {
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func, args, count, tmp);
+}
+
+// struct sigaction: { manejador, sa_mask (128 bytes), sa_flags, sa_restorer }
+static LLVMTypeRef sigaction_type(void) {
+    return LLVMStructType((LLVMTypeRef[]){
+        i8_ptr_type(), LLVMArrayType(LLVMInt64Type(), 16), LLVMInt32Type(), i8_ptr_type()
+    }, 4, 0);
+}
+
+// stack_t: { ss_sp, ss_flags, ss_size }
+static LLVMTypeRef signal_stack_type(void) {
+    return LLVMStructType((LLVMTypeRef[]){ i8_ptr_type(), LLVMInt32Type(), LLVMInt64Type() }, 3, 0);
+}
+
+// void hulk_stack_overflow(i32 signal, i8* info, i8* context): si la
+// dirección que falló está en la pila o en su zona de guarda, imprime el
+// error de desbordamiento y termina. Si no, restaura la acción por defecto
+// y la instrucción vuelve a fallar como un SIGSEGV normal
+static void declare_handler(void) {
+    LLVMTypeRef func_type = LLVMFunctionType(LLVMVoidType(),
+        (LLVMTypeRef[]){ LLVMInt32Type(), i8_ptr_type(), i8_ptr_type() }, 3, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_stack_overflow", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    LLVMValueRef info = LLVMGetParam(func, 1);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef overflow_block = LLVMAppendBasicBlock(func, "overflow");
+    LLVMBasicBlockRef other_block = LLVMAppendBasicBlock(func, "other");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef addr_field = LLVMBuildGEP2(builder, LLVMInt8Type(), info,
+        (LLVMValueRef[]){i64_const(SIGINFO_ADDR_OFFSET)}, 1, "addr_field");
+    LLVMValueRef addr = LLVMBuildLoad2(builder, i8_ptr_type(),
+        LLVMBuildBitCast(builder, addr_field, LLVMPointerType(i8_ptr_type(), 0), ""), "addr");
+    LLVMValueRef base = LLVMBuildLoad2(builder, i8_ptr_type(), stack_base, "base");
+    LLVMValueRef limit = LLVMBuildLoad2(builder, LLVMInt64Type(), stack_limit, "limit");
+
+    // La pila crece hacia abajo: distancia = base - dirección
+    LLVMValueRef distance = LLVMBuildSub(builder,
+        LLVMBuildPtrToInt(builder, base, LLVMInt64Type(), ""),
+        LLVMBuildPtrToInt(builder, addr, LLVMInt64Type(), ""), "distance");
+    LLVMValueRef in_stack = LLVMBuildICmp(builder, LLVMIntULE, distance, limit, "in_stack");
+    LLVMValueRef in_gap = LLVMBuildICmp(builder, LLVMIntULE,
+        LLVMBuildSub(builder, distance, limit, ""), i64_const(STACK_GUARD_GAP), "in_gap");
+    LLVMBuildCondBr(builder, LLVMBuildOr(builder, in_stack, in_gap, ""), overflow_block, other_block);
+
+    LLVMPositionBuilderAtEnd(builder, overflow_block);
+    build_output_flush();
+    LLVMValueRef message = get_global_string(
+        RED"!!RUNTIME ERROR: Stack overflow detected.\n"RESET, "stack_overflow_msg");
+    call_function(LLVMGetNamedFunction(module, "puts"), &message, 1, "");
+    LLVMValueRef exit_code = LLVMConstInt(LLVMInt32Type(), 0, 0);
+    call_function(LLVMGetNamedFunction(module, "exit"), &exit_code, 1, "");
+    LLVMBuildUnreachable(builder);
+
+    LLVMPositionBuilderAtEnd(builder, other_block);
+    LLVMValueRef signal_func = declare_libc("signal", LLVMFunctionType(i8_ptr_type(),
+        (LLVMTypeRef[]){ LLVMInt32Type(), i8_ptr_type() }, 2, 0));
+    call_function(signal_func, (LLVMValueRef[]){
+        LLVMConstInt(LLVMInt32Type(), SIGSEGV_NUMBER, 0), LLVMConstNull(i8_ptr_type())
+    }, 2, "");
+    LLVMBuildRetVoid(builder);
+}
+
+void declare_stack_guard_runtime(void) {
+    if (!stack_guard) {
+        return;
+    }
+
+    stack_base = LLVMAddGlobal(module, i8_ptr_type(), "hulk_stack_base");
+    LLVMSetInitializer(stack_base, LLVMConstNull(i8_ptr_type()));
+    LLVMSetLinkage(stack_base, LLVMPrivateLinkage);
+
+    stack_limit = LLVMAddGlobal(module, LLVMInt64Type(), "hulk_stack_limit");
+    LLVMSetInitializer(stack_limit, i64_const(0));
+    LLVMSetLinkage(stack_limit, LLVMPrivateLinkage);
+
+    LLVMBasicBlockRef saved_block = LLVMGetInsertBlock(builder);
+    declare_handler();
+    if (saved_block) {
+        LLVMPositionBuilderAtEnd(builder, saved_block);
+    }
+}
+
+void build_stack_guard_install(void) {
+    if (!stack_guard) {
+        return;
+    }
+
+    LLVMTypeRef i32 = LLVMInt32Type();
+
+    // Base de la pila y límite de su tamaño
+    LLVMValueRef marker = LLVMBuildAlloca(builder, LLVMInt8Type(), "stack_marker");
+    LLVMBuildStore(builder, marker, stack_base);
+    LLVMTypeRef rlimit_type = LLVMStructType((LLVMTypeRef[]){ LLVMInt64Type(), LLVMInt64Type() }, 2, 0);
+    LLVMValueRef rlimit = LLVMBuildAlloca(builder, rlimit_type, "rlimit");
+    LLVMValueRef getrlimit_func = declare_libc("getrlimit", LLVMFunctionType(i32,
+        (LLVMTypeRef[]){ i32, LLVMPointerType(rlimit_type, 0) }, 2, 0));
+    call_function(getrlimit_func, (LLVMValueRef[]){
+        LLVMConstInt(i32, RLIMIT_STACK_RESOURCE, 0), rlimit
+    }, 2, "");
+    LLVMValueRef current = LLVMBuildLoad2(builder, LLVMInt64Type(),
+        LLVMBuildStructGEP2(builder, rlimit_type, rlimit, 0, ""), "stack_size");
+    LLVMValueRef unbounded = LLVMBuildICmp(builder, LLVMIntUGT, current,
+        i64_const(STACK_GUARD_MAX_LIMIT), "unbounded");
+    LLVMValueRef limit = LLVMBuildSelect(builder, unbounded,
+        i64_const(STACK_GUARD_MAX_LIMIT), current, "stack_limit");
+    LLVMBuildStore(builder, limit, stack_limit);
+
+    // Pila alternativa para el manejador (la pila normal ya no tiene espacio)
+    LLVMTypeRef stack_type = signal_stack_type();
+    LLVMValueRef signal_stack = LLVMBuildAlloca(builder, stack_type, "signal_stack");
+    LLVMValueRef malloc_func = LLVMGetNamedFunction(module, "malloc");
+    LLVMValueRef memory = call_function(malloc_func,
+        (LLVMValueRef[]){i64_const(SIGNAL_STACK_SIZE)}, 1, "signal_stack_memory");
+    LLVMBuildStore(builder, memory, LLVMBuildStructGEP2(builder, stack_type, signal_stack, 0, ""));
+    LLVMBuildStore(builder, LLVMConstInt(i32, 0, 0), LLVMBuildStructGEP2(builder, stack_type, signal_stack, 1, ""));
+    LLVMBuildStore(builder, i64_const(SIGNAL_STACK_SIZE), LLVMBuildStructGEP2(builder, stack_type, signal_stack, 2, ""));
+    LLVMValueRef sigaltstack_func = declare_libc("sigaltstack", LLVMFunctionType(i32,
+        (LLVMTypeRef[]){ LLVMPointerType(stack_type, 0), LLVMPointerType(stack_type, 0) }, 2, 0));
+    call_function(sigaltstack_func, (LLVMValueRef[]){
+        signal_stack, LLVMConstNull(LLVMPointerType(stack_type, 0))
+    }, 2, "");
+
+    // sigaction(SIGSEGV) con SA_SIGINFO | SA_ONSTACK
+    LLVMTypeRef action_type = sigaction_type();
+    LLVMValueRef action = LLVMBuildAlloca(builder, action_type, "action");
+    LLVMBuildStore(builder, LLVMConstNull(action_type), action);
+    LLVMValueRef handler = LLVMBuildBitCast(builder,
+        LLVMGetNamedFunction(module, "hulk_stack_overflow"), i8_ptr_type(), "handler");
+    LLVMBuildStore(builder, handler, LLVMBuildStructGEP2(builder, action_type, action, 0, ""));
+    LLVMBuildStore(builder, LLVMConstInt(i32, SA_SIGINFO_FLAG | SA_ONSTACK_FLAG, 0),
+        LLVMBuildStructGEP2(builder, action_type, action, 2, ""));
+    LLVMValueRef sigaction_func = declare_libc("sigaction", LLVMFunctionType(i32,
+        (LLVMTypeRef[]){ i32, LLVMPointerType(action_type, 0), LLVMPointerType(action_type, 0) }, 3, 0));
+    call_function(sigaction_func, (LLVMValueRef[]){
+        LLVMConstInt(i32, SIGSEGV_NUMBER, 0), action, LLVMConstNull(LLVMPointerType(action_type, 0))
+    }, 3, "");
+}
@@ -0,0 +1,30 @@
+#ifndef LLVM_STACK_GUARD_H
+#define LLVM_STACK_GUARD_H
+
+#include <llvm-c/Core.h>
+
+// Tamaño de la pila alternativa donde corre el manejador de SIGSEGV
+#define SIGNAL_STACK_SIZE (64 * 1024)
+
+// Distancia máxima (en bytes) por debajo del límite de la pila a la que un
+// acceso inválido todavía se considera un desbordamiento (la zona de guarda
+// que el kernel deja bajo la pila es de 1MB)
+#define STACK_GUARD_GAP (1 << 20)
+
+// Límite que se usa si el de la pila es mayor (o RLIM_INFINITY, con
+// 'ulimit -s unlimited'): así un acceso inválido al heap o a null no se
+// confunde con un desbordamiento
+#define STACK_GUARD_MAX_LIMIT (1LL << 30)
+
+// Si es distinto de 0, los desbordamientos de la pila se detectan con la
+// página de guarda de la pila y un manejador de SIGSEGV, en vez de contar
+// la profundidad en cada llamada (se activa con el flag --stack-guard)
+extern int stack_guard;
+
+// Emite en el módulo el manejador de SIGSEGV
+void declare_stack_guard_runtime(void);
+
+// Instala el manejador en una pila alternativa (al inicio de main)
+void build_stack_guard_install(void);
+
+#endif // LLVM_STACK_GUARD_H
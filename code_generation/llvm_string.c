@@ -1,5 +1,7 @@
 #include "llvm_string.h"
 #include "llvm_core.h"
+#include "llvm_gc.h"
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -39,81 +41,431 @@ char* process_string_escapes(const char* input) {
     return output;
 }
 
-LLVMValueRef generate_string_concatenation(LLVMValueRef L, LLVMValueRef R, int is_double_concat) {
-    // Declarar strlen si no existe
-    LLVMTypeRef strlen_type = LLVMFunctionType(LLVMInt64Type(),
-        (LLVMTypeRef[]){LLVMPointerType(LLVMInt8Type(), 0)}, 1, 0);
-    LLVMValueRef strlen_func = LLVMGetNamedFunction(module, "strlen");
-
-    // Obtener longitudes de los strings
-    LLVMValueRef len1 = LLVMBuildCall2(builder, strlen_type, strlen_func, 
-        (LLVMValueRef[]){L}, 1, "len1");
-    LLVMValueRef len2 = LLVMBuildCall2(builder, strlen_type, strlen_func,
-        (LLVMValueRef[]){R}, 1, "len2");
-
-    // Calcular tamaño total
-    LLVMValueRef total_len = LLVMBuildAdd(builder, len1, len2, "total_len");
-    if (is_double_concat) {
-        // Agregar 1 para el espacio en @@
-        total_len = LLVMBuildAdd(builder, total_len,
-            LLVMConstInt(LLVMInt64Type(), 1, 0), "total_len_space");
+// Posición de la capacidad y la longitud respecto al primer carácter
+#define STRING_CAPACITY_OFFSET -16
+#define STRING_LENGTH_OFFSET -8
+
+static LLVMValueRef string_header_field(LLVMValueRef str, int offset, const char* name) {
+    LLVMValueRef field = LLVMBuildGEP2(builder, LLVMInt8Type(), str,
+        (LLVMValueRef[]){LLVMConstInt(LLVMInt64Type(), offset, 1)}, 1, name);
+    return LLVMBuildBitCast(builder, field, LLVMPointerType(LLVMInt64Type(), 0), name);
+}
+
+LLVMValueRef generate_string_length(LLVMValueRef str) {
+    LLVMValueRef len_ptr = string_header_field(str, STRING_LENGTH_OFFSET, "len_ptr");
+    return LLVMBuildLoad2(builder, LLVMInt64Type(), len_ptr, "str_len");
+}
+
+// Copia las piezas a partir de buffer + offset; las piezas NULL son el
+// espacio de '@@'. Devuelve el offset final
+static LLVMValueRef copy_string_pieces(
+    LLVMValueRef buffer, LLVMValueRef offset,
+    LLVMValueRef* pieces, LLVMValueRef* lengths, int count
+) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+
+    for (int i = 0; i < count; i++) {
+        LLVMValueRef dest = LLVMBuildGEP2(builder, LLVMInt8Type(), buffer, &offset, 1, "piece_ptr");
+        if (pieces[i]) {
+            LLVMBuildMemCpy(builder, dest, 1, pieces[i], 1, lengths[i]);
+            offset = LLVMBuildAdd(builder, offset, lengths[i], "offset");
+        } else {
+            LLVMBuildStore(builder, LLVMConstInt(LLVMInt8Type(), ' ', 0), dest);
+            offset = LLVMBuildAdd(builder, offset, LLVMConstInt(i64, 1, 0), "offset");
+        }
+    }
+
+    LLVMValueRef end_ptr = LLVMBuildGEP2(builder, LLVMInt8Type(), buffer, &offset, 1, "end_ptr");
+    LLVMBuildStore(builder, LLVMConstInt(LLVMInt8Type(), 0, 0), end_ptr);
+    return offset;
+}
+
+static LLVMValueRef pieces_length(LLVMValueRef* pieces, LLVMValueRef* lengths, int count) {
+    LLVMValueRef total_len = LLVMConstInt(LLVMInt64Type(), 0, 0);
+    for (int i = 0; i < count; i++) {
+        LLVMValueRef len = pieces[i] ? lengths[i] : LLVMConstInt(LLVMInt64Type(), 1, 0);
+        total_len = LLVMBuildAdd(builder, total_len, len, "total_len");
+    }
+    return total_len;
+}
+
+// Memoria para un string nuevo: del heap del recolector si está activo
+static LLVMValueRef allocate_string(LLVMValueRef size) {
+    if (garbage_collection) {
+        return build_gc_alloc(size, NULL);
     }
-    // Agregar 1 para el null terminator
-    total_len = LLVMBuildAdd(builder, total_len,
-        LLVMConstInt(LLVMInt64Type(), 1, 0), "total_len_null");
 
-    // Asignar memoria para el resultado
     LLVMValueRef malloc_func = LLVMGetNamedFunction(module, "malloc");
-    LLVMValueRef buffer = LLVMBuildCall2(builder,
-        LLVMFunctionType(LLVMPointerType(LLVMInt8Type(), 0),
-            (LLVMTypeRef[]){LLVMInt64Type()}, 1, 0),
-        malloc_func, (LLVMValueRef[]){total_len}, 1, "buffer");
-
-    // Copiar primer string
-    LLVMBuildCall2(builder,
-        LLVMFunctionType(LLVMVoidType(),
-            (LLVMTypeRef[]){
-                LLVMPointerType(LLVMInt8Type(), 0),
-                LLVMPointerType(LLVMInt8Type(), 0)
-            }, 2, 0),
-        LLVMGetNamedFunction(module, "strcpy"),
-        (LLVMValueRef[]){buffer, L}, 2, "");
-
-    if (is_double_concat) {
-        // Agregar espacio para @@
-        LLVMValueRef space_ptr = LLVMBuildGEP2(builder,
-            LLVMInt8Type(), buffer,
-            (LLVMValueRef[]){len1}, 1, "space_ptr");
-        LLVMBuildStore(builder,
-            LLVMConstInt(LLVMInt8Type(), ' ', 0),
-            space_ptr);
-
-        // Concatenar segundo string después del espacio
-        LLVMValueRef after_space = LLVMBuildGEP2(builder,
-            LLVMInt8Type(), buffer,
-            (LLVMValueRef[]){
-                LLVMBuildAdd(builder, len1,
-                    LLVMConstInt(LLVMInt64Type(), 1, 0), "")
-            }, 1, "after_space");
-        LLVMBuildCall2(builder,
-            LLVMFunctionType(LLVMVoidType(),
-                (LLVMTypeRef[]){
-                    LLVMPointerType(LLVMInt8Type(), 0),
-                    LLVMPointerType(LLVMInt8Type(), 0)
-                }, 2, 0),
-            LLVMGetNamedFunction(module, "strcpy"),
-            (LLVMValueRef[]){after_space, R}, 2, "");
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(malloc_func)),
+        malloc_func, &size, 1, "str_memory");
+}
+
+LLVMValueRef generate_string_join(LLVMValueRef* pieces, LLVMValueRef* lengths, int count) {
+    LLVMTypeRef i64 = LLVMInt64Type();
+
+    // Tamaño total: una sola suma para toda la cadena de concatenaciones
+    LLVMValueRef total_len = pieces_length(pieces, lengths, count);
+
+    // Una sola reserva: cabecera + caracteres + '\0'
+    LLVMValueRef alloc_size = LLVMBuildAdd(builder, total_len,
+        LLVMConstInt(i64, STRING_HEADER_SIZE + 1, 0), "alloc_size");
+    LLVMValueRef memory = allocate_string(alloc_size);
+    LLVMValueRef buffer = LLVMBuildGEP2(builder, LLVMInt8Type(), memory,
+        (LLVMValueRef[]){LLVMConstInt(i64, STRING_HEADER_SIZE, 0)}, 1, "str_data");
+    LLVMBuildStore(builder, total_len, string_header_field(buffer, STRING_CAPACITY_OFFSET, "cap_ptr"));
+    LLVMBuildStore(builder, total_len, string_header_field(buffer, STRING_LENGTH_OFFSET, "len_ptr"));
+
+    // Una copia por pieza
+    copy_string_pieces(buffer, LLVMConstInt(i64, 0, 0), pieces, lengths, count);
+    return buffer;
+}
+
+// Construye i8* hulk_string_reserve(i8* str, i64 extra): devuelve un string
+// con el contenido de str y capacidad para 'extra' caracteres más. Si no
+// alcanza, la capacidad al menos se duplica (con realloc, o copiando si str
+// no se puede ampliar), de modo que agregar al final cuesta O(1) amortizado.
+// Con el recolector siempre se copia: el bloque viejo queda para el recolector
+static LLVMValueRef declare_string_reserve(void) {
+    LLVMTypeRef i8_ptr = LLVMPointerType(LLVMInt8Type(), 0);
+    LLVMTypeRef i64 = LLVMInt64Type();
+
+    if (!LLVMGetNamedFunction(module, "realloc")) {
+        LLVMAddFunction(module, "realloc", LLVMFunctionType(i8_ptr,
+            (LLVMTypeRef[]){i8_ptr, i64}, 2, 0));
+    }
+
+    LLVMTypeRef func_type = LLVMFunctionType(i8_ptr, (LLVMTypeRef[]){i8_ptr, i64}, 2, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_string_reserve", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    LLVMValueRef str = LLVMGetParam(func, 0);
+    LLVMValueRef extra = LLVMGetParam(func, 1);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef grow_block = LLVMAppendBasicBlock(func, "grow");
+    LLVMBasicBlockRef copy_block = LLVMAppendBasicBlock(func, "copy");
+    LLVMBasicBlockRef realloc_block = LLVMAppendBasicBlock(func, "realloc");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(func, "done");
+
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef len = generate_string_length(str);
+    LLVMValueRef cap = LLVMBuildLoad2(builder, i64,
+        string_header_field(str, STRING_CAPACITY_OFFSET, "cap_ptr"), "cap");
+    LLVMValueRef needed = LLVMBuildAdd(builder, len, extra, "needed");
+    LLVMValueRef fits = LLVMBuildICmp(builder, LLVMIntULE, needed, cap, "fits");
+    LLVMBuildCondBr(builder, fits, done_block, grow_block);
+
+    LLVMPositionBuilderAtEnd(builder, grow_block);
+    LLVMValueRef doubled = LLVMBuildMul(builder, cap, LLVMConstInt(i64, 2, 0), "doubled");
+    LLVMValueRef new_cap = LLVMBuildSelect(builder,
+        LLVMBuildICmp(builder, LLVMIntUGT, doubled, needed, ""), doubled, needed, "new_cap");
+    new_cap = LLVMBuildSelect(builder,
+        LLVMBuildICmp(builder, LLVMIntULT, new_cap, LLVMConstInt(i64, 32, 0), ""),
+        LLVMConstInt(i64, 32, 0), new_cap, "min_cap");
+    LLVMValueRef alloc_size = LLVMBuildAdd(builder, new_cap,
+        LLVMConstInt(i64, STRING_HEADER_SIZE + 1, 0), "alloc_size");
+    LLVMValueRef growable = garbage_collection ? LLVMConstInt(LLVMInt1Type(), 0, 0) :
+        LLVMBuildICmp(builder, LLVMIntNE, cap, LLVMConstInt(i64, 0, 0), "growable");
+    LLVMBuildCondBr(builder, growable, realloc_block, copy_block);
+
+    // copy: strings constantes, se copian a un buffer nuevo
+    LLVMPositionBuilderAtEnd(builder, copy_block);
+    LLVMValueRef new_memory = allocate_string(alloc_size);
+    LLVMValueRef copy_data = LLVMBuildGEP2(builder, LLVMInt8Type(), new_memory,
+        (LLVMValueRef[]){LLVMConstInt(i64, STRING_HEADER_SIZE, 0)}, 1, "copy_data");
+    LLVMBuildMemCpy(builder, copy_data, 1, str, 1, len);
+    LLVMBuildBr(builder, done_block);
+
+    // realloc: el string ya vive en el heap y es de un único dueño
+    LLVMPositionBuilderAtEnd(builder, realloc_block);
+    LLVMValueRef old_memory = LLVMBuildGEP2(builder, LLVMInt8Type(), str,
+        (LLVMValueRef[]){LLVMConstInt(i64, -STRING_HEADER_SIZE, 1)}, 1, "old_memory");
+    LLVMValueRef realloc_func = LLVMGetNamedFunction(module, "realloc");
+    LLVMValueRef grown_memory = LLVMBuildCall2(builder,
+        LLVMGetElementType(LLVMTypeOf(realloc_func)), realloc_func,
+        (LLVMValueRef[]){old_memory, alloc_size}, 2, "grown_memory");
+    LLVMValueRef grown_data = LLVMBuildGEP2(builder, LLVMInt8Type(), grown_memory,
+        (LLVMValueRef[]){LLVMConstInt(i64, STRING_HEADER_SIZE, 0)}, 1, "grown_data");
+    LLVMBuildBr(builder, done_block);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMValueRef result = LLVMBuildPhi(builder, i8_ptr, "result");
+    LLVMValueRef capacity = LLVMBuildPhi(builder, i64, "capacity");
+    LLVMAddIncoming(result, (LLVMValueRef[]){str, copy_data, grown_data},
+        (LLVMBasicBlockRef[]){entry, copy_block, realloc_block}, 3);
+    LLVMAddIncoming(capacity, (LLVMValueRef[]){cap, new_cap, new_cap},
+        (LLVMBasicBlockRef[]){entry, copy_block, realloc_block}, 3);
+    LLVMBuildStore(builder, capacity, string_header_field(result, STRING_CAPACITY_OFFSET, "cap_ptr"));
+    LLVMBuildStore(builder, len, string_header_field(result, STRING_LENGTH_OFFSET, "len_ptr"));
+    LLVMBuildRet(builder, result);
+
+    return func;
+}
+
+LLVMValueRef generate_string_append(LLVMValueRef* pieces, LLVMValueRef* lengths, int count) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, "hulk_string_reserve");
+    if (!func) {
+        LLVMBasicBlockRef saved_block = LLVMGetInsertBlock(builder);
+        func = declare_string_reserve();
+        LLVMPositionBuilderAtEnd(builder, saved_block);
+    }
+
+    // pieces[0] es el string que crece; el resto se copia a continuación
+    LLVMValueRef extra = pieces_length(pieces + 1, lengths + 1, count - 1);
+    LLVMValueRef target = LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func,
+        (LLVMValueRef[]){pieces[0], extra}, 2, "reserved");
+
+    LLVMValueRef new_len = copy_string_pieces(target, lengths[0], pieces + 1, lengths + 1, count - 1);
+    LLVMBuildStore(builder, new_len, string_header_field(target, STRING_LENGTH_OFFSET, "len_ptr"));
+    return target;
+}
+
+// <----------NUMBER TO STRING---------->
+
+static LLVMValueRef call_runtime(const char* name, LLVMValueRef* args, unsigned count, const char* tmp) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, name);
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func, args, count, tmp);
+}
+
+static void declare_math_function(const char* name) {
+    if (!LLVMGetNamedFunction(module, name)) {
+        LLVMAddFunction(module, name, LLVMFunctionType(LLVMDoubleType(),
+            (LLVMTypeRef[]){LLVMDoubleType()}, 1, 0));
+    }
+}
+
+// Tabla constante de potencias de 10 (10^0 .. 10^(count-1))
+static LLVMValueRef pow10_table(const char* name, LLVMTypeRef elem_type, int count) {
+    LLVMValueRef values[10];
+    double power = 1.0;
+    for (int i = 0; i < count; i++) {
+        values[i] = elem_type == LLVMDoubleType() ?
+            LLVMConstReal(elem_type, power) :
+            LLVMConstInt(elem_type, (unsigned long long)power, 0);
+        power *= 10.0;
+    }
+
+    LLVMTypeRef table_type = LLVMArrayType(elem_type, count);
+    LLVMValueRef table = LLVMAddGlobal(module, table_type, name);
+    LLVMSetInitializer(table, LLVMConstArray(elem_type, values, count));
+    LLVMSetGlobalConstant(table, 1);
+    LLVMSetLinkage(table, LLVMPrivateLinkage);
+    return table;
+}
+
+static LLVMValueRef load_from_table(LLVMValueRef table, LLVMTypeRef elem_type, LLVMValueRef index, const char* tmp) {
+    LLVMValueRef ptr = LLVMBuildInBoundsGEP2(builder, LLVMGetElementType(LLVMTypeOf(table)), table,
+        (LLVMValueRef[]){LLVMConstInt(LLVMInt32Type(), 0, 0), index}, 2, "entry_ptr");
+    return LLVMBuildLoad2(builder, elem_type, ptr, tmp);
+}
+
+// Construye i64 hulk_format_number(double x, i8* out): escribe x en out (al
+// menos 32 bytes) con la misma salida que "%g" y devuelve la longitud.
+// Los enteros de hasta 6 cifras y los valores en notación decimal se
+// formatean con aritmética entera; la notación exponencial, NaN, infinito
+// y los casos a mitad de redondeo (donde no se puede garantizar el mismo
+// resultado que snprintf) se delegan a snprintf
+static LLVMValueRef declare_number_formatter(void) {
+    LLVMTypeRef i8_ptr = LLVMPointerType(LLVMInt8Type(), 0);
+    LLVMTypeRef i32 = LLVMInt32Type();
+    LLVMTypeRef i64 = LLVMInt64Type();
+    LLVMTypeRef dbl = LLVMDoubleType();
+
+    declare_math_function("log10");
+    declare_math_function("floor");
+    LLVMValueRef pow10_real = pow10_table("pow10_real", dbl, 10);
+    LLVMValueRef pow10_int = pow10_table("pow10_int", i32, 6);
+
+    LLVMTypeRef func_type = LLVMFunctionType(i64, (LLVMTypeRef[]){dbl, i8_ptr}, 2, 0);
+    LLVMValueRef func = LLVMAddFunction(module, "hulk_format_number", func_type);
+    LLVMSetLinkage(func, LLVMPrivateLinkage);
+    LLVMValueRef x = LLVMGetParam(func, 0);
+    LLVMValueRef out = LLVMGetParam(func, 1);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "entry");
+    LLVMBasicBlockRef small_block = LLVMAppendBasicBlock(func, "small");
+    LLVMBasicBlockRef int_block = LLVMAppendBasicBlock(func, "integer");
+    LLVMBasicBlockRef general_block = LLVMAppendBasicBlock(func, "general");
+    LLVMBasicBlockRef scale_block = LLVMAppendBasicBlock(func, "scale");
+    LLVMBasicBlockRef strip_block = LLVMAppendBasicBlock(func, "strip");
+    LLVMBasicBlockRef emit_block = LLVMAppendBasicBlock(func, "emit");
+    LLVMBasicBlockRef loop_block = LLVMAppendBasicBlock(func, "loop");
+    LLVMBasicBlockRef done_block = LLVMAppendBasicBlock(func, "done");
+    LLVMBasicBlockRef fallback_block = LLVMAppendBasicBlock(func, "fallback");
+
+    // entry: signo, valor absoluto y descarte de NaN/infinito
+    LLVMPositionBuilderAtEnd(builder, entry);
+    LLVMValueRef bits = LLVMBuildBitCast(builder, x, i64, "bits");
+    LLVMValueRef negative = LLVMBuildICmp(builder, LLVMIntSLT, bits, LLVMConstInt(i64, 0, 0), "negative");
+    LLVMValueRef ax = LLVMBuildSelect(builder, negative, LLVMBuildFNeg(builder, x, "neg_x"), x, "abs_x");
+    LLVMValueRef finite = LLVMBuildFCmp(builder, LLVMRealOLT, ax, LLVMConstReal(dbl, INFINITY), "finite");
+    LLVMBuildCondBr(builder, finite, small_block, fallback_block);
+
+    // small: los enteros menores que 10^6 se imprimen sin exponente
+    LLVMPositionBuilderAtEnd(builder, small_block);
+    LLVMValueRef small = LLVMBuildFCmp(builder, LLVMRealOLT, ax, LLVMConstReal(dbl, 1e6), "is_small");
+    LLVMBuildCondBr(builder, small, int_block, general_block);
+
+    LLVMPositionBuilderAtEnd(builder, int_block);
+    LLVMValueRef int_value = LLVMBuildFPToUI(builder, ax, i32, "int_value");
+    LLVMValueRef is_int = LLVMBuildFCmp(builder, LLVMRealOEQ,
+        LLVMBuildUIToFP(builder, int_value, dbl, "back"), ax, "is_int");
+    LLVMValueRef int_digits = LLVMConstInt(i32, 1, 0);
+    for (int threshold = 10; threshold <= 100000; threshold *= 10) {
+        LLVMValueRef ge = LLVMBuildICmp(builder, LLVMIntUGE, int_value,
+            LLVMConstInt(i32, threshold, 0), "ge");
+        int_digits = LLVMBuildAdd(builder, int_digits, LLVMBuildZExt(builder, ge, i32, ""), "int_digits");
+    }
+    LLVMValueRef int_exp = LLVMBuildSub(builder, int_digits, LLVMConstInt(i32, 1, 0), "int_exp");
+    LLVMBuildCondBr(builder, is_int, emit_block, general_block);
+
+    // general: exponente decimal e = floor(log10(|x|)), solo notación decimal
+    LLVMPositionBuilderAtEnd(builder, general_block);
+    LLVMValueRef log_value = call_runtime("log10", &ax, 1, "log_value");
+    LLVMValueRef exp_value = LLVMBuildFPToSI(builder, call_runtime("floor", &log_value, 1, "floor_log"), i32, "exp");
+    LLVMValueRef in_range = LLVMBuildAnd(builder,
+        LLVMBuildICmp(builder, LLVMIntSGE, exp_value, LLVMConstInt(i32, -4, 1), ""),
+        LLVMBuildICmp(builder, LLVMIntSLE, exp_value, LLVMConstInt(i32, 5, 0), ""), "in_range");
+    LLVMBuildCondBr(builder, in_range, scale_block, fallback_block);
+
+    // scale: mantisa de 6 cifras redondeada al más cercano
+    LLVMPositionBuilderAtEnd(builder, scale_block);
+    LLVMValueRef k = LLVMBuildSub(builder, LLVMConstInt(i32, 5, 0), exp_value, "k");
+    LLVMValueRef scaled = LLVMBuildFMul(builder, ax, load_from_table(pow10_real, dbl, k, "pow10"), "scaled");
+    LLVMValueRef floor_scaled = call_runtime("floor", &scaled, 1, "floor_scaled");
+    LLVMValueRef frac = LLVMBuildFSub(builder, scaled, floor_scaled, "frac");
+    LLVMValueRef half_dist = LLVMBuildFSub(builder, frac, LLVMConstReal(dbl, 0.5), "half_dist");
+    LLVMValueRef not_half = LLVMBuildOr(builder,
+        LLVMBuildFCmp(builder, LLVMRealOGT, half_dist, LLVMConstReal(dbl, 1e-6), ""),
+        LLVMBuildFCmp(builder, LLVMRealOLT, half_dist, LLVMConstReal(dbl, -1e-6), ""), "not_half");
+    LLVMValueRef six_digits = LLVMBuildAnd(builder,
+        LLVMBuildFCmp(builder, LLVMRealOGE, scaled, LLVMConstReal(dbl, 1e5), ""),
+        LLVMBuildFCmp(builder, LLVMRealOLT, scaled, LLVMConstReal(dbl, 1e6), ""), "six_digits");
+    LLVMValueRef mantissa = LLVMBuildAdd(builder,
+        LLVMBuildFPToUI(builder, floor_scaled, i32, "floor_int"),
+        LLVMBuildZExt(builder, LLVMBuildFCmp(builder, LLVMRealOGT, frac, LLVMConstReal(dbl, 0.5), ""), i32, ""),
+        "mantissa");
+    LLVMValueRef carry = LLVMBuildICmp(builder, LLVMIntEQ, mantissa, LLVMConstInt(i32, 1000000, 0), "carry");
+    mantissa = LLVMBuildSelect(builder, carry, LLVMConstInt(i32, 100000, 0), mantissa, "mantissa_carry");
+    LLVMValueRef round_exp = LLVMBuildAdd(builder, exp_value, LLVMBuildZExt(builder, carry, i32, ""), "round_exp");
+    LLVMValueRef decimal = LLVMBuildICmp(builder, LLVMIntSLE, round_exp, LLVMConstInt(i32, 5, 0), "decimal");
+    LLVMValueRef ok = LLVMBuildAnd(builder, LLVMBuildAnd(builder, not_half, six_digits, ""), decimal, "ok");
+    LLVMBuildCondBr(builder, ok, strip_block, fallback_block);
+
+    // strip: quitar los ceros finales de la mantisa (a lo sumo 5)
+    LLVMPositionBuilderAtEnd(builder, strip_block);
+    LLVMValueRef digits = LLVMConstInt(i32, 6, 0);
+    LLVMValueRef ten = LLVMConstInt(i32, 10, 0);
+    for (int i = 0; i < 5; i++) {
+        LLVMValueRef zero_digit = LLVMBuildICmp(builder, LLVMIntEQ,
+            LLVMBuildURem(builder, mantissa, ten, ""), LLVMConstInt(i32, 0, 0), "zero_digit");
+        mantissa = LLVMBuildSelect(builder, zero_digit,
+            LLVMBuildUDiv(builder, mantissa, ten, ""), mantissa, "stripped");
+        digits = LLVMBuildSub(builder, digits, LLVMBuildZExt(builder, zero_digit, i32, ""), "digits");
+    }
+    LLVMBuildBr(builder, emit_block);
+
+    // emit: se recorren las posiciones decimales desde max(e, 0) hasta
+    // min(0, e - digits + 1); la cifra de la posición p es la (e - p)-ésima
+    LLVMPositionBuilderAtEnd(builder, emit_block);
+    LLVMValueRef m_phi = LLVMBuildPhi(builder, i32, "m");
+    LLVMValueRef nd_phi = LLVMBuildPhi(builder, i32, "nd");
+    LLVMValueRef e_phi = LLVMBuildPhi(builder, i32, "e");
+    LLVMAddIncoming(m_phi, (LLVMValueRef[]){int_value, mantissa}, (LLVMBasicBlockRef[]){int_block, strip_block}, 2);
+    LLVMAddIncoming(nd_phi, (LLVMValueRef[]){int_digits, digits}, (LLVMBasicBlockRef[]){int_block, strip_block}, 2);
+    LLVMAddIncoming(e_phi, (LLVMValueRef[]){int_exp, round_exp}, (LLVMBasicBlockRef[]){int_block, strip_block}, 2);
+
+    LLVMValueRef zero32 = LLVMConstInt(i32, 0, 0);
+    LLVMValueRef e_positive = LLVMBuildICmp(builder, LLVMIntSGT, e_phi, zero32, "");
+    LLVMValueRef start = LLVMBuildSelect(builder, e_positive, e_phi, zero32, "start");
+    LLVMValueRef last_digit = LLVMBuildAdd(builder, LLVMBuildSub(builder, e_phi, nd_phi, ""),
+        LLVMConstInt(i32, 1, 0), "last_digit");
+    LLVMValueRef last_negative = LLVMBuildICmp(builder, LLVMIntSLT, last_digit, zero32, "");
+    LLVMValueRef end = LLVMBuildSelect(builder, last_negative, last_digit, zero32, "end");
+    LLVMBuildStore(builder, LLVMConstInt(LLVMInt8Type(), '-', 0), out);
+    LLVMValueRef first_pos = LLVMBuildZExt(builder, negative, i64, "first_pos");
+    LLVMBuildBr(builder, loop_block);
+
+    LLVMPositionBuilderAtEnd(builder, loop_block);
+    LLVMValueRef p_phi = LLVMBuildPhi(builder, i32, "p");
+    LLVMValueRef pos_phi = LLVMBuildPhi(builder, i64, "pos");
+
+    // el punto se escribe siempre y solo se avanza sobre él en p == -1
+    LLVMBuildStore(builder, LLVMConstInt(LLVMInt8Type(), '.', 0),
+        LLVMBuildGEP2(builder, LLVMInt8Type(), out, &pos_phi, 1, "dot_ptr"));
+    LLVMValueRef is_dot = LLVMBuildICmp(builder, LLVMIntEQ, p_phi, LLVMConstInt(i32, -1, 1), "is_dot");
+    LLVMValueRef digit_pos = LLVMBuildAdd(builder, pos_phi, LLVMBuildZExt(builder, is_dot, i64, ""), "digit_pos");
+
+    LLVMValueRef index = LLVMBuildSub(builder, e_phi, p_phi, "index");
+    LLVMValueRef has_digit = LLVMBuildAnd(builder,
+        LLVMBuildICmp(builder, LLVMIntSGE, index, zero32, ""),
+        LLVMBuildICmp(builder, LLVMIntSLT, index, nd_phi, ""), "has_digit");
+    LLVMValueRef shift = LLVMBuildSub(builder, LLVMBuildSub(builder, nd_phi, index, ""),
+        LLVMConstInt(i32, 1, 0), "shift");
+    shift = LLVMBuildSelect(builder, has_digit, shift, zero32, "safe_shift");
+    LLVMValueRef digit = LLVMBuildURem(builder,
+        LLVMBuildUDiv(builder, m_phi, load_from_table(pow10_int, i32, shift, "divisor"), ""), ten, "digit");
+    digit = LLVMBuildSelect(builder, has_digit, digit, zero32, "digit_or_zero");
+    LLVMValueRef digit_char = LLVMBuildTrunc(builder,
+        LLVMBuildAdd(builder, digit, LLVMConstInt(i32, '0', 0), ""), LLVMInt8Type(), "digit_char");
+    LLVMBuildStore(builder, digit_char, LLVMBuildGEP2(builder, LLVMInt8Type(), out, &digit_pos, 1, "digit_ptr"));
+    LLVMValueRef next_pos = LLVMBuildAdd(builder, digit_pos, LLVMConstInt(i64, 1, 0), "next_pos");
+    LLVMValueRef next_p = LLVMBuildSub(builder, p_phi, LLVMConstInt(i32, 1, 0), "next_p");
+    LLVMValueRef more = LLVMBuildICmp(builder, LLVMIntSGE, next_p, end, "more");
+    LLVMBuildCondBr(builder, more, loop_block, done_block);
+
+    LLVMAddIncoming(p_phi, (LLVMValueRef[]){start, next_p}, (LLVMBasicBlockRef[]){emit_block, loop_block}, 2);
+    LLVMAddIncoming(pos_phi, (LLVMValueRef[]){first_pos, next_pos}, (LLVMBasicBlockRef[]){emit_block, loop_block}, 2);
+
+    LLVMPositionBuilderAtEnd(builder, done_block);
+    LLVMBuildStore(builder, LLVMConstInt(LLVMInt8Type(), 0, 0),
+        LLVMBuildGEP2(builder, LLVMInt8Type(), out, &next_pos, 1, "end_ptr"));
+    LLVMBuildRet(builder, next_pos);
+
+    // fallback: exponente, NaN, infinito o redondeo dudoso
+    LLVMPositionBuilderAtEnd(builder, fallback_block);
+    LLVMValueRef len = call_runtime("snprintf", (LLVMValueRef[]){
+        out, LLVMConstInt(i64, 32, 0), get_global_string("%g", "num_format"), x
+    }, 4, "len");
+    LLVMBuildRet(builder, LLVMBuildSExt(builder, len, i64, "len64"));
+
+    return func;
+}
+
+LLVMValueRef get_number_formatter(void) {
+    LLVMValueRef func = LLVMGetNamedFunction(module, "hulk_format_number");
+    if (func) {
+        return func;
+    }
+
+    LLVMBasicBlockRef saved_block = LLVMGetInsertBlock(builder);
+    func = declare_number_formatter();
+    if (saved_block) {
+        LLVMPositionBuilderAtEnd(builder, saved_block);
+    }
+    return func;
+}
+
+LLVMValueRef generate_number_buffer(void) {
+    // El buffer se reserva en el bloque de entrada para no crecer la pila en los bucles
+    LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
+    LLVMBasicBlockRef entry_block = LLVMGetEntryBasicBlock(LLVMGetBasicBlockParent(current_block));
+    LLVMValueRef first = LLVMGetFirstInstruction(entry_block);
+    if (first) {
+        LLVMPositionBuilderBefore(builder, first);
     } else {
-        // Concatenar directamente para @
-        LLVMBuildCall2(builder,
-            LLVMFunctionType(LLVMVoidType(),
-                (LLVMTypeRef[]){
-                    LLVMPointerType(LLVMInt8Type(), 0),
-                    LLVMPointerType(LLVMInt8Type(), 0)
-                }, 2, 0),
-            LLVMGetNamedFunction(module, "strcat"),
-            (LLVMValueRef[]){buffer, R}, 2, "");
+        LLVMPositionBuilderAtEnd(builder, entry_block);
     }
 
-    return buffer;
-}
\ No newline at end of file
+    LLVMValueRef num_buffer = LLVMBuildAlloca(builder,
+        LLVMArrayType(LLVMInt8Type(), 32), "num_buffer");
+    LLVMPositionBuilderAtEnd(builder, current_block);
+
+    return LLVMBuildBitCast(builder, num_buffer,
+        LLVMPointerType(LLVMInt8Type(), 0), "buffer_cast");
+}
+
+LLVMValueRef generate_number_to_string(LLVMValueRef value, LLVMValueRef buffer) {
+    LLVMValueRef func = get_number_formatter();
+    return LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(func)), func,
+        (LLVMValueRef[]){value, buffer}, 2, "num_len");
+}
@@ -3,10 +3,33 @@
 
 #include <llvm-c/Core.h>
 
+// Los strings de HULK son i8* a los caracteres (terminados en '\0') y
+// llevan una cabecera con su capacidad y su longitud en los 16 bytes
+// anteriores. Capacidad 0 indica un string que no se puede ampliar
+#define STRING_HEADER_SIZE 16
+
 // Procesa los caracteres de escape en un string
 char* process_string_escapes(const char* input);
 
-// Genera código LLVM para concatenación de strings
-LLVMValueRef generate_string_concatenation(LLVMValueRef L, LLVMValueRef R, int is_double_concat);
+// Longitud (i64) de un string de HULK, leída de su cabecera
+LLVMValueRef generate_string_length(LLVMValueRef str);
+
+// Concatena 'count' piezas (i8* y longitud) con una sola reserva de memoria.
+// Una pieza NULL representa el espacio que agrega '@@'
+LLVMValueRef generate_string_join(LLVMValueRef* pieces, LLVMValueRef* lengths, int count);
+
+// Agrega las piezas 1..count-1 al final de pieces[0] reutilizando su buffer
+// cuando tiene capacidad. Devuelve el string resultante (puede moverse)
+LLVMValueRef generate_string_append(LLVMValueRef* pieces, LLVMValueRef* lengths, int count);
+
+// Devuelve (creándola si hace falta) la rutina que formatea un Number
+// con la misma salida que "%g"
+LLVMValueRef get_number_formatter(void);
+
+// Buffer de 32 bytes para formatear un número (reservado en el bloque de entrada)
+LLVMValueRef generate_number_buffer(void);
+
+// Escribe el número en buffer (al menos 32 bytes) y devuelve su longitud (i64)
+LLVMValueRef generate_number_to_string(LLVMValueRef value, LLVMValueRef buffer);
 
 #endif // LLVM_STRING_H
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "llvm_tagged.h"
+#include "llvm_core.h"
+#include "llvm_codegen.h"
+
+// Cualquier NaN se guarda como el NaN canónico (positivo), así ningún
+// Number se confunde con un valor etiquetado
+#define CANONICAL_NAN 0x7FF8000000000000ULL
+
+static LLVMTypeRef object_ptr_type(void) {
+    return LLVMPointerType(object_type, 0);
+}
+
+static LLVMValueRef i64_const(unsigned long long value) {
+    return LLVMConstInt(LLVMInt64Type(), value, 0);
+}
+
+static LLVMValueRef tagged(LLVMValueRef payload, unsigned long long tag) {
+    LLVMValueRef bits = LLVMBuildOr(builder, payload, i64_const(tag << TAG_SHIFT), "tagged_bits");
+    return LLVMBuildIntToPtr(builder, bits, object_ptr_type(), "boxed");
+}
+
+static LLVMValueRef bits_of(LLVMValueRef boxed) {
+    return LLVMBuildPtrToInt(builder, boxed, LLVMInt64Type(), "object_bits");
+}
+
+LLVMValueRef build_tagged_null(void) {
+    return LLVMConstIntToPtr(i64_const(TAG_NULL << TAG_SHIFT), object_ptr_type());
+}
+
+LLVMValueRef box_value(LLVMValueRef value) {
+    LLVMTypeRef type = LLVMTypeOf(value);
+    if (type == object_ptr_type()) {
+        return value;
+    }
+
+    switch (LLVMGetTypeKind(type)) {
+        case LLVMDoubleTypeKind: {
+            LLVMValueRef bits = LLVMBuildBitCast(builder, value, LLVMInt64Type(), "number_bits");
+            LLVMValueRef is_nan = LLVMBuildFCmp(builder, LLVMRealUNO, value, value, "is_nan");
+            bits = LLVMBuildSelect(builder, is_nan, i64_const(CANONICAL_NAN), bits, "number_bits");
+            return LLVMBuildIntToPtr(builder, bits, object_ptr_type(), "boxed");
+        }
+        case LLVMIntegerTypeKind:
+            return tagged(LLVMBuildZExt(builder, value, LLVMInt64Type(), "bool_bits"), TAG_BOOLEAN);
+        case LLVMPointerTypeKind: {
+            LLVMTypeRef element = LLVMGetElementType(type);
+            if (LLVMGetTypeKind(element) == LLVMIntegerTypeKind) {
+                return tagged(LLVMBuildPtrToInt(builder, value, LLVMInt64Type(), "string_bits"), TAG_STRING);
+            }
+            if (LLVMGetTypeKind(element) == LLVMPointerTypeKind) {
+                // las variables de tipos definidos por el usuario llegan como T**
+                value = LLVMBuildLoad2(builder, element, value, "instance");
+            }
+            return tagged(LLVMBuildPtrToInt(builder, value, LLVMInt64Type(), "instance_bits"), TAG_INSTANCE);
+        }
+        default:
+            return value;
+    }
+}
+
+LLVMValueRef unbox_value(LLVMValueRef boxed, Type* type) {
+    if (type->sub_type) {
+        type = type->sub_type;
+    }
+
+    if (type_equals(type, &TYPE_OBJECT)) {
+        return boxed;
+    }
+
+    LLVMValueRef bits = bits_of(boxed);
+    if (type_equals(type, &TYPE_NUMBER)) {
+        return LLVMBuildBitCast(builder, bits, LLVMDoubleType(), "unboxed");
+    }
+    if (type_equals(type, &TYPE_BOOLEAN)) {
+        return LLVMBuildTrunc(builder, bits, LLVMInt1Type(), "unboxed");
+    }
+
+    LLVMValueRef payload = LLVMBuildAnd(builder, bits, i64_const(TAG_PAYLOAD_MASK), "payload");
+    return LLVMBuildIntToPtr(builder, payload, get_llvm_type(type), "unboxed");
+}
+
+LLVMValueRef build_tag_test(LLVMValueRef boxed, Type* type) {
+    if (type->sub_type) {
+        type = type->sub_type;
+    }
+
+    if (type_equals(type, &TYPE_OBJECT)) {
+        return LLVMConstInt(LLVMInt1Type(), 1, 0);
+    }
+
+    LLVMValueRef tag = LLVMBuildLShr(builder, bits_of(boxed), i64_const(TAG_SHIFT), "tag");
+    if (type_equals(type, &TYPE_NUMBER)) {
+        // todo lo que está por debajo de la primera etiqueta es un Number
+        return LLVMBuildICmp(builder, LLVMIntULT, tag, i64_const(TAG_NULL), "is_number");
+    }
+
+    if (!is_builtin_type(type)) {
+        // Una instancia: el tipo lo dice el id en su vtable
+        LLVMValueRef is_instance = LLVMBuildICmp(builder, LLVMIntEQ, tag, i64_const(TAG_INSTANCE), "is_instance");
+        LLVMValueRef payload = LLVMBuildAnd(builder, bits_of(boxed), i64_const(TAG_PAYLOAD_MASK), "payload");
+        LLVMValueRef address = LLVMBuildSelect(builder, is_instance, payload, i64_const(0), "instance_bits");
+        return build_instance_type_test(LLVMBuildIntToPtr(builder, address, get_llvm_type(type), "instance"), type);
+    }
+
+    unsigned long long expected = TAG_INSTANCE;
+    if (type_equals(type, &TYPE_BOOLEAN)) {
+        expected = TAG_BOOLEAN;
+    } else if (type_equals(type, &TYPE_STRING)) {
+        expected = TAG_STRING;
+    } else if (type_equals(type, &TYPE_NULL)) {
+        expected = TAG_NULL;
+    }
+    return LLVMBuildICmp(builder, LLVMIntEQ, tag, i64_const(expected), "has_tag");
+}
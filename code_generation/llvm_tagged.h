@@ -0,0 +1,32 @@
+#ifndef LLVM_TAGGED_H
+#define LLVM_TAGGED_H
+
+#include <llvm-c/Core.h>
+#include "../type/type.h"
+
+// Los valores de tipo Object son palabras de 64 bits (NaN-boxing) guardadas
+// en un %Object*. Un Number se guarda tal cual; el resto usa los 16 bits
+// altos de un NaN negativo que la aritmética nunca produce como etiqueta y
+// los 48 bajos como contenido (un puntero o el valor del Boolean)
+#define TAG_SHIFT 48
+#define TAG_NULL 0xFFF9ULL
+#define TAG_BOOLEAN 0xFFFAULL
+#define TAG_STRING 0xFFFBULL
+#define TAG_INSTANCE 0xFFFCULL
+#define TAG_PAYLOAD_MASK 0x0000FFFFFFFFFFFFULL
+
+// El Object null
+LLVMValueRef build_tagged_null(void);
+
+// Convierte a Object un Number, Boolean, String o instancia según su tipo
+// en LLVM (un valor que ya es Object se devuelve igual). No reserva memoria
+LLVMValueRef box_value(LLVMValueRef value);
+
+// Extrae de un Object el valor de tipo 'type' (sin comprobar la etiqueta)
+LLVMValueRef unbox_value(LLVMValueRef boxed, Type* type);
+
+// i1 que dice si el Object es de tipo 'type' mirando sus bits (para los
+// tipos definidos por el usuario, además, el id en la vtable de la instancia)
+LLVMValueRef build_tag_test(LLVMValueRef boxed, Type* type);
+
+#endif // LLVM_TAGGED_H
@@ -1,7 +1,13 @@
 #include <stdio.h>
+#include <string.h>
 #include "./ast/ast.h"
 #include "./code_generation/llvm_codegen.h"
+#include "./code_generation/llvm_output.h"
+#include "./code_generation/llvm_gc.h"
+#include "./code_generation/llvm_stack_guard.h"
+#include "./code_generation/llvm_memo.h"
 #include "./semantic_check/semantic.h"
+#include "./optimization/optimization.h"
 
 #define GREEN "\033[32m"
 #define BLUE "\033[34m"
@@ -13,7 +19,26 @@ extern int yyparse(void);
 extern FILE *yyin;
 extern ASTNode* root;
 
-int main() {
+int main(int argc, char** argv) {
+    // compiler flags
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--buffered-output")) {
+            buffered_output = 1;
+        } else if (!strcmp(argv[i], "--gc")) {
+            garbage_collection = 1;
+        } else if (!strcmp(argv[i], "--gc-stats")) {
+            garbage_collection = 1;
+            gc_statistics = 1;
+        } else if (!strcmp(argv[i], "--stack-guard")) {
+            stack_guard = 1;
+        } else if (!strcmp(argv[i], "--memoize")) {
+            memoize = 1;
+        } else {
+            fprintf(stderr, RED "Unknown flag '%s'\n" RESET, argv[i]);
+            return 1;
+        }
+    }
+
     yyin = fopen("script.hulk", "r");
     if (!yyin) {
         perror("Error opening script.hulk");
@@ -22,6 +47,7 @@ int main() {
     
     if (!yyparse() && !analyze_semantics(root)) {
         fclose(yyin);
+        optimize_ast(root);
         
         printf(BLUE "\n🌳 Abstract Syntax Tree:\n" RESET);
         print_ast(root, 0);
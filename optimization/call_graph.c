@@ -0,0 +1,157 @@
+#include "optimization.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Edges only link global functions. A cycle that goes through a method call
+// is still counted at the call site of the method, so it does not make the
+// global functions on it recursive for the stack depth counter. The field
+// initializers of a type run inline wherever 'new' creates it, so their
+// calls belong to the function that contains the 'new'
+
+typedef struct TypeVisit {
+    Type* type;
+    struct TypeVisit* next;
+} TypeVisit;
+
+static TypeVisit* initializing = NULL;
+
+static void collect_calls(ASTNode* node, CallGraph* graph, FunctionInfo* caller);
+
+// method to collect the calls made by the field initializers of a type and
+// of its ancestors
+static void collect_initializer_calls(Type* type, CallGraph* graph, FunctionInfo* caller) {
+    for (TypeVisit* current = initializing; current; current = current->next) {
+        if (current->type == type) {
+            return;
+        }
+    }
+
+    TypeVisit visit = { type, initializing };
+    initializing = &visit;
+
+    for (Type* current = type; current && current->dec && !is_builtin_type(current); current = current->parent) {
+        ASTNode* dec = current->dec;
+        for (int i = 0; i < dec->data.type_node.p_arg_count; i++) {
+            collect_calls(dec->data.type_node.p_args[i], graph, caller);
+        }
+        for (int i = 0; i < dec->data.type_node.def_count; i++) {
+            ASTNode* def = dec->data.type_node.definitions[i];
+            if (def->type == NODE_ASSIGNMENT) {
+                collect_calls(def->data.op_node.right, graph, caller);
+            }
+        }
+    }
+
+    initializing = visit.next;
+}
+
+// method to collect the global function declarations (methods are skipped)
+static void collect_functions(ASTNode* node, CallGraph* graph) {
+    if (!node || node->type == NODE_TYPE_DEC) {
+        return;
+    }
+
+    if (node->type == NODE_FUNC_DEC) {
+        graph->items = realloc(graph->items, sizeof(FunctionInfo) * (graph->count + 1));
+        graph->items[graph->count++] = (FunctionInfo){ node, NULL, 0, 0 };
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        collect_functions(children[i], graph);
+    }
+
+    free(children);
+}
+
+// method to collect the names of the functions called inside a node
+static void collect_calls(ASTNode* node, CallGraph* graph, FunctionInfo* caller) {
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_FUNC_CALL && find_global_function(graph, node->data.func_node.name)) {
+        caller->callees = realloc(caller->callees, sizeof(char*) * (caller->callee_count + 1));
+        caller->callees[caller->callee_count++] = node->data.func_node.name;
+    } else if (node->type == NODE_TYPE_INST) {
+        collect_initializer_calls(node->return_type, graph, caller);
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        collect_calls(children[i], graph, caller);
+    }
+
+    free(children);
+}
+
+static int reaches(CallGraph* graph, FunctionInfo* from, FunctionInfo* target) {
+    if (from->visited) {
+        return 0;
+    }
+    from->visited = 1;
+
+    for (int i = 0; i < from->callee_count; i++) {
+        FunctionInfo* callee = find_global_function(graph, from->callees[i]);
+        if (callee == target || reaches(graph, callee, target)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// method to build the call graph of the global functions of a program
+CallGraph build_call_graph(ASTNode* node) {
+    CallGraph graph = { NULL, 0 };
+    collect_functions(node, &graph);
+
+    for (int i = 0; i < graph.count; i++) {
+        collect_calls(graph.items[i].dec->data.func_node.body, &graph, &graph.items[i]);
+    }
+    return graph;
+}
+
+FunctionInfo* find_global_function(CallGraph* graph, const char* name) {
+    for (int i = 0; i < graph->count; i++) {
+        if (!strcmp(graph->items[i].dec->data.func_node.name, name)) {
+            return &graph->items[i];
+        }
+    }
+    return NULL;
+}
+
+// method to check whether or not 'target' can be called (directly or not)
+// from the body of 'from'
+int calls_back(CallGraph* graph, FunctionInfo* from, FunctionInfo* target) {
+    for (int i = 0; i < graph->count; i++) {
+        graph->items[i].visited = 0;
+    }
+    return reaches(graph, from, target);
+}
+
+void free_call_graph(CallGraph* graph) {
+    for (int i = 0; i < graph->count; i++) {
+        free(graph->items[i].callees);
+    }
+    free(graph->items);
+    graph->items = NULL;
+    graph->count = 0;
+}
+
+// method to flag the global functions that are not part of any cycle of
+// calls. They can skip the stack depth counter
+void mark_non_recursive_functions(ASTNode* node) {
+    CallGraph graph = build_call_graph(node);
+
+    for (int i = 0; i < graph.count; i++) {
+        if (!calls_back(&graph, &graph.items[i], &graph.items[i])) {
+            graph.items[i].dec->flags |= FLAG_NON_RECURSIVE;
+        }
+    }
+
+    free_call_graph(&graph);
+}
@@ -0,0 +1,103 @@
+#include "optimization.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A function declared among the statements of a block is a closure: it may
+// use the variables visible at that point, so the code generator passes it
+// a pointer to an environment with their addresses. Functions are not
+// values in HULK, so a closure never outlives its block and the environment
+// lives in the frame of the function that runs the block.
+//
+// The rest of the phase (and the generated module) identifies functions by
+// name, so a closure whose name is also taken by another function gets a
+// unique one, and the calls that reach it inside its block are renamed
+
+static int renamed = 0;
+
+// method to count the functions declared with a name anywhere
+static int count_declarations(CallGraph* graph, const char* name) {
+    int count = 0;
+    for (int i = 0; i < graph->count; i++) {
+        if (!strcmp(graph->items[i].dec->data.func_node.name, name)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static int declares_function(ASTNode* block, const char* name) {
+    for (int i = 0; i < block->data.program_node.count; i++) {
+        ASTNode* stmt = block->data.program_node.statements[i];
+        if (stmt->type == NODE_FUNC_DEC && !strcmp(stmt->data.func_node.name, name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// method to rename the calls to a closure, except inside the blocks that
+// declare another function with the same name
+static void rename_calls(ASTNode* node, const char* name, char* new_name) {
+    if (!node || (node->type == NODE_BLOCK && declares_function(node, name))) {
+        return;
+    }
+
+    if (node->type == NODE_FUNC_CALL && !strcmp(node->data.func_node.name, name)) {
+        node->data.func_node.name = new_name;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        rename_calls(children[i], name, new_name);
+    }
+
+    free(children);
+}
+
+static void visit(ASTNode* node, CallGraph* graph) {
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_BLOCK) {
+        for (int i = 0; i < node->data.program_node.count; i++) {
+            ASTNode* dec = node->data.program_node.statements[i];
+            if (dec->type != NODE_FUNC_DEC) {
+                continue;
+            }
+
+            dec->flags |= FLAG_CLOSURE;
+            char* name = dec->data.func_node.name;
+            if (count_declarations(graph, name) > 1) {
+                char new_name[256];
+                snprintf(new_name, sizeof(new_name), "%s.%d", name, ++renamed);
+                char* unique = strdup(new_name);
+
+                for (int j = 0; j < node->data.program_node.count; j++) {
+                    rename_calls(node->data.program_node.statements[j], name, unique);
+                }
+                dec->data.func_node.name = unique;
+            }
+        }
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        visit(children[i], graph);
+    }
+
+    free(children);
+}
+
+// method to flag the functions declared inside blocks, so they are compiled
+// with an environment for the variables they capture
+void mark_closures(ASTNode* node) {
+    CallGraph graph = build_call_graph(node);
+    visit(node, &graph);
+    free_call_graph(&graph);
+}
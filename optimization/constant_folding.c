@@ -0,0 +1,433 @@
+#include "optimization.h"
+#include "../code_generation/llvm_string.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Binding between a 'let' variable and the literal it always holds.
+// A NULL value means the name is shadowed by something that is not constant
+typedef struct FoldBinding {
+    char* name;
+    ASTNode* value;
+    struct FoldBinding* next;
+} FoldBinding;
+
+static FoldBinding* bindings = NULL;
+
+static void push_binding(char* name, ASTNode* value) {
+    FoldBinding* binding = (FoldBinding*)malloc(sizeof(FoldBinding));
+    binding->name = name;
+    binding->value = value;
+    binding->next = bindings;
+    bindings = binding;
+}
+
+// method to remove every binding pushed after 'mark'
+static void pop_bindings(FoldBinding* mark) {
+    while (bindings && bindings != mark) {
+        FoldBinding* next = bindings->next;
+        free(bindings);
+        bindings = next;
+    }
+}
+
+static ASTNode* find_binding(const char* name) {
+    for (FoldBinding* current = bindings; current; current = current->next) {
+        if (!strcmp(current->name, name)) {
+            return current->value;
+        }
+    }
+
+    return NULL;
+}
+
+// method to check whether or not a node is a number, string or boolean literal
+int is_literal_node(ASTNode* node) {
+    return node && (
+        node->type == NODE_NUMBER ||
+        node->type == NODE_STRING ||
+        node->type == NODE_BOOLEAN
+    );
+}
+
+// method to check whether or not a variable is target of a destructive
+// assignment (':=' or compound operators) somewhere inside the given node
+int is_reassigned(ASTNode* node, const char* name) {
+    if (!node) {
+        return 0;
+    }
+
+    switch (node->type) {
+        case NODE_D_ASSIGNMENT:
+            if (!strcmp(node->data.op_node.left->data.variable_name, name)) {
+                return 1;
+            }
+            return is_reassigned(node->data.op_node.right, name);
+        case NODE_ASSIGNMENT:
+            return is_reassigned(node->data.op_node.right, name);
+        case NODE_BINARY_OP:
+        case NODE_UNARY_OP:
+        case NODE_LOOP:
+        case NODE_TYPE_GET_ATTR:
+            return is_reassigned(node->data.op_node.left, name) ||
+                is_reassigned(node->data.op_node.right, name);
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+            for (int i = 0; i < node->data.program_node.count; i++) {
+                if (is_reassigned(node->data.program_node.statements[i], name))
+                    return 1;
+            }
+            return 0;
+        case NODE_FUNC_CALL:
+        case NODE_BASE_FUNC:
+        case NODE_FUNC_DEC:
+        case NODE_LET_IN:
+        case NODE_FOR_LOOP:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                if (is_reassigned(node->data.func_node.args[i], name))
+                    return 1;
+            }
+            return node->type != NODE_FUNC_CALL && node->type != NODE_BASE_FUNC &&
+                is_reassigned(node->data.func_node.body, name);
+        case NODE_CONDITIONAL:
+        case NODE_Q_CONDITIONAL:
+        case NODE_TYPE_SET_ATTR:
+            return is_reassigned(node->data.cond_node.cond, name) ||
+                is_reassigned(node->data.cond_node.body_true, name) ||
+                is_reassigned(node->data.cond_node.body_false, name);
+        case NODE_TEST_TYPE:
+        case NODE_CAST_TYPE:
+            return is_reassigned(node->data.cast_test.exp, name);
+        case NODE_TYPE_INST:
+            for (int i = 0; i < node->data.type_node.arg_count; i++) {
+                if (is_reassigned(node->data.type_node.args[i], name))
+                    return 1;
+            }
+            return 0;
+        case NODE_TYPE_DEC:
+            for (int i = 0; i < node->data.type_node.def_count; i++) {
+                if (is_reassigned(node->data.type_node.definitions[i], name))
+                    return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// <----------REWRITES---------->
+
+// The AST is shared in some places (while conditions, compound operators),
+// so folded nodes are rewritten in place instead of being replaced
+
+static void make_number(ASTNode* node, double value) {
+    node->type = NODE_NUMBER;
+    node->return_type = &TYPE_NUMBER;
+    node->data.number_value = value;
+}
+
+// method to fold a computed Number. A NaN is left to the runtime: its sign
+// bit depends on the operation that produced it, and the host may not
+// produce the same one as the generated code, so print would differ
+static void fold_number(ASTNode* node, double value) {
+    if (!isnan(value)) {
+        make_number(node, value);
+    }
+}
+
+static void make_boolean(ASTNode* node, int value) {
+    node->type = NODE_BOOLEAN;
+    node->return_type = &TYPE_BOOLEAN;
+    node->data.string_value = value ? "true" : "false";
+}
+
+static void make_string(ASTNode* node, char* value) {
+    node->type = NODE_STRING;
+    node->return_type = &TYPE_STRING;
+    node->data.string_value = value;
+}
+
+static void copy_literal(ASTNode* node, ASTNode* literal) {
+    if (literal->type == NODE_NUMBER) {
+        make_number(node, literal->data.number_value);
+    } else if (literal->type == NODE_STRING) {
+        make_string(node, literal->data.string_value);
+    } else {
+        make_boolean(node, !strcmp(literal->data.string_value, "true"));
+    }
+}
+
+static int boolean_value(ASTNode* node) {
+    return !strcmp(node->data.string_value, "true");
+}
+
+// method to get the text of a literal as it is used by '@' and '@@'
+// (numbers follow the same '%g' format used at runtime)
+static char* literal_to_str(ASTNode* node) {
+    if (node->type == NODE_NUMBER) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%g", node->data.number_value);
+        return strdup(buffer);
+    }
+
+    return strdup(node->data.string_value);
+}
+
+static void fold_binary_op(ASTNode* node) {
+    ASTNode* left = node->data.op_node.left;
+    ASTNode* right = node->data.op_node.right;
+    Operator op = node->data.op_node.op;
+
+    if (!is_literal_node(left) || !is_literal_node(right)) {
+        return;
+    }
+
+    if (op == OP_CONCAT || op == OP_DCONCAT) {
+        if (left->type == NODE_BOOLEAN || right->type == NODE_BOOLEAN) {
+            return;
+        }
+
+        // escape sequences are kept raw, they are processed when emitting the string
+        char* l = literal_to_str(left);
+        char* r = literal_to_str(right);
+        int n = strlen(l) + strlen(r) + 2;
+        char* result = (char*)malloc(n);
+        snprintf(result, n, op == OP_DCONCAT ? "%s %s" : "%s%s", l, r);
+        free(l);
+        free(r);
+        make_string(node, result);
+        return;
+    }
+
+    if (left->type != right->type) {
+        return;
+    }
+
+    if (left->type == NODE_NUMBER) {
+        double a = left->data.number_value;
+        double b = right->data.number_value;
+        // comparisons are ordered, as the 'fcmp' emitted in code generation
+        int ordered = !isnan(a) && !isnan(b);
+
+        switch (op) {
+            case OP_ADD: fold_number(node, a + b); break;
+            case OP_SUB: fold_number(node, a - b); break;
+            case OP_MUL: fold_number(node, a * b); break;
+            case OP_DIV: fold_number(node, a / b); break;
+            case OP_MOD: fold_number(node, fmod(a, b)); break;
+            case OP_POW: fold_number(node, pow(a, b)); break;
+            case OP_EQ: make_boolean(node, ordered && a == b); break;
+            case OP_NEQ: make_boolean(node, ordered && a != b); break;
+            case OP_GR: make_boolean(node, ordered && a > b); break;
+            case OP_GRE: make_boolean(node, ordered && a >= b); break;
+            case OP_LS: make_boolean(node, ordered && a < b); break;
+            case OP_LSE: make_boolean(node, ordered && a <= b); break;
+            default: break;
+        }
+    } else if (left->type == NODE_BOOLEAN) {
+        int a = boolean_value(left);
+        int b = boolean_value(right);
+
+        switch (op) {
+            case OP_AND: make_boolean(node, a && b); break;
+            case OP_OR: make_boolean(node, a || b); break;
+            case OP_EQ: make_boolean(node, a == b); break;
+            case OP_NEQ: make_boolean(node, a != b); break;
+            default: break;
+        }
+    } else {
+        // strings are compared by their final value, not by the source text
+        char* l = process_string_escapes(left->data.string_value);
+        char* r = process_string_escapes(right->data.string_value);
+        int cmp = strcmp(l, r);
+        free(l);
+        free(r);
+
+        switch (op) {
+            case OP_EQ: make_boolean(node, cmp == 0); break;
+            case OP_NEQ: make_boolean(node, cmp != 0); break;
+            case OP_GR: make_boolean(node, cmp > 0); break;
+            case OP_GRE: make_boolean(node, cmp >= 0); break;
+            case OP_LS: make_boolean(node, cmp < 0); break;
+            case OP_LSE: make_boolean(node, cmp <= 0); break;
+            default: break;
+        }
+    }
+}
+
+static void fold_unary_op(ASTNode* node) {
+    ASTNode* operand = node->data.op_node.left;
+
+    if (node->data.op_node.op == OP_NEGATE && operand->type == NODE_NUMBER) {
+        make_number(node, -operand->data.number_value);
+    } else if (node->data.op_node.op == OP_NOT && operand->type == NODE_BOOLEAN) {
+        make_boolean(node, !boolean_value(operand));
+    }
+}
+
+// method to fold calls to builtin math functions whose arguments are constant
+static void fold_builtin_call(ASTNode* node) {
+    char* name = node->data.func_node.name;
+    ASTNode** args = node->data.func_node.args;
+    int arg_count = node->data.func_node.arg_count;
+
+    // user functions can not be named as builtins, so the name is enough
+    for (int i = 0; i < arg_count; i++) {
+        if (args[i]->type != NODE_NUMBER)
+            return;
+    }
+
+    if (arg_count == 1) {
+        double x = args[0]->data.number_value;
+
+        if (!strcmp(name, "sqrt")) fold_number(node, sqrt(x));
+        else if (!strcmp(name, "sin")) fold_number(node, sin(x));
+        else if (!strcmp(name, "cos")) fold_number(node, cos(x));
+        else if (!strcmp(name, "exp")) fold_number(node, exp(x));
+        else if (!strcmp(name, "log")) fold_number(node, log(x));
+    } else if (arg_count == 2 && !strcmp(name, "log")) {
+        double base = args[0]->data.number_value;
+        double x = args[1]->data.number_value;
+        fold_number(node, log(x) / log(base));
+    }
+}
+
+// <----------TRAVERSAL---------->
+
+static void fold_let_in(ASTNode* node) {
+    FoldBinding* mark = bindings;
+    ASTNode** declarations = node->data.func_node.args;
+    int dec_count = node->data.func_node.arg_count;
+
+    for (int i = 0; i < dec_count; i++) {
+        ASTNode* var = declarations[i]->data.op_node.left;
+        ASTNode* value = declarations[i]->data.op_node.right;
+        fold_constants(value);
+
+        int constant = is_literal_node(value) &&
+            type_equals(var->return_type, value->return_type) &&
+            !is_reassigned(node->data.func_node.body, var->data.variable_name);
+
+        for (int j = i + 1; constant && j < dec_count; j++) {
+            constant = !is_reassigned(declarations[j], var->data.variable_name);
+        }
+
+        push_binding(var->data.variable_name, constant ? value : NULL);
+    }
+
+    fold_constants(node->data.func_node.body);
+    pop_bindings(mark);
+}
+
+// method to shadow parameters (and 'self') while visiting a declaration body
+static void shadow_params(ASTNode** params, int count) {
+    for (int i = 0; i < count; i++) {
+        push_binding(params[i]->data.variable_name, NULL);
+    }
+}
+
+// method to fold constant expressions and to propagate immutable 'let' bindings
+void fold_constants(ASTNode* node) {
+    if (!node) {
+        return;
+    }
+
+    FoldBinding* mark = bindings;
+
+    switch (node->type) {
+        case NODE_VARIABLE: {
+            ASTNode* literal = find_binding(node->data.variable_name);
+            if (literal) {
+                copy_literal(node, literal);
+            }
+            break;
+        }
+        case NODE_BINARY_OP:
+            fold_constants(node->data.op_node.left);
+            fold_constants(node->data.op_node.right);
+            fold_binary_op(node);
+            break;
+        case NODE_UNARY_OP:
+            fold_constants(node->data.op_node.left);
+            fold_unary_op(node);
+            break;
+        case NODE_ASSIGNMENT:
+        case NODE_D_ASSIGNMENT:
+            fold_constants(node->data.op_node.right);
+            break;
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+            for (int i = 0; i < node->data.program_node.count; i++) {
+                fold_constants(node->data.program_node.statements[i]);
+            }
+            break;
+        case NODE_FUNC_CALL:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                fold_constants(node->data.func_node.args[i]);
+            }
+            fold_builtin_call(node);
+            break;
+        case NODE_BASE_FUNC:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                fold_constants(node->data.func_node.args[i]);
+            }
+            break;
+        case NODE_FUNC_DEC:
+            shadow_params(node->data.func_node.args, node->data.func_node.arg_count);
+            fold_constants(node->data.func_node.body);
+            break;
+        case NODE_LET_IN:
+            fold_let_in(node);
+            break;
+        case NODE_CONDITIONAL:
+            fold_constants(node->data.cond_node.cond);
+            fold_constants(node->data.cond_node.body_true);
+            fold_constants(node->data.cond_node.body_false);
+            break;
+        case NODE_Q_CONDITIONAL:
+            // the condition must stay a variable to be tested against null
+            fold_constants(node->data.cond_node.body_true);
+            fold_constants(node->data.cond_node.body_false);
+            break;
+        case NODE_LOOP:
+            fold_constants(node->data.op_node.left);
+            fold_constants(node->data.op_node.right);
+            break;
+        case NODE_TEST_TYPE:
+        case NODE_CAST_TYPE:
+            fold_constants(node->data.cast_test.exp);
+            break;
+        case NODE_TYPE_DEC:
+            shadow_params(node->data.type_node.args, node->data.type_node.arg_count);
+            push_binding("self", NULL);
+            for (int i = 0; i < node->data.type_node.p_arg_count; i++) {
+                fold_constants(node->data.type_node.p_args[i]);
+            }
+            for (int i = 0; i < node->data.type_node.def_count; i++) {
+                fold_constants(node->data.type_node.definitions[i]);
+            }
+            break;
+        case NODE_TYPE_INST:
+            for (int i = 0; i < node->data.type_node.arg_count; i++) {
+                fold_constants(node->data.type_node.args[i]);
+            }
+            break;
+        case NODE_TYPE_GET_ATTR:
+            fold_constants(node->data.op_node.left);
+            if (node->data.op_node.right->type == NODE_FUNC_CALL) {
+                ASTNode* call = node->data.op_node.right;
+                for (int i = 0; i < call->data.func_node.arg_count; i++) {
+                    fold_constants(call->data.func_node.args[i]);
+                }
+            }
+            break;
+        case NODE_TYPE_SET_ATTR:
+            fold_constants(node->data.cond_node.cond);
+            fold_constants(node->data.cond_node.body_false);
+            break;
+        default:
+            break;
+    }
+
+    pop_bindings(mark);
+}
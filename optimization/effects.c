@@ -0,0 +1,325 @@
+#include "optimization.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Every function and method body is classified by the strongest effect it
+// may have: none (the result only depends on the arguments), reading memory
+// (fields, strings, type tests) or writing it (printing, allocating,
+// assigning attributes, calling methods through the vtable). Writes to the
+// local variables of the body stay in its frame, so they are not effects,
+// but a closure reads and writes the variables it captures through its
+// environment, which points into the frame of another function.
+// A function may also never return when it runs a loop or reaches a cycle
+// of calls. The functions on such a cycle also update the stack depth
+// counter, which is a write of its own
+
+typedef enum {
+    EFFECT_NONE,
+    EFFECT_READ,
+    EFFECT_WRITE
+} Effect;
+
+typedef struct {
+    Effect effect;
+    int loops;      // runs a loop or calls a function that does
+    int counted;    // reaches a function that keeps the stack depth counter
+} Summary;
+
+// names declared inside a closure around the node being visited: its
+// parameters and the 'let' and 'for' variables
+typedef struct Bound {
+    const char* name;
+    struct Bound* next;
+} Bound;
+
+static const char* pure_builtins[] = { "sqrt", "sin", "cos", "exp", "log" };
+
+static int is_string(ASTNode* node) {
+    return node && node->return_type && type_equals(node->return_type, &TYPE_STRING);
+}
+
+static void join(Summary* summary, Summary other) {
+    if (other.effect > summary->effect) {
+        summary->effect = other.effect;
+    }
+    summary->loops |= other.loops;
+    summary->counted |= other.counted;
+}
+
+static void raise_effect(Summary* summary, Effect effect) {
+    if (effect > summary->effect) {
+        summary->effect = effect;
+    }
+}
+
+// method to read the summary already inferred for a global function
+static Summary function_summary(ASTNode* dec) {
+    Summary summary = { EFFECT_NONE, 0, 0 };
+
+    if (dec->flags & FLAG_READ_ONLY) {
+        summary.effect = EFFECT_READ;
+    } else if (!(dec->flags & FLAG_PURE)) {
+        summary.effect = EFFECT_WRITE;
+    }
+    summary.loops = !(dec->flags & FLAG_WILL_RETURN);
+    summary.counted = (dec->flags & FLAG_DEPTH_COUNTED) != 0;
+    return summary;
+}
+
+static void store_summary(ASTNode* dec, Summary summary) {
+    dec->flags &= ~(FLAG_PURE | FLAG_READ_ONLY | FLAG_WILL_RETURN | FLAG_DEPTH_COUNTED);
+
+    if (summary.effect == EFFECT_NONE) {
+        dec->flags |= FLAG_PURE;
+    } else if (summary.effect == EFFECT_READ) {
+        dec->flags |= FLAG_READ_ONLY;
+    }
+    if (!summary.loops && !summary.counted) {
+        dec->flags |= FLAG_WILL_RETURN;
+    }
+    if (summary.counted) {
+        dec->flags |= FLAG_DEPTH_COUNTED;
+    }
+}
+
+// method to classify the effects of a call to a builtin or global function
+static Summary call_summary(ASTNode* node, CallGraph* graph) {
+    Summary summary = { EFFECT_NONE, 0, 0 };
+    const char* name = node->data.func_node.name;
+
+    for (size_t i = 0; i < sizeof(pure_builtins) / sizeof(pure_builtins[0]); i++) {
+        if (!strcmp(name, pure_builtins[i])) {
+            return summary;
+        }
+    }
+
+    FunctionInfo* callee = find_global_function(graph, name);
+    if (!callee) {
+        // print, rand, flush
+        summary.effect = EFFECT_WRITE;
+        return summary;
+    }
+    return function_summary(callee->dec);
+}
+
+// method to infer the effects of evaluating a node
+static Summary node_summary(ASTNode* node, CallGraph* graph) {
+    Summary summary = { EFFECT_NONE, 0, 0 };
+
+    if (!node) {
+        return summary;
+    }
+
+    switch (node->type) {
+        case NODE_FUNC_DEC:
+            // a nested declaration runs only when it is called
+            return summary;
+        case NODE_FUNC_CALL:
+            join(&summary, call_summary(node, graph));
+            break;
+        case NODE_BINARY_OP:
+            if (is_string(node)) {
+                // concatenations allocate the new string
+                raise_effect(&summary, EFFECT_WRITE);
+            } else if (is_string(node->data.op_node.left) || is_string(node->data.op_node.right)) {
+                raise_effect(&summary, EFFECT_READ);
+            }
+            break;
+        case NODE_LOOP:
+        case NODE_FOR_LOOP:
+            summary.loops = 1;
+            break;
+        case NODE_TYPE_GET_ATTR:
+            raise_effect(&summary, node->data.op_node.right->type == NODE_FUNC_CALL ? EFFECT_WRITE : EFFECT_READ);
+            break;
+        case NODE_TEST_TYPE:
+            raise_effect(&summary, EFFECT_READ);
+            break;
+        case NODE_TYPE_INST:
+        case NODE_TYPE_SET_ATTR:
+        case NODE_BASE_FUNC:
+        case NODE_CAST_TYPE:
+            // failed casts print an error and stop the program
+            raise_effect(&summary, EFFECT_WRITE);
+            break;
+        default:
+            break;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        join(&summary, node_summary(children[i], graph));
+    }
+
+    free(children);
+    return summary;
+}
+
+static int is_bound(Bound* bound, const char* name) {
+    for (; bound; bound = bound->next) {
+        if (!strcmp(bound->name, name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// method to infer the effects of a closure over the variables it captures.
+// The closures declared inside it are reached through their calls
+static Summary capture_summary(ASTNode* node, Bound* bound) {
+    Summary summary = { EFFECT_NONE, 0, 0 };
+
+    if (!node || node->type == NODE_FUNC_DEC) {
+        return summary;
+    }
+
+    switch (node->type) {
+        case NODE_VARIABLE:
+            if (!is_bound(bound, node->data.variable_name)) {
+                raise_effect(&summary, EFFECT_READ);
+            }
+            return summary;
+        case NODE_D_ASSIGNMENT:
+            if (!is_bound(bound, node->data.op_node.left->data.variable_name)) {
+                raise_effect(&summary, EFFECT_WRITE);
+            }
+            break;
+        case NODE_LET_IN: {
+            int count = node->data.func_node.arg_count;
+            Bound* declared = malloc(sizeof(Bound) * (count > 0 ? count : 1));
+            for (int i = 0; i < count; i++) {
+                ASTNode* declaration = node->data.func_node.args[i];
+                join(&summary, capture_summary(declaration->data.op_node.right, bound));
+                declared[i] = (Bound){ declaration->data.op_node.left->data.variable_name, bound };
+                bound = &declared[i];
+            }
+            join(&summary, capture_summary(node->data.func_node.body, bound));
+            free(declared);
+            return summary;
+        }
+        case NODE_FOR_LOOP: {
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                join(&summary, capture_summary(node->data.func_node.args[i], bound));
+            }
+            Bound variable = { node->data.func_node.name, bound };
+            join(&summary, capture_summary(node->data.func_node.body, &variable));
+            return summary;
+        }
+        default:
+            break;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        join(&summary, capture_summary(children[i], bound));
+    }
+
+    free(children);
+    return summary;
+}
+
+static Summary closure_summary(ASTNode* dec) {
+    int count = dec->data.func_node.arg_count;
+    Bound* params = malloc(sizeof(Bound) * (count > 0 ? count : 1));
+    Bound* bound = NULL;
+
+    for (int i = 0; i < count; i++) {
+        params[i] = (Bound){ dec->data.func_node.args[i]->data.variable_name, bound };
+        bound = &params[i];
+    }
+
+    Summary summary = capture_summary(dec->data.func_node.body, bound);
+    free(params);
+    return summary;
+}
+
+// method to check whether or not the results of a function can be cached
+// by the values of its arguments: it must be recursive (the calls to the
+// rest are cheap), take and return plain values and write nothing. With
+// only Number and String values at hand, all it can read are strings,
+// which never change. A closure also depends on the variables it captures
+static int is_memoizable(ASTNode* dec) {
+    Type* return_type = dec->data.func_node.body->return_type;
+    if (!(dec->flags & (FLAG_PURE | FLAG_READ_ONLY)) || (dec->flags & (FLAG_NON_RECURSIVE | FLAG_CLOSURE)) || !return_type ||
+        !(type_equals(return_type, &TYPE_NUMBER) || type_equals(return_type, &TYPE_BOOLEAN))) {
+        return 0;
+    }
+
+    for (int i = 0; i < dec->data.func_node.arg_count; i++) {
+        Type* param_type = dec->data.func_node.args[i]->return_type;
+        if (!type_equals(param_type, &TYPE_NUMBER) && !type_equals(param_type, &TYPE_STRING)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// method to infer the effects of every method from the summaries of the
+// global functions
+static void mark_method_effects(ASTNode* node, CallGraph* graph) {
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_TYPE_DEC) {
+        for (int i = 0; i < node->data.type_node.def_count; i++) {
+            ASTNode* def = node->data.type_node.definitions[i];
+            if (def->type == NODE_FUNC_DEC) {
+                store_summary(def, node_summary(def->data.func_node.body, graph));
+            }
+        }
+        return;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        mark_method_effects(children[i], graph);
+    }
+
+    free(children);
+}
+
+// method to classify the functions and methods as pure, read only or
+// effectful, so the generated code can tell LLVM which calls it may remove
+// or reuse
+void mark_function_effects(ASTNode* node) {
+    CallGraph graph = build_call_graph(node);
+
+    // every function starts as pure and is weakened until nothing changes
+    for (int i = 0; i < graph.count; i++) {
+        Summary initial = { EFFECT_NONE, 0, !(graph.items[i].dec->flags & FLAG_NON_RECURSIVE) };
+        store_summary(graph.items[i].dec, initial);
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < graph.count; i++) {
+            ASTNode* dec = graph.items[i].dec;
+            Summary summary = function_summary(dec);
+            join(&summary, node_summary(dec->data.func_node.body, &graph));
+            if (dec->flags & FLAG_CLOSURE) {
+                join(&summary, closure_summary(dec));
+            }
+
+            int old_flags = dec->flags;
+            store_summary(dec, summary);
+            changed |= dec->flags != old_flags;
+        }
+    }
+
+    for (int i = 0; i < graph.count; i++) {
+        if (is_memoizable(graph.items[i].dec)) {
+            graph.items[i].dec->flags |= FLAG_MEMOIZABLE;
+        }
+    }
+
+    mark_method_effects(node, &graph);
+    free_call_graph(&graph);
+}
@@ -0,0 +1,195 @@
+#include "optimization.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// An instance created by 'new' can live in the frame of the function that
+// creates it when no pointer to it outlives the expression that holds it:
+// the instance is only used as the receiver of attribute accesses and method
+// calls, and none of the methods it may reach lets 'self' escape either
+
+typedef struct MethodVisit {
+    ASTNode* method;
+    struct MethodVisit* next;
+} MethodVisit;
+
+// methods under analysis. A recursive call to one of them is assumed to keep
+// its receiver, the answer for the outer call covers it
+static MethodVisit* visiting = NULL;
+
+static int is_variable(ASTNode* node, const char* name) {
+    return node->type == NODE_VARIABLE && !strcmp(node->data.variable_name, name);
+}
+
+static int is_custom_type(Type* type) {
+    return type && type->dec && !is_builtin_type(type);
+}
+
+static int keeps_receiver(ASTNode* node, const char* name, Type* type);
+
+// method to check whether or not a method keeps 'self' inside its frame when
+// it is called on an instance of 'type'
+static int method_keeps_self(ASTNode* method, Type* type) {
+    for (MethodVisit* current = visiting; current; current = current->next) {
+        if (current->method == method) {
+            return 1;
+        }
+    }
+
+    MethodVisit visit = { method, visiting };
+    visiting = &visit;
+    int safe = keeps_receiver(method->data.func_node.body, "self", type);
+    visiting = visit.next;
+    return safe;
+}
+
+// method to check every implementation that a method call over an instance
+// of 'type' may reach through the vtable
+static int call_keeps_receiver(ASTNode* attr, Type* type) {
+    ASTNode* call = attr->data.op_node.right;
+    Type* static_type = attr->data.op_node.left->return_type;
+
+    if (!is_custom_type(static_type)) {
+        return 0;
+    }
+
+    char* method_name = delete_underscore_from_str(call->data.func_node.name, static_type->name);
+    int safe = 1;
+
+    for (Type* current = type; safe && is_custom_type(current); current = current->parent) {
+        char name[256];
+        snprintf(name, sizeof(name), "_%s_%s", current->name, method_name);
+        ASTNode* dec = current->dec;
+
+        for (int i = 0; i < dec->data.type_node.def_count && safe; i++) {
+            ASTNode* def = dec->data.type_node.definitions[i];
+            if (def->type == NODE_FUNC_DEC && !strcmp(def->data.func_node.name, name)) {
+                safe = method_keeps_self(def, type);
+            }
+        }
+    }
+
+    free(method_name);
+    return safe;
+}
+
+// method to check that the variable 'name', holding an instance of 'type',
+// is only used as a receiver inside a node
+static int keeps_receiver(ASTNode* node, const char* name, Type* type) {
+    if (!node) {
+        return 1;
+    }
+
+    switch (node->type) {
+        case NODE_VARIABLE:
+            return !is_variable(node, name);
+        case NODE_BASE_FUNC:
+            // the ancestor implementation receives 'self' as well
+            return 0;
+        case NODE_TYPE_GET_ATTR: {
+            ASTNode* instance = node->data.op_node.left;
+            ASTNode* member = node->data.op_node.right;
+
+            if (!is_variable(instance, name)) {
+                break;
+            }
+            if (member->type != NODE_FUNC_CALL) {
+                return 1;
+            }
+            for (int i = 0; i < member->data.func_node.arg_count; i++) {
+                if (!keeps_receiver(member->data.func_node.args[i], name, type))
+                    return 0;
+            }
+            return call_keeps_receiver(node, type);
+        }
+        case NODE_TYPE_SET_ATTR:
+            if (is_variable(node->data.cond_node.cond, name)) {
+                return keeps_receiver(node->data.cond_node.body_false, name, type);
+            }
+            break;
+        case NODE_LET_IN:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                ASTNode* declaration = node->data.func_node.args[i];
+                if (!keeps_receiver(declaration->data.op_node.right, name, type))
+                    return 0;
+                // from here on the name belongs to the inner variable
+                if (is_variable(declaration->data.op_node.left, name))
+                    return 1;
+            }
+            return keeps_receiver(node->data.func_node.body, name, type);
+        default:
+            break;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int safe = 1;
+
+    for (int i = 0; i < count && safe; i++) {
+        safe = keeps_receiver(children[i], name, type);
+    }
+
+    free(children);
+    return safe;
+}
+
+// method to analyze the i-th declaration of a 'let'
+static void analyze_let_variable(ASTNode* let_node, int index) {
+    ASTNode* declaration = let_node->data.func_node.args[index];
+    ASTNode* var = declaration->data.op_node.left;
+    ASTNode* value = declaration->data.op_node.right;
+
+    if (value->type != NODE_TYPE_INST || !is_custom_type(value->return_type)) {
+        return;
+    }
+
+    const char* name = var->data.variable_name;
+    Type* type = value->return_type;
+    int safe = 1;
+    int shadowed = 0;
+
+    for (int i = index + 1; i < let_node->data.func_node.arg_count && safe && !shadowed; i++) {
+        ASTNode* next = let_node->data.func_node.args[i];
+        safe = keeps_receiver(next->data.op_node.right, name, type);
+        shadowed = is_variable(next->data.op_node.left, name);
+    }
+
+    if (safe && !shadowed) {
+        safe = keeps_receiver(let_node->data.func_node.body, name, type);
+    }
+
+    if (safe) {
+        value->flags |= FLAG_STACK_INSTANCE;
+    }
+}
+
+// method to find the instances created by 'new' that never escape the frame
+// of the function that creates them, so they can be allocated in its stack
+void mark_stack_instances(ASTNode* node) {
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_LET_IN) {
+        for (int i = 0; i < node->data.func_node.arg_count; i++) {
+            analyze_let_variable(node, i);
+        }
+    } else if (node->type == NODE_TYPE_GET_ATTR) {
+        // 'new T(...).m(...)': the instance dies with the call
+        ASTNode* instance = node->data.op_node.left;
+        ASTNode* member = node->data.op_node.right;
+        if (instance->type == NODE_TYPE_INST && is_custom_type(instance->return_type) &&
+            member->type == NODE_FUNC_CALL && call_keeps_receiver(node, instance->return_type)) {
+            instance->flags |= FLAG_STACK_INSTANCE;
+        }
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        mark_stack_instances(children[i]);
+    }
+
+    free(children);
+}
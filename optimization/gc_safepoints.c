@@ -0,0 +1,73 @@
+#include "optimization.h"
+#include <stdlib.h>
+
+// A node is at statement level when nothing computed before it in the same
+// function is still waiting to be used: every value produced earlier was
+// either discarded or stored in a variable. At the end of an iteration of a
+// loop in that position the temporaries of the frame are garbage
+
+static void visit(ASTNode* node, int statement);
+
+static void visit_children(ASTNode* node, int statement) {
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        visit(children[i], statement);
+    }
+
+    free(children);
+}
+
+static void visit(ASTNode* node, int statement) {
+    if (!node) {
+        return;
+    }
+
+    switch (node->type) {
+        case NODE_LOOP:
+            if (statement) {
+                node->flags |= FLAG_GC_SAFEPOINT;
+            }
+            visit_children(node, statement);
+            break;
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+        case NODE_LET_IN:
+        case NODE_CONDITIONAL:
+        case NODE_Q_CONDITIONAL:
+        case NODE_ASSIGNMENT:
+        case NODE_D_ASSIGNMENT:
+        case NODE_UNARY_OP:
+            // let values are stored before the next one is evaluated
+            visit_children(node, statement);
+            break;
+        case NODE_BINARY_OP:
+            // the left operand is evaluated first
+            visit(node->data.op_node.left, statement);
+            visit(node->data.op_node.right, 0);
+            break;
+        case NODE_FUNC_CALL:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                visit(node->data.func_node.args[i], statement && i == 0);
+            }
+            break;
+        case NODE_FUNC_DEC:
+            visit(node->data.func_node.body, 1);
+            break;
+        case NODE_TYPE_DEC:
+            // field initializers run inside 'new', next to the instance.
+            // Methods start their own frame
+            visit_children(node, 0);
+            break;
+        default:
+            visit_children(node, 0);
+            break;
+    }
+}
+
+// method to flag the loops placed at statement level of a function or of
+// the program
+void mark_gc_safepoints(ASTNode* node) {
+    visit(node, 1);
+}
@@ -0,0 +1,145 @@
+#include "optimization.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A 'let' variable or a parameter that is never the target of ':=' always
+// holds the value it was bound to, so the code generator uses that value
+// directly instead of storing it in a slot and loading it at every use.
+// Only Number, String and Boolean values are bound this way: instances and
+// Object values go through their slots in the rest of the generator. A
+// closure reads the variables it captures through their addresses, and a
+// tail call stores the new arguments in the slots of the parameters before
+// jumping back to the start of the function, so those keep their slots
+
+static int is_scalar(Type* type) {
+    return type && (type_equals(type, &TYPE_NUMBER) || type_equals(type, &TYPE_STRING) ||
+        type_equals(type, &TYPE_BOOLEAN));
+}
+
+// method to check whether or not a variable with the given name is read
+// inside the body of a function declared in the node
+static int mentions(ASTNode* node, const char* name, int in_function) {
+    if (!node) {
+        return 0;
+    }
+    if (in_function && node->type == NODE_VARIABLE && !strcmp(node->data.variable_name, name)) {
+        return 1;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int found = 0;
+
+    for (int i = 0; i < count && !found; i++) {
+        found = mentions(children[i], name, in_function || node->type == NODE_FUNC_DEC);
+    }
+
+    free(children);
+    return found;
+}
+
+static int is_captured(ASTNode* node, const char* name) {
+    return mentions(node, name, 0);
+}
+
+static int has_tail_call(ASTNode* node) {
+    if (!node) {
+        return 0;
+    }
+    if (node->flags & FLAG_TAIL_CALL) {
+        return 1;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int found = 0;
+
+    for (int i = 0; i < count && !found; i++) {
+        found = has_tail_call(children[i]);
+    }
+
+    free(children);
+    return found;
+}
+
+static void mark_let_in(ASTNode* node) {
+    ASTNode** declarations = node->data.func_node.args;
+    int dec_count = node->data.func_node.arg_count;
+    ASTNode* body = node->data.func_node.body;
+
+    for (int i = 0; i < dec_count; i++) {
+        ASTNode* var = declarations[i]->data.op_node.left;
+        const char* name = var->data.variable_name;
+
+        int immutable = is_scalar(var->return_type) &&
+            is_scalar(declarations[i]->data.op_node.right->return_type) &&
+            !(var->static_type && !strcmp(var->static_type, "Object")) &&
+            !is_reassigned(body, name) && !is_captured(body, name);
+
+        for (int j = i + 1; immutable && j < dec_count; j++) {
+            immutable = !is_reassigned(declarations[j], name) && !is_captured(declarations[j], name);
+        }
+
+        if (immutable) {
+            declarations[i]->flags |= FLAG_IMMUTABLE;
+        }
+    }
+}
+
+// method to flag the parameters of a function or a type that keep their
+// values in the nodes that can see them
+static void mark_params(ASTNode** params, int count, ASTNode* scope) {
+    for (int i = 0; i < count; i++) {
+        const char* name = params[i]->data.variable_name;
+        if (is_scalar(params[i]->return_type) && !is_reassigned(scope, name) && !is_captured(scope, name)) {
+            params[i]->flags |= FLAG_IMMUTABLE;
+        }
+    }
+}
+
+static void visit(ASTNode* node) {
+    if (!node) {
+        return;
+    }
+
+    switch (node->type) {
+        case NODE_LET_IN:
+            mark_let_in(node);
+            break;
+        case NODE_FUNC_DEC:
+            if (!has_tail_call(node->data.func_node.body)) {
+                mark_params(node->data.func_node.args, node->data.func_node.arg_count,
+                    node->data.func_node.body);
+            }
+            break;
+        case NODE_TYPE_DEC:
+            mark_params(node->data.type_node.args, node->data.type_node.arg_count, node);
+            // the arguments for the parent are evaluated with the same params
+            for (int i = 0; i < node->data.type_node.arg_count; i++) {
+                ASTNode* param = node->data.type_node.args[i];
+                for (int j = 0; j < node->data.type_node.p_arg_count; j++) {
+                    if (is_reassigned(node->data.type_node.p_args[j], param->data.variable_name)) {
+                        param->flags &= ~FLAG_IMMUTABLE;
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        visit(children[i]);
+    }
+
+    free(children);
+}
+
+// method to flag the 'let' variables and parameters that can be bound to
+// their values without a slot
+void mark_immutable_bindings(ASTNode* node) {
+    visit(node);
+}
@@ -0,0 +1,163 @@
+#include "optimization.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Largest body (in expression nodes) that is worth inlining
+#define INLINE_COST_LIMIT 12
+
+// A small global function is inlined by LLVM when it is not part of a cycle
+// of calls. A small method is expanded by the code generator at its call
+// sites, which only happens when no subtype redefines it (so the call always
+// reaches that body) and its own body calls no other method (so expanding it
+// never loops)
+
+typedef struct {
+    ASTNode** items;
+    int count;
+} TypeList;
+
+// method to count the expression nodes of a body
+static int body_cost(ASTNode* node) {
+    if (!node) {
+        return 0;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int cost = 1;
+
+    for (int i = 0; i < count; i++) {
+        cost += body_cost(children[i]);
+    }
+
+    free(children);
+    return cost;
+}
+
+// method to check whether or not a method body can be expanded in place
+static int is_expandable(ASTNode* node) {
+    if (!node) {
+        return 1;
+    }
+
+    if (node->type == NODE_BASE_FUNC || node->type == NODE_FUNC_DEC ||
+        (node->type == NODE_TYPE_GET_ATTR && node->data.op_node.right->type == NODE_FUNC_CALL)) {
+        return 0;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int expandable = 1;
+
+    for (int i = 0; i < count && expandable; i++) {
+        expandable = is_expandable(children[i]);
+    }
+
+    free(children);
+    return expandable;
+}
+
+static void collect_types(ASTNode* node, TypeList* types) {
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_TYPE_DEC) {
+        types->items = realloc(types->items, sizeof(ASTNode*) * (types->count + 1));
+        types->items[types->count++] = node;
+        return;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        collect_types(children[i], types);
+    }
+
+    free(children);
+}
+
+static ASTNode* find_type_dec(TypeList* types, const char* name) {
+    for (int i = 0; i < types->count; i++) {
+        if (!strcmp(types->items[i]->data.type_node.name, name)) {
+            return types->items[i];
+        }
+    }
+    return NULL;
+}
+
+static ASTNode* find_method(ASTNode* type_dec, const char* method_name) {
+    char name[256];
+    snprintf(name, sizeof(name), "_%s_%s", type_dec->data.type_node.name, method_name);
+
+    for (int i = 0; i < type_dec->data.type_node.def_count; i++) {
+        ASTNode* def = type_dec->data.type_node.definitions[i];
+        if (def->type == NODE_FUNC_DEC && !strcmp(def->data.func_node.name, name)) {
+            return def;
+        }
+    }
+    return NULL;
+}
+
+// method to check whether or not a subtype of 'owner' redefines the method
+static int is_redefined(TypeList* types, ASTNode* owner, const char* method_name) {
+    for (int i = 0; i < types->count; i++) {
+        ASTNode* type_dec = types->items[i];
+        if (type_dec == owner || !find_method(type_dec, method_name)) {
+            continue;
+        }
+
+        // is 'owner' an ancestor of this type?
+        ASTNode* ancestor = type_dec;
+        while (ancestor && ancestor != owner && ancestor->data.type_node.parent_name[0] != '\0') {
+            ancestor = find_type_dec(types, ancestor->data.type_node.parent_name);
+        }
+        if (ancestor == owner) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void mark_methods(TypeList* types) {
+    for (int i = 0; i < types->count; i++) {
+        ASTNode* type_dec = types->items[i];
+        int prefix = strlen(type_dec->data.type_node.name) + 2;
+
+        for (int j = 0; j < type_dec->data.type_node.def_count; j++) {
+            ASTNode* def = type_dec->data.type_node.definitions[j];
+            if (def->type != NODE_FUNC_DEC) {
+                continue;
+            }
+
+            ASTNode* body = def->data.func_node.body;
+            const char* method_name = def->data.func_node.name + prefix;
+            if (body_cost(body) <= INLINE_COST_LIMIT && is_expandable(body) &&
+                !is_redefined(types, type_dec, method_name)) {
+                def->flags |= FLAG_INLINE;
+            }
+        }
+    }
+}
+
+// method to flag the functions and methods that are cheap enough to be
+// inlined at their call sites
+void mark_inline_candidates(ASTNode* node) {
+    CallGraph graph = build_call_graph(node);
+
+    for (int i = 0; i < graph.count; i++) {
+        ASTNode* dec = graph.items[i].dec;
+        if ((dec->flags & FLAG_NON_RECURSIVE) && body_cost(dec->data.func_node.body) <= INLINE_COST_LIMIT) {
+            dec->flags |= FLAG_INLINE;
+        }
+    }
+
+    free_call_graph(&graph);
+
+    TypeList types = { NULL, 0 };
+    collect_types(node, &types);
+    mark_methods(&types);
+    free(types.items);
+}
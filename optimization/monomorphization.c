@@ -0,0 +1,348 @@
+#include "optimization.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Most clones of a single function; calls with new argument types beyond
+// this use the generic version
+#define MAX_SPECIALIZATIONS 8
+
+// A global function with Object parameters is cloned for every tuple of
+// concrete argument types seen at its call sites ('f(new A())' calls
+// 'f__A'). In the clone, the uses of those parameters that depend on their
+// static type (type tests, casts and arguments of other calls) see the
+// concrete type, so the tests are decided against it and the calls inside
+// are specialized in turn. The value the clone returns keeps the declared
+// type, so callers need no change besides the name. Calls whose argument
+// types are not concrete, or that arrive once the function already has
+// MAX_SPECIALIZATIONS clones, keep calling the generic version. Parameters
+// assigned in the body are left generic, since they may later hold any value
+
+typedef struct Specialization {
+    Type** types;   // concrete type of each specialized parameter (NULL for the rest)
+    ASTNode* dec;
+} Specialization;
+
+typedef struct GenericFunction {
+    ASTNode* dec;
+    Specialization specs[MAX_SPECIALIZATIONS];
+    int count;
+} GenericFunction;
+
+typedef struct GenericList {
+    ASTNode* program;
+    GenericFunction* items;
+    int count;
+} GenericList;
+
+static void specialize_calls(ASTNode* node, GenericList* list);
+
+static Type* resolve(Type* type) {
+    return type && type->sub_type ? type->sub_type : type;
+}
+
+static GenericFunction* find_generic(GenericList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (!strcmp(list->items[i].dec->data.func_node.name, name)) {
+            return &list->items[i];
+        }
+    }
+    return NULL;
+}
+
+// method to get the type of an argument if it is precise enough to clone for
+static Type* concrete_type(ASTNode* arg) {
+    Type* type = resolve(arg->return_type);
+
+    if (!type || type_equals(type, &TYPE_OBJECT) || type_equals(type, &TYPE_NULL) ||
+        type_equals(type, &TYPE_ERROR) || type_equals(type, &TYPE_ANY) || type_equals(type, &TYPE_VOID)) {
+        return NULL;
+    }
+    return type;
+}
+
+static int is_specialized_param(ASTNode* dec, int index) {
+    ASTNode* param = dec->data.func_node.args[index];
+    return type_equals(resolve(param->return_type), &TYPE_OBJECT) &&
+        !is_reassigned(dec->data.func_node.body, param->data.variable_name);
+}
+
+static ASTNode** copy_list(ASTNode** items, int count);
+
+// method to copy a subtree of a function body (names and types are shared)
+static ASTNode* copy_node(ASTNode* node) {
+    if (!node) {
+        return NULL;
+    }
+
+    ASTNode* copy = malloc(sizeof(ASTNode));
+    *copy = *node;
+    copy->scope = create_scope(NULL);
+    copy->context = create_context(NULL);
+    copy->derivations = NULL;
+
+    switch (node->type) {
+        case NODE_BINARY_OP:
+        case NODE_UNARY_OP:
+        case NODE_ASSIGNMENT:
+        case NODE_D_ASSIGNMENT:
+        case NODE_LOOP:
+        case NODE_TYPE_GET_ATTR:
+            copy->data.op_node.left = copy_node(node->data.op_node.left);
+            copy->data.op_node.right = copy_node(node->data.op_node.right);
+            break;
+        case NODE_TEST_TYPE:
+        case NODE_CAST_TYPE:
+            copy->data.cast_test.exp = copy_node(node->data.cast_test.exp);
+            break;
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+            copy->data.program_node.statements = copy_list(node->data.program_node.statements,
+                node->data.program_node.count);
+            break;
+        case NODE_FUNC_CALL:
+        case NODE_BASE_FUNC:
+            copy->data.func_node.args = copy_list(node->data.func_node.args, node->data.func_node.arg_count);
+            break;
+        case NODE_FUNC_DEC:
+        case NODE_LET_IN:
+        case NODE_FOR_LOOP:
+            copy->data.func_node.args = copy_list(node->data.func_node.args, node->data.func_node.arg_count);
+            copy->data.func_node.body = copy_node(node->data.func_node.body);
+            break;
+        case NODE_CONDITIONAL:
+        case NODE_Q_CONDITIONAL:
+        case NODE_TYPE_SET_ATTR:
+            copy->data.cond_node.cond = copy_node(node->data.cond_node.cond);
+            copy->data.cond_node.body_true = copy_node(node->data.cond_node.body_true);
+            copy->data.cond_node.body_false = copy_node(node->data.cond_node.body_false);
+            break;
+        case NODE_TYPE_INST:
+            copy->data.type_node.args = copy_list(node->data.type_node.args, node->data.type_node.arg_count);
+            break;
+        default:
+            break;
+    }
+
+    return copy;
+}
+
+static ASTNode** copy_list(ASTNode** items, int count) {
+    ASTNode** copy = malloc(sizeof(ASTNode*) * (count > 0 ? count : 1));
+
+    for (int i = 0; i < count; i++) {
+        copy[i] = copy_node(items[i]);
+    }
+    return copy;
+}
+
+// method to give the concrete type to a use of a specialized parameter
+static void retype_use(ASTNode* node, ASTNode* dec, Type** types) {
+    if (!node || node->type != NODE_VARIABLE) {
+        return;
+    }
+
+    for (int i = 0; i < dec->data.func_node.arg_count; i++) {
+        if (types[i] && !strcmp(node->data.variable_name, dec->data.func_node.args[i]->data.variable_name)) {
+            node->return_type = types[i];
+            return;
+        }
+    }
+}
+
+// method to retype the uses of the specialized parameters whose static type
+// matters (the rest keep the declared type, so the values that flow out of
+// the body do not change their representation)
+static void retype_body(ASTNode* node, ASTNode* dec, Type** types) {
+    if (!node || node->type == NODE_FUNC_DEC) {
+        return;
+    }
+
+    if (node->type == NODE_TEST_TYPE || node->type == NODE_CAST_TYPE) {
+        retype_use(node->data.cast_test.exp, dec, types);
+    } else if (node->type == NODE_FUNC_CALL) {
+        for (int i = 0; i < node->data.func_node.arg_count; i++) {
+            retype_use(node->data.func_node.args[i], dec, types);
+        }
+    } else if (node->type == NODE_LET_IN) {
+        // a 'let' that declares a parameter's name hides it from there on
+        for (int i = 0; i < node->data.func_node.arg_count; i++) {
+            ASTNode* decl = node->data.func_node.args[i];
+            retype_body(decl->data.op_node.right, dec, types);
+
+            for (int j = 0; j < dec->data.func_node.arg_count; j++) {
+                if (types[j] && !strcmp(decl->data.op_node.left->data.variable_name,
+                        dec->data.func_node.args[j]->data.variable_name)) {
+                    return;
+                }
+            }
+        }
+        retype_body(node->data.func_node.body, dec, types);
+        return;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        retype_body(children[i], dec, types);
+    }
+
+    free(children);
+}
+
+// method to place a clone right after the function it comes from
+static void insert_after(ASTNode* program, ASTNode* dec, ASTNode* clone) {
+    int count = program->data.program_node.count;
+    ASTNode** statements = realloc(program->data.program_node.statements, sizeof(ASTNode*) * (count + 1));
+    int index = 0;
+
+    while (index < count && statements[index] != dec) {
+        index++;
+    }
+    index = index < count ? index + 1 : count;
+
+    memmove(&statements[index + 1], &statements[index], sizeof(ASTNode*) * (count - index));
+    statements[index] = clone;
+    program->data.program_node.statements = statements;
+    program->data.program_node.count = count + 1;
+}
+
+static ASTNode* create_specialization(GenericList* list, GenericFunction* generic, Type** types) {
+    ASTNode* dec = generic->dec;
+    ASTNode* clone = copy_node(dec);
+
+    char name[256];
+    int length = snprintf(name, sizeof(name), "%s_", dec->data.func_node.name);
+    for (int i = 0; i < dec->data.func_node.arg_count && length < (int)sizeof(name); i++) {
+        if (types[i]) {
+            length += snprintf(name + length, sizeof(name) - length, "_%s", types[i]->name);
+        }
+    }
+    clone->data.func_node.name = strdup(name);
+
+    for (int i = 0; i < dec->data.func_node.arg_count; i++) {
+        if (types[i]) {
+            clone->data.func_node.args[i]->return_type = types[i];
+        }
+    }
+    retype_body(clone->data.func_node.body, clone, types);
+
+    Specialization* spec = &generic->specs[generic->count++];
+    spec->types = types;
+    spec->dec = clone;
+    insert_after(list->program, dec, clone);
+
+    // the calls of the clone may be specialized too (a recursive call with
+    // the same types reaches the clone itself)
+    specialize_calls(clone->data.func_node.body, list);
+    return clone;
+}
+
+// method to find (or create) the clone for the argument types of a call
+static ASTNode* find_specialization(GenericList* list, GenericFunction* generic, ASTNode* call) {
+    ASTNode* dec = generic->dec;
+    int arg_count = dec->data.func_node.arg_count;
+    Type** types = malloc(sizeof(Type*) * (arg_count > 0 ? arg_count : 1));
+    int specialized = 0;
+
+    for (int i = 0; i < arg_count; i++) {
+        types[i] = NULL;
+        if (!is_specialized_param(dec, i)) {
+            continue;
+        }
+
+        types[i] = concrete_type(call->data.func_node.args[i]);
+        if (!types[i]) {
+            free(types);
+            return NULL;
+        }
+        specialized = 1;
+    }
+
+    for (int i = 0; i < generic->count && specialized; i++) {
+        int same = 1;
+        for (int j = 0; j < arg_count && same; j++) {
+            same = types[j] == generic->specs[i].types[j] ||
+                (types[j] && generic->specs[i].types[j] && type_equals(types[j], generic->specs[i].types[j]));
+        }
+        if (same) {
+            free(types);
+            return generic->specs[i].dec;
+        }
+    }
+
+    if (!specialized || generic->count == MAX_SPECIALIZATIONS) {
+        free(types);
+        return NULL;
+    }
+    return create_specialization(list, generic, types);
+}
+
+static void specialize_calls(ASTNode* node, GenericList* list) {
+    if (!node) {
+        return;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        specialize_calls(children[i], list);
+    }
+
+    free(children);
+
+    if (node->type == NODE_FUNC_CALL) {
+        GenericFunction* generic = find_generic(list, node->data.func_node.name);
+        if (generic && generic->dec->data.func_node.arg_count == node->data.func_node.arg_count) {
+            ASTNode* clone = find_specialization(list, generic, node);
+            if (clone) {
+                node->data.func_node.name = clone->data.func_node.name;
+            }
+        }
+    }
+}
+
+// method to clone the global functions with Object parameters for the
+// concrete argument types they are called with
+void specialize_functions(ASTNode* node) {
+    if (!node || node->type != NODE_PROGRAM) {
+        return;
+    }
+
+    GenericList list = { node, NULL, 0 };
+    for (int i = 0; i < node->data.program_node.count; i++) {
+        ASTNode* dec = node->data.program_node.statements[i];
+        if (dec->type != NODE_FUNC_DEC) {
+            continue;
+        }
+
+        for (int j = 0; j < dec->data.func_node.arg_count; j++) {
+            if (is_specialized_param(dec, j)) {
+                list.items = realloc(list.items, sizeof(GenericFunction) * (list.count + 1));
+                list.items[list.count].dec = dec;
+                list.items[list.count++].count = 0;
+                break;
+            }
+        }
+    }
+
+    // the clones are inserted while walking, so the original statements are
+    // visited from a snapshot
+    int count = node->data.program_node.count;
+    ASTNode** statements = malloc(sizeof(ASTNode*) * (count > 0 ? count : 1));
+    memcpy(statements, node->data.program_node.statements, sizeof(ASTNode*) * count);
+
+    for (int i = 0; i < count && list.count > 0; i++) {
+        specialize_calls(statements[i], &list);
+    }
+
+    free(statements);
+    for (int i = 0; i < list.count; i++) {
+        for (int j = 0; j < list.items[i].count; j++) {
+            free(list.items[i].specs[j].types);
+        }
+    }
+    free(list.items);
+}
@@ -0,0 +1,113 @@
+#include "optimization.h"
+#include <stdlib.h>
+
+// main method in the optimization phase. It is called once the semantic
+// check succeeded, so every node already has its final type
+void optimize_ast(ASTNode* node) {
+    if (!node) {
+        return;
+    }
+
+    fold_constants(node);
+    specialize_functions(node);
+    mark_closures(node);
+    mark_in_place_appends(node);
+    mark_gc_safepoints(node);
+    mark_stack_instances(node);
+    mark_tail_calls(node);
+    mark_non_recursive_functions(node);
+    mark_inline_candidates(node);
+    mark_function_effects(node);
+    mark_integer_ranges(node);
+    mark_discarded_values(node);
+    mark_immutable_bindings(node);
+}
+
+static void add_child(ASTNode*** children, int* count, ASTNode* child) {
+    if (!child) {
+        return;
+    }
+
+    *children = realloc(*children, sizeof(ASTNode*) * (*count + 1));
+    (*children)[(*count)++] = child;
+}
+
+// method to get the direct children of a node that are expressions. Member
+// names in attribute accesses are not included. The array must be freed
+int get_children(ASTNode* node, ASTNode*** children) {
+    int count = 0;
+    *children = NULL;
+
+    if (!node) {
+        return 0;
+    }
+
+    switch (node->type) {
+        case NODE_BINARY_OP:
+        case NODE_LOOP:
+        case NODE_ASSIGNMENT:
+        case NODE_D_ASSIGNMENT:
+            if (node->type != NODE_ASSIGNMENT && node->type != NODE_D_ASSIGNMENT)
+                add_child(children, &count, node->data.op_node.left);
+            add_child(children, &count, node->data.op_node.right);
+            break;
+        case NODE_UNARY_OP:
+            add_child(children, &count, node->data.op_node.left);
+            break;
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+            for (int i = 0; i < node->data.program_node.count; i++)
+                add_child(children, &count, node->data.program_node.statements[i]);
+            break;
+        case NODE_FUNC_CALL:
+        case NODE_BASE_FUNC:
+        case NODE_LET_IN:
+        case NODE_FUNC_DEC:
+        case NODE_FOR_LOOP:
+            // the parameters of a declaration are not expressions
+            if (node->type != NODE_FUNC_DEC) {
+                for (int i = 0; i < node->data.func_node.arg_count; i++)
+                    add_child(children, &count, node->data.func_node.args[i]);
+            }
+            if (node->type != NODE_FUNC_CALL && node->type != NODE_BASE_FUNC)
+                add_child(children, &count, node->data.func_node.body);
+            break;
+        case NODE_CONDITIONAL:
+        case NODE_Q_CONDITIONAL:
+            add_child(children, &count, node->data.cond_node.cond);
+            add_child(children, &count, node->data.cond_node.body_true);
+            add_child(children, &count, node->data.cond_node.body_false);
+            break;
+        case NODE_TYPE_SET_ATTR:
+            add_child(children, &count, node->data.cond_node.cond);
+            add_child(children, &count, node->data.cond_node.body_false);
+            break;
+        case NODE_TYPE_GET_ATTR: {
+            add_child(children, &count, node->data.op_node.left);
+            ASTNode* member = node->data.op_node.right;
+            if (member->type == NODE_FUNC_CALL) {
+                for (int i = 0; i < member->data.func_node.arg_count; i++)
+                    add_child(children, &count, member->data.func_node.args[i]);
+            }
+            break;
+        }
+        case NODE_TEST_TYPE:
+        case NODE_CAST_TYPE:
+            add_child(children, &count, node->data.cast_test.exp);
+            break;
+        case NODE_TYPE_INST:
+            for (int i = 0; i < node->data.type_node.arg_count; i++)
+                add_child(children, &count, node->data.type_node.args[i]);
+            break;
+        case NODE_TYPE_DEC:
+            for (int i = 0; i < node->data.type_node.p_arg_count; i++)
+                add_child(children, &count, node->data.type_node.p_args[i]);
+            for (int i = 0; i < node->data.type_node.def_count; i++)
+                add_child(children, &count, node->data.type_node.definitions[i]);
+            break;
+        default:
+            break;
+    }
+
+    return count;
+}
@@ -0,0 +1,73 @@
+#ifndef OPTIMIZATION_H
+#define OPTIMIZATION_H
+
+#include "../ast/ast.h"
+
+// main method in the optimization phase (runs over the typed AST)
+void optimize_ast(ASTNode* node);
+
+// constant folding and propagation of immutable 'let' bindings
+void fold_constants(ASTNode* node);
+int is_literal_node(ASTNode* node);
+int is_reassigned(ASTNode* node, const char* name);
+
+// clones of the functions with Object parameters for each tuple of
+// concrete argument types
+void specialize_functions(ASTNode* node);
+
+// functions declared inside blocks, which capture the variables around them
+void mark_closures(ASTNode* node);
+
+// in place growth of uniquely owned strings ('s @= ...')
+void mark_in_place_appends(ASTNode* node);
+
+// loops where the garbage collector can drop the temporaries of the frame
+void mark_gc_safepoints(ASTNode* node);
+
+// instances that never escape the frame that creates them
+void mark_stack_instances(ASTNode* node);
+
+// recursive calls that do not need to keep the frame of the caller
+void mark_tail_calls(ASTNode* node);
+
+// call graph of the global functions
+typedef struct FunctionInfo {
+    ASTNode* dec;
+    char** callees;     // names of the global functions called in the body
+    int callee_count;
+    int visited;
+} FunctionInfo;
+
+typedef struct CallGraph {
+    FunctionInfo* items;
+    int count;
+} CallGraph;
+
+CallGraph build_call_graph(ASTNode* node);
+FunctionInfo* find_global_function(CallGraph* graph, const char* name);
+int calls_back(CallGraph* graph, FunctionInfo* from, FunctionInfo* target);
+void free_call_graph(CallGraph* graph);
+
+// global functions that can never be active twice at the same time
+void mark_non_recursive_functions(ASTNode* node);
+
+// small functions and methods inlined at their call sites
+void mark_inline_candidates(ASTNode* node);
+
+// functions and methods that are pure or only read memory, and pure
+// recursive functions whose results can be cached
+void mark_function_effects(ASTNode* node);
+
+// Number expressions and variables computed with integer operations
+void mark_integer_ranges(ASTNode* node);
+
+// expressions whose values are never used
+void mark_discarded_values(ASTNode* node);
+
+// 'let' variables and parameters that always hold the value they are bound to
+void mark_immutable_bindings(ASTNode* node);
+
+// utils
+int get_children(ASTNode* node, ASTNode*** children);
+
+#endif
@@ -0,0 +1,529 @@
+#include "optimization.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every Number expression gets an interval of the values it may take, and
+// whether those values are always integers and may include -0. When an
+// expression and its operands are integers of at most 53 bits (so the
+// double operations on them are exact) and never -0 (which an integer can
+// not represent), the code generator computes it with i64 operations. A
+// 'let' variable whose every value is such an integer lives in an i64 slot.
+//
+// The interval of a variable joins its initial value and everything
+// assigned to it, so it is solved as a fixpoint over the scope of the
+// variable, with widening to keep it finite. Inside a 'while' body or a
+// branch, the conditions that compare a variable with a known value narrow
+// it until the variable is assigned again. A variable assigned by a closure
+// may change at any call, so it never gets a range
+
+// largest magnitude up to which every integer is exactly a double
+#define EXACT_LIMIT 9007199254740992.0
+
+// largest constant exponent of '^' computed with multiplications
+#define MAX_INTEGER_EXPONENT 64
+
+// iterations of a variable before its growing bounds are widened
+#define WIDEN_AFTER 3
+
+// iterations of a variable before its range is given up
+#define MAX_ITERATIONS 16
+
+typedef struct {
+    double lo;
+    double hi;
+    int integral;   // every value is an integer
+    int neg_zero;   // -0 may be one of the values
+} Range;
+
+typedef struct RangeVar {
+    const char* name;
+    Range range;    // every value of the variable in its scope
+    Range current;  // values at this point of the walk
+    Range assigned; // join of the values assigned in the last walk
+    int has_assigned;
+    int captured;   // assigned inside a function declared in its scope
+    struct RangeVar* next;
+} RangeVar;
+
+// 'let' variables visible at this point of the walk, innermost first
+static RangeVar* scope = NULL;
+
+static const Range FULL_RANGE = { -INFINITY, INFINITY, 0, 1 };
+
+static Range interval(double lo, double hi, int integral, int neg_zero) {
+    if (isnan(lo) || isnan(hi)) {
+        return FULL_RANGE;
+    }
+    Range range = { lo, hi, integral, neg_zero };
+    return range;
+}
+
+static Range point(double value) {
+    return interval(value, value, value == floor(value), value == 0 && signbit(value));
+}
+
+static int contains_zero(Range range) {
+    return range.lo <= 0 && range.hi >= 0;
+}
+
+// method to check whether or not the values of a range are computed
+// exactly with i64 operations
+static int is_exact(Range range) {
+    return range.integral && !range.neg_zero && range.lo >= -EXACT_LIMIT && range.hi <= EXACT_LIMIT;
+}
+
+static Range join(Range a, Range b) {
+    return interval(fmin(a.lo, b.lo), fmax(a.hi, b.hi), a.integral && b.integral, a.neg_zero || b.neg_zero);
+}
+
+static int is_subrange(Range inner, Range outer) {
+    return inner.lo >= outer.lo && inner.hi <= outer.hi &&
+        (inner.integral || !outer.integral) && (!inner.neg_zero || outer.neg_zero);
+}
+
+// method to jump the bounds that keep growing to infinity
+static Range widen(Range old, Range next) {
+    Range range = join(old, next);
+    if (next.lo < old.lo) range.lo = -INFINITY;
+    if (next.hi > old.hi) range.hi = INFINITY;
+    return range;
+}
+
+static RangeVar* find_var(const char* name) {
+    for (RangeVar* var = scope; var; var = var->next) {
+        if (!strcmp(var->name, name)) {
+            return var;
+        }
+    }
+    return NULL;
+}
+
+static int is_number(ASTNode* node) {
+    return node->return_type && type_equals(node->return_type, &TYPE_NUMBER);
+}
+
+static Range multiply(Range a, Range b) {
+    double p1 = a.lo * b.lo, p2 = a.lo * b.hi, p3 = a.hi * b.lo, p4 = a.hi * b.hi;
+    // a zero times a negative value (or -0 times a positive one) is -0
+    int neg_zero = ((contains_zero(a) || a.neg_zero) && (b.lo < 0 || b.neg_zero)) ||
+        ((contains_zero(b) || b.neg_zero) && (a.lo < 0 || a.neg_zero));
+    return interval(fmin(fmin(p1, p2), fmin(p3, p4)), fmax(fmax(p1, p2), fmax(p3, p4)),
+        a.integral && b.integral, neg_zero);
+}
+
+static Range remainder_range(Range a, Range b) {
+    if (contains_zero(b) || b.neg_zero || isinf(a.lo) || isinf(a.hi)) {
+        return FULL_RANGE;
+    }
+
+    // the result has the sign of the dividend and is smaller than the divisor
+    double limit = fmax(fabs(b.lo), fabs(b.hi));
+    if (a.integral && b.integral) {
+        limit -= 1;
+    }
+    double lo = a.lo >= 0 ? 0 : fmax(a.lo, -limit);
+    double hi = a.hi <= 0 ? 0 : fmin(a.hi, limit);
+    return interval(lo, hi, a.integral && b.integral, a.lo < 0 || a.neg_zero);
+}
+
+static Range power_range(Range base, ASTNode* exponent) {
+    if (exponent->type != NODE_NUMBER) {
+        return FULL_RANGE;
+    }
+
+    double n = exponent->data.number_value;
+    if (n != floor(n) || n < 0 || n > MAX_INTEGER_EXPONENT) {
+        return FULL_RANGE;
+    }
+    if (n == 0) {
+        return point(1);
+    }
+
+    double low = pow(base.lo, n), high = pow(base.hi, n);
+    int odd = fmod(n, 2) == 1;
+    if (odd) {
+        return interval(low, high, base.integral, base.neg_zero);
+    }
+    double top = fmax(low, high);
+    return interval(contains_zero(base) ? 0 : fmin(low, high), top, base.integral, 0);
+}
+
+static Range analyze(ASTNode* node);
+
+// method to narrow the variables compared in a condition, knowing the
+// condition evaluated to 'truth'
+static void narrow(ASTNode* cond, int truth) {
+    if (cond->type == NODE_UNARY_OP && cond->data.op_node.op == OP_NOT) {
+        narrow(cond->data.op_node.left, !truth);
+        return;
+    }
+    if (cond->type != NODE_BINARY_OP) {
+        return;
+    }
+
+    Operator op = cond->data.op_node.op;
+    if ((op == OP_AND && truth) || (op == OP_OR && !truth)) {
+        narrow(cond->data.op_node.left, truth);
+        narrow(cond->data.op_node.right, truth);
+        return;
+    }
+
+    ASTNode* left = cond->data.op_node.left;
+    ASTNode* right = cond->data.op_node.right;
+    if (!is_number(left) || !is_number(right)) {
+        return;
+    }
+
+    // 'c < x' is 'x > c'
+    RangeVar* var = left->type == NODE_VARIABLE ? find_var(left->data.variable_name) : NULL;
+    ASTNode* other = right;
+    if (!var && right->type == NODE_VARIABLE) {
+        var = find_var(right->data.variable_name);
+        other = left;
+        switch (op) {
+            case OP_LS: op = OP_GR; break;
+            case OP_LSE: op = OP_GRE; break;
+            case OP_GR: op = OP_LS; break;
+            case OP_GRE: op = OP_LSE; break;
+            default: break;
+        }
+    }
+    if (!var) {
+        return;
+    }
+
+    Range bound;
+    if (other->type == NODE_NUMBER) {
+        bound = point(other->data.number_value);
+    } else if (other->type == NODE_VARIABLE && find_var(other->data.variable_name)) {
+        bound = find_var(other->data.variable_name)->current;
+    } else {
+        return;
+    }
+
+    // a false comparison is the opposite one
+    if (!truth) {
+        switch (op) {
+            case OP_LS: op = OP_GRE; break;
+            case OP_LSE: op = OP_GR; break;
+            case OP_GR: op = OP_LSE; break;
+            case OP_GRE: op = OP_LS; break;
+            case OP_EQ: op = OP_NEQ; break;
+            default: return;
+        }
+    }
+
+    Range* current = &var->current;
+    int integral = current->integral;
+    switch (op) {
+        case OP_LS:
+            current->hi = fmin(current->hi, integral ? ceil(bound.hi) - 1 : bound.hi);
+            break;
+        case OP_LSE:
+            current->hi = fmin(current->hi, integral ? floor(bound.hi) : bound.hi);
+            break;
+        case OP_GR:
+            current->lo = fmax(current->lo, integral ? floor(bound.lo) + 1 : bound.lo);
+            break;
+        case OP_GRE:
+            current->lo = fmax(current->lo, integral ? ceil(bound.lo) : bound.lo);
+            break;
+        case OP_EQ:
+            current->lo = fmax(current->lo, bound.lo);
+            current->hi = fmin(current->hi, bound.hi);
+            break;
+        default:
+            break;
+    }
+}
+
+// method to copy the current ranges of the visible variables
+static Range* save_scope(void) {
+    int count = 0;
+    for (RangeVar* var = scope; var; var = var->next) count++;
+
+    Range* saved = malloc(sizeof(Range) * (count + 1));
+    int i = 0;
+    for (RangeVar* var = scope; var; var = var->next) {
+        saved[i++] = var->current;
+    }
+    return saved;
+}
+
+// method to go back to the saved ranges after a branch or a loop. The
+// variables assigned inside may hold any of their values afterwards
+static void restore_scope(Range* saved, ASTNode* node) {
+    int i = 0;
+    for (RangeVar* var = scope; var; var = var->next) {
+        var->current = is_reassigned(node, var->name) ? var->range : saved[i];
+        i++;
+    }
+}
+
+static Range analyze_children(ASTNode* node) {
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        analyze(children[i]);
+    }
+
+    free(children);
+    return FULL_RANGE;
+}
+
+// method to analyze a body that can not see the variables around it
+static void analyze_isolated(ASTNode* body) {
+    RangeVar* enclosing = scope;
+    scope = NULL;
+    analyze(body);
+    scope = enclosing;
+}
+
+static Range analyze_let(ASTNode* node, int index);
+
+// method to check whether or not a function declared inside a node assigns
+// a variable
+static int is_assigned_by_closure(ASTNode* node, const char* name) {
+    if (!node) {
+        return 0;
+    }
+    if (node->type == NODE_FUNC_DEC) {
+        return is_reassigned(node->data.func_node.body, name);
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int assigned = 0;
+
+    for (int i = 0; i < count && !assigned; i++) {
+        assigned = is_assigned_by_closure(children[i], name);
+    }
+
+    free(children);
+    return assigned;
+}
+
+// method to solve the range of the index-th variable of a 'let' over the
+// rest of the declarations and the body
+static Range analyze_declaration(ASTNode* node, int index) {
+    ASTNode* declaration = node->data.func_node.args[index];
+    ASTNode* value = declaration->data.op_node.right;
+    Range initial = analyze(value);
+    const char* name = declaration->data.op_node.left->data.variable_name;
+
+    int captured = is_assigned_by_closure(node->data.func_node.body, name);
+    for (int i = index + 1; i < node->data.func_node.arg_count && !captured; i++) {
+        captured = is_assigned_by_closure(node->data.func_node.args[i]->data.op_node.right, name);
+    }
+    if (captured) {
+        initial = FULL_RANGE;
+    }
+
+    RangeVar var = { name, initial, initial, initial, 0, captured, scope };
+    scope = &var;
+
+    Range result;
+    Range range = initial;
+    Range next;
+    int converged = 0;
+    for (int iteration = 0; iteration < MAX_ITERATIONS && !converged; iteration++) {
+        var.range = var.current = range;
+        var.has_assigned = 0;
+        result = analyze_let(node, index + 1);
+
+        next = var.has_assigned ? join(initial, var.assigned) : initial;
+        converged = is_subrange(next, range);
+        if (!converged) {
+            range = iteration >= WIDEN_AFTER ? widen(range, next) : join(range, next);
+        }
+    }
+
+    if (!converged) {
+        range = FULL_RANGE;
+        var.range = var.current = range;
+        var.has_assigned = 0;
+        result = analyze_let(node, index + 1);
+    } else if (!is_subrange(range, next)) {
+        // one step back from the widened range is still safe
+        range = next;
+        var.range = var.current = range;
+        var.has_assigned = 0;
+        result = analyze_let(node, index + 1);
+    }
+
+    scope = var.next;
+
+    // a variable declared as Object keeps the tagged representation
+    const char* declared_type = declaration->data.op_node.left->static_type;
+    if (is_number(value) && is_exact(range) && (!declared_type || strcmp(declared_type, "Object"))) {
+        declaration->flags |= FLAG_INTEGRAL;
+    } else {
+        declaration->flags &= ~FLAG_INTEGRAL;
+    }
+    return result;
+}
+
+static Range analyze_let(ASTNode* node, int index) {
+    if (index == node->data.func_node.arg_count) {
+        return analyze(node->data.func_node.body);
+    }
+    return analyze_declaration(node, index);
+}
+
+static Range analyze_binary(ASTNode* node) {
+    Range a = analyze(node->data.op_node.left);
+    Range b = analyze(node->data.op_node.right);
+
+    if (!is_number(node)) {
+        return FULL_RANGE;
+    }
+
+    Range result;
+    int operands_exact = is_exact(a) && is_exact(b);
+    switch (node->data.op_node.op) {
+        case OP_ADD:
+            result = interval(a.lo + b.lo, a.hi + b.hi, a.integral && b.integral, a.neg_zero && b.neg_zero);
+            break;
+        case OP_SUB:
+            result = interval(a.lo - b.hi, a.hi - b.lo, a.integral && b.integral, a.neg_zero && contains_zero(b));
+            break;
+        case OP_MUL:
+            result = multiply(a, b);
+            break;
+        case OP_MOD:
+            result = remainder_range(a, b);
+            break;
+        case OP_POW:
+            result = power_range(a, node->data.op_node.right);
+            operands_exact = is_exact(a);
+            break;
+        default:
+            return FULL_RANGE;
+    }
+
+    if (operands_exact && is_exact(result)) {
+        node->flags |= FLAG_INTEGRAL;
+    }
+    return result;
+}
+
+// method to compute the range of a node, flagging the integer expressions
+static Range analyze(ASTNode* node) {
+    if (!node) {
+        return FULL_RANGE;
+    }
+
+    node->flags &= ~FLAG_INTEGRAL;
+
+    switch (node->type) {
+        case NODE_NUMBER: {
+            Range range = point(node->data.number_value);
+            if (is_exact(range)) {
+                node->flags |= FLAG_INTEGRAL;
+            }
+            return range;
+        }
+        case NODE_VARIABLE: {
+            RangeVar* var = find_var(node->data.variable_name);
+            if (!var || !is_number(node)) {
+                return FULL_RANGE;
+            }
+            if (is_exact(var->current)) {
+                node->flags |= FLAG_INTEGRAL;
+            }
+            return var->current;
+        }
+        case NODE_BINARY_OP:
+            return analyze_binary(node);
+        case NODE_UNARY_OP: {
+            Range operand = analyze(node->data.op_node.left);
+            if (node->data.op_node.op != OP_NEGATE || !is_number(node)) {
+                return FULL_RANGE;
+            }
+            // -(+0) is -0
+            Range range = interval(-operand.hi, -operand.lo, operand.integral, contains_zero(operand));
+            if (is_exact(operand) && is_exact(range)) {
+                node->flags |= FLAG_INTEGRAL;
+            }
+            return range;
+        }
+        case NODE_D_ASSIGNMENT: {
+            Range value = analyze(node->data.op_node.right);
+            RangeVar* var = find_var(node->data.op_node.left->data.variable_name);
+            if (var) {
+                var->assigned = var->has_assigned ? join(var->assigned, value) : value;
+                var->has_assigned = 1;
+                var->current = var->captured ? FULL_RANGE : value;
+            }
+            return value;
+        }
+        case NODE_BLOCK:
+        case NODE_PROGRAM: {
+            Range last = FULL_RANGE;
+            for (int i = 0; i < node->data.program_node.count; i++) {
+                last = analyze(node->data.program_node.statements[i]);
+            }
+            return last;
+        }
+        case NODE_LET_IN:
+            return analyze_let(node, 0);
+        case NODE_CONDITIONAL: {
+            ASTNode* cond = node->data.cond_node.cond;
+            analyze(cond);
+            Range* saved = save_scope();
+
+            narrow(cond, 1);
+            Range result = analyze(node->data.cond_node.body_true);
+            restore_scope(saved, cond);
+
+            narrow(cond, 0);
+            if (node->data.cond_node.body_false) {
+                result = join(result, analyze(node->data.cond_node.body_false));
+            }
+
+            restore_scope(saved, node);
+            free(saved);
+            return is_number(node) ? result : FULL_RANGE;
+        }
+        case NODE_Q_CONDITIONAL: {
+            Range* saved = save_scope();
+            analyze_children(node);
+            restore_scope(saved, node);
+            free(saved);
+            return FULL_RANGE;
+        }
+        case NODE_LOOP: {
+            // the condition runs again after every iteration
+            Range* saved = save_scope();
+            restore_scope(saved, node);
+            analyze(node->data.op_node.left);
+
+            narrow(node->data.op_node.left, 1);
+            analyze(node->data.op_node.right);
+
+            restore_scope(saved, node);
+            free(saved);
+            return FULL_RANGE;
+        }
+        case NODE_FUNC_DEC:
+            analyze_isolated(node->data.func_node.body);
+            return FULL_RANGE;
+        case NODE_TYPE_DEC:
+            for (int i = 0; i < node->data.type_node.def_count; i++) {
+                ASTNode* def = node->data.type_node.definitions[i];
+                analyze_isolated(def->type == NODE_FUNC_DEC ? def->data.func_node.body : def->data.op_node.right);
+            }
+            return FULL_RANGE;
+        default:
+            return analyze_children(node);
+    }
+}
+
+// method to find the Number expressions and variables that always hold
+// integers small enough to be computed with i64 operations
+void mark_integer_ranges(ASTNode* node) {
+    scope = NULL;
+    analyze(node);
+}
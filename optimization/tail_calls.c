@@ -0,0 +1,85 @@
+#include "optimization.h"
+#include <stdlib.h>
+
+// A call is in tail position when its value is the value of the whole
+// function body: the last expression of a block, the body of a 'let' or a
+// branch of a conditional placed in tail position. A tail call to the same
+// function, or to one that calls it back, does not need to keep the frame
+// of the caller alive, unless the callee is a closure declared inside the
+// caller, whose environment lives in that frame
+
+// method to check whether or not 'callee' is 'caller' or calls it back
+static int is_recursive_call(CallGraph* graph, FunctionInfo* caller, FunctionInfo* callee) {
+    return caller == callee || calls_back(graph, callee, caller);
+}
+
+// method to check whether or not 'dec' is declared inside 'node'
+static int declares(ASTNode* node, ASTNode* dec) {
+    if (!node) {
+        return 0;
+    }
+    if (node == dec) {
+        return 1;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int found = 0;
+
+    for (int i = 0; i < count && !found; i++) {
+        found = declares(children[i], dec);
+    }
+
+    free(children);
+    return found;
+}
+
+static void mark_tail_position(ASTNode* node, CallGraph* graph, FunctionInfo* caller) {
+    if (!node) {
+        return;
+    }
+
+    switch (node->type) {
+        case NODE_FUNC_CALL: {
+            FunctionInfo* callee = find_global_function(graph, node->data.func_node.name);
+            Type* caller_type = caller->dec->data.func_node.body->return_type;
+            // the result goes back unchanged, so both must return the same type
+            if (callee && is_recursive_call(graph, caller, callee) &&
+                type_equals(callee->dec->data.func_node.body->return_type, caller_type) &&
+                !(callee != caller && (callee->dec->flags & FLAG_CLOSURE) &&
+                    declares(caller->dec->data.func_node.body, callee->dec))) {
+                node->flags |= FLAG_TAIL_CALL;
+            }
+            break;
+        }
+        case NODE_BLOCK: {
+            int count = node->data.program_node.count;
+            if (count > 0) {
+                mark_tail_position(node->data.program_node.statements[count - 1], graph, caller);
+            }
+            break;
+        }
+        case NODE_LET_IN:
+            mark_tail_position(node->data.func_node.body, graph, caller);
+            break;
+        case NODE_CONDITIONAL:
+            mark_tail_position(node->data.cond_node.body_true, graph, caller);
+            mark_tail_position(node->data.cond_node.body_false, graph, caller);
+            break;
+        default:
+            break;
+    }
+}
+
+// method to flag the recursive calls in tail position of the global
+// functions, which are compiled as jumps (or sibling calls) without growing
+// the stack
+void mark_tail_calls(ASTNode* node) {
+    CallGraph graph = build_call_graph(node);
+
+    for (int i = 0; i < graph.count; i++) {
+        mark_tail_position(graph.items[i].dec->data.func_node.body, &graph, &graph.items[i]);
+    }
+
+    free_call_graph(&graph);
+}
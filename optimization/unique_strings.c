@@ -0,0 +1,237 @@
+#include "optimization.h"
+#include <stdlib.h>
+#include <string.h>
+
+// How the value of an expression is consumed by its parent
+typedef enum {
+    VALUE_USED,      // it may be stored somewhere while the variable is alive
+    VALUE_TAIL,      // it becomes the value of the 'let' that owns the variable
+    VALUE_DISCARDED  // nobody reads it
+} ValueContext;
+
+typedef struct {
+    const char* name;
+    ASTNode** appends;
+    int count;
+} AppendCandidates;
+
+static int is_concat(ASTNode* node) {
+    return node->type == NODE_BINARY_OP && (
+        node->data.op_node.op == OP_CONCAT ||
+        node->data.op_node.op == OP_DCONCAT
+    );
+}
+
+static int is_comparison(Operator op) {
+    return op == OP_EQ || op == OP_NEQ || op == OP_GR ||
+        op == OP_GRE || op == OP_LS || op == OP_LSE;
+}
+
+static int is_variable(ASTNode* node, const char* name) {
+    return node->type == NODE_VARIABLE && !strcmp(node->data.variable_name, name);
+}
+
+// method to check whether or not an expression builds a new string buffer
+static int is_fresh_string(ASTNode* node) {
+    return node->type == NODE_STRING || is_concat(node);
+}
+
+// method to check whether or not a variable is read inside a node
+static int mentions_variable(ASTNode* node, const char* name) {
+    if (!node) {
+        return 0;
+    }
+
+    if (is_variable(node, name)) {
+        return 1;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int found = 0;
+
+    for (int i = 0; i < count && !found; i++) {
+        found = mentions_variable(children[i], name);
+    }
+
+    free(children);
+    return found;
+}
+
+static ASTNode* leftmost_operand(ASTNode* node) {
+    while (is_concat(node)) {
+        node = node->data.op_node.left;
+    }
+    return node;
+}
+
+static int check_uses(ASTNode* node, AppendCandidates* candidates, ValueContext context);
+
+// method to check the operands of a chain of '@' and '@@' (they are copied)
+static int check_concat_operands(ASTNode* node, AppendCandidates* candidates, int skip_first) {
+    if (is_concat(node)) {
+        return check_concat_operands(node->data.op_node.left, candidates, skip_first) &&
+            check_concat_operands(node->data.op_node.right, candidates, 0);
+    }
+
+    if (skip_first || is_variable(node, candidates->name)) {
+        return 1;
+    }
+
+    return check_uses(node, candidates, VALUE_USED);
+}
+
+static void add_candidate(AppendCandidates* candidates, ASTNode* node) {
+    candidates->appends = realloc(candidates->appends, sizeof(ASTNode*) * (candidates->count + 1));
+    candidates->appends[candidates->count++] = node;
+}
+
+// method to check that the string held by the variable never gets another
+// owner while the variable is alive. The appends 's := s @ ...' found are
+// stored as candidates
+static int check_uses(ASTNode* node, AppendCandidates* candidates, ValueContext context) {
+    if (!node) {
+        return 1;
+    }
+
+    const char* name = candidates->name;
+
+    switch (node->type) {
+        case NODE_VARIABLE:
+            return !is_variable(node, name) || context != VALUE_USED;
+        case NODE_D_ASSIGNMENT: {
+            ASTNode* value = node->data.op_node.right;
+            if (!is_variable(node->data.op_node.left, name)) {
+                return check_uses(value, candidates, VALUE_USED);
+            }
+            // the new string would be shared with whoever reads the assignment
+            if (context == VALUE_USED) {
+                return 0;
+            }
+            if (is_concat(value) && is_variable(leftmost_operand(value), name)) {
+                // the appended pieces must not point into the buffer that grows
+                int others = 0;
+                for (ASTNode* current = value; is_concat(current); current = current->data.op_node.left) {
+                    others = others || mentions_variable(current->data.op_node.right, name);
+                }
+                if (!others) {
+                    add_candidate(candidates, node);
+                    return check_concat_operands(value, candidates, 1);
+                }
+            }
+            return is_fresh_string(value) && check_uses(value, candidates, VALUE_USED);
+        }
+        case NODE_BINARY_OP:
+            if (is_concat(node)) {
+                return check_concat_operands(node, candidates, 0);
+            }
+            if (is_comparison(node->data.op_node.op)) {
+                // comparisons only read the characters
+                ASTNode* left = node->data.op_node.left;
+                ASTNode* right = node->data.op_node.right;
+                return (is_variable(left, name) || check_uses(left, candidates, VALUE_USED)) &&
+                    (is_variable(right, name) || check_uses(right, candidates, VALUE_USED));
+            }
+            break;
+        case NODE_FUNC_CALL:
+            if (!strcmp(node->data.func_node.name, "print") && node->data.func_node.arg_count == 1) {
+                ASTNode* arg = node->data.func_node.args[0];
+                return is_variable(arg, name) || check_uses(arg, candidates, VALUE_USED);
+            }
+            break;
+        case NODE_BLOCK: {
+            int count = node->data.program_node.count;
+            for (int i = 0; i < count; i++) {
+                ValueContext stmt_context = i == count - 1 ? context : VALUE_DISCARDED;
+                if (!check_uses(node->data.program_node.statements[i], candidates, stmt_context))
+                    return 0;
+            }
+            return 1;
+        }
+        case NODE_LOOP:
+            // the value of a loop is the value of its last iteration
+            return check_uses(node->data.op_node.left, candidates, VALUE_USED) &&
+                check_uses(node->data.op_node.right, candidates, context);
+        case NODE_CONDITIONAL:
+            return check_uses(node->data.cond_node.cond, candidates, VALUE_USED) &&
+                check_uses(node->data.cond_node.body_true, candidates, context) &&
+                check_uses(node->data.cond_node.body_false, candidates, context);
+        case NODE_LET_IN:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                ASTNode* declaration = node->data.func_node.args[i];
+                if (!check_uses(declaration->data.op_node.right, candidates, VALUE_USED))
+                    return 0;
+                // from here on the name belongs to the inner variable
+                if (is_variable(declaration->data.op_node.left, name))
+                    return 1;
+            }
+            return check_uses(node->data.func_node.body, candidates, context);
+        default:
+            break;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int safe = 1;
+
+    for (int i = 0; i < count && safe; i++) {
+        safe = check_uses(children[i], candidates, VALUE_USED);
+    }
+
+    free(children);
+    return safe;
+}
+
+// method to analyze the i-th declaration of a 'let'
+static void analyze_let_variable(ASTNode* let_node, int index) {
+    ASTNode* declaration = let_node->data.func_node.args[index];
+    ASTNode* var = declaration->data.op_node.left;
+    ASTNode* value = declaration->data.op_node.right;
+
+    if (!type_equals(var->return_type, &TYPE_STRING) || !is_fresh_string(value)) {
+        return;
+    }
+
+    AppendCandidates candidates = { var->data.variable_name, NULL, 0 };
+    int safe = 1;
+    int shadowed = 0;
+
+    for (int i = index + 1; i < let_node->data.func_node.arg_count && safe && !shadowed; i++) {
+        ASTNode* next = let_node->data.func_node.args[i];
+        safe = check_uses(next->data.op_node.right, &candidates, VALUE_USED);
+        shadowed = is_variable(next->data.op_node.left, candidates.name);
+    }
+
+    if (safe && !shadowed) {
+        safe = check_uses(let_node->data.func_node.body, &candidates, VALUE_TAIL);
+    }
+
+    for (int i = 0; safe && i < candidates.count; i++) {
+        candidates.appends[i]->flags |= FLAG_IN_PLACE_APPEND;
+    }
+
+    free(candidates.appends);
+}
+
+// method to find the appends 's := s @ ...' that can grow the buffer of 's'
+// in place because no one else holds its string
+void mark_in_place_appends(ASTNode* node) {
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_LET_IN) {
+        for (int i = 0; i < node->data.func_node.arg_count; i++) {
+            analyze_let_variable(node, i);
+        }
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        mark_in_place_appends(children[i]);
+    }
+
+    free(children);
+}
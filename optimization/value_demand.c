@@ -0,0 +1,113 @@
+#include "optimization.h"
+#include <stdlib.h>
+
+// The value of an expression is demanded unless it sits where nothing reads
+// it: a statement of the program, a statement of a block other than the
+// last, or the last statement, the 'let' body, the branches or the 'while'
+// body of an expression whose own value is not demanded. The code generator
+// gives a discarded loop no result slot and a discarded conditional no phi,
+// and skips a discarded expression that can not change anything
+
+// method to check that evaluating an expression has no effect besides its
+// value: it calls nothing, assigns nothing and can not fail at runtime
+static int is_effect_free(ASTNode* node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+        case NODE_STRING:
+        case NODE_BOOLEAN:
+        case NODE_VARIABLE:
+            return 1;
+        case NODE_BINARY_OP:
+        case NODE_UNARY_OP:
+        case NODE_TEST_TYPE:
+        case NODE_BLOCK:
+        case NODE_LET_IN:
+        case NODE_CONDITIONAL:
+        case NODE_ASSIGNMENT:
+            // 'let' declarations are the only plain assignments in an
+            // expression: they bind a new variable
+            break;
+        default:
+            return 0;
+    }
+
+    ASTNode** children;
+    int count = get_children(node, &children);
+    int effect_free = 1;
+
+    for (int i = 0; i < count && effect_free; i++) {
+        effect_free = is_effect_free(children[i]);
+    }
+
+    free(children);
+    return effect_free;
+}
+
+static void visit(ASTNode* node, int demanded);
+
+static void visit_children(ASTNode* node, int demanded) {
+    ASTNode** children;
+    int count = get_children(node, &children);
+
+    for (int i = 0; i < count; i++) {
+        visit(children[i], demanded);
+    }
+
+    free(children);
+}
+
+static void visit(ASTNode* node, int demanded) {
+    if (!node) {
+        return;
+    }
+
+    int expression = node->type != NODE_PROGRAM && node->type != NODE_FUNC_DEC &&
+        node->type != NODE_TYPE_DEC;
+    if (!demanded && expression) {
+        node->flags |= FLAG_DISCARDED;
+        if (is_effect_free(node)) {
+            node->flags |= FLAG_DEAD;
+            return;
+        }
+    }
+
+    switch (node->type) {
+        case NODE_PROGRAM:
+            visit_children(node, 0);
+            break;
+        case NODE_BLOCK: {
+            int last = node->data.program_node.count - 1;
+            for (int i = 0; i <= last; i++) {
+                visit(node->data.program_node.statements[i], i == last && demanded);
+            }
+            break;
+        }
+        case NODE_LET_IN:
+            for (int i = 0; i < node->data.func_node.arg_count; i++) {
+                visit(node->data.func_node.args[i], 1);
+            }
+            visit(node->data.func_node.body, demanded);
+            break;
+        case NODE_CONDITIONAL:
+        case NODE_Q_CONDITIONAL:
+            visit(node->data.cond_node.cond, 1);
+            visit(node->data.cond_node.body_true, demanded);
+            visit(node->data.cond_node.body_false, demanded);
+            break;
+        case NODE_LOOP:
+            visit(node->data.op_node.left, 1);
+            visit(node->data.op_node.right, demanded);
+            break;
+        default:
+            // function bodies return their value and everything else reads
+            // the values of its operands
+            visit_children(node, 1);
+            break;
+    }
+}
+
+// method to flag the expressions whose values are never used, and among
+// them the ones that need not be evaluated at all
+void mark_discarded_values(ASTNode* node) {
+    visit(node, 0);
+}
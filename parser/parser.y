@@ -193,6 +193,23 @@ block_expr_list:
         }
     }
 
+    | function_declaration block_expr_list {
+        $$ = malloc(sizeof(*$$));
+        $$->args = malloc(sizeof(ASTNode *) * ($2->arg_count + 1));
+        $$->args[0] = $1;
+        memcpy($$->args + 1, $2->args, sizeof(ASTNode *) * $2->arg_count);
+        $$->arg_count = $2->arg_count + 1;
+        free($2->args);
+    }
+    | function_declaration SEMICOLON block_expr_list {
+        $$ = malloc(sizeof(*$$));
+        $$->args = malloc(sizeof(ASTNode *) * ($3->arg_count + 1));
+        $$->args[0] = $1;
+        memcpy($$->args + 1, $3->args, sizeof(ASTNode *) * $3->arg_count);
+        $$->arg_count = $3->arg_count + 1;
+        free($3->args);
+    }
+
     | /* empty */ {
         $$ = malloc(sizeof(*$$));
         $$->args = NULL;
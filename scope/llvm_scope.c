@@ -28,13 +28,13 @@ void pop_scope(void) {
     current_scope = parent;
 }
 
-LLVMValueRef lookup_variable(const char* name) {
+static ScopeVarEntry* find_entry(const char* name) {
     LLVMScope* scope = current_scope;
     while (scope) {
         ScopeVarEntry* entry = scope->variables;
         while (entry) {
             if (strcmp(entry->name, name) == 0) {
-                return entry->alloca;
+                return entry;
             }
             entry = entry->next;
         }
@@ -43,14 +43,33 @@ LLVMValueRef lookup_variable(const char* name) {
     return NULL;
 }
 
-void declare_variable(const char* name, LLVMValueRef alloca) {
+LLVMValueRef lookup_variable(const char* name) {
+    ScopeVarEntry* entry = find_entry(name);
+    return entry && !entry->is_value ? entry->alloca : NULL;
+}
+
+LLVMValueRef lookup_value(const char* name) {
+    ScopeVarEntry* entry = find_entry(name);
+    return entry && entry->is_value ? entry->alloca : NULL;
+}
+
+static void add_entry(const char* name, LLVMValueRef alloca, int is_value) {
     ScopeVarEntry* entry = malloc(sizeof(ScopeVarEntry));
     entry->name = strdup(name);
     entry->alloca = alloca;
+    entry->is_value = is_value;
     entry->next = current_scope->variables;
     current_scope->variables = entry;
 }
 
+void declare_variable(const char* name, LLVMValueRef alloca) {
+    add_entry(name, alloca, 0);
+}
+
+void declare_value(const char* name, LLVMValueRef value) {
+    add_entry(name, value, 1);
+}
+
 void update_variable(const char* name, LLVMValueRef new_alloca) {
     LLVMScope* scope = current_scope;
     while (scope) {
@@ -7,6 +7,7 @@
 typedef struct ScopeVarEntry {
     char* name;
     LLVMValueRef alloca;
+    int is_value;   // 'alloca' es el valor mismo: la variable nunca se reasigna
     struct ScopeVarEntry* next;
 } ScopeVarEntry;
 
@@ -19,6 +20,12 @@ void push_scope(void);
 void pop_scope(void);
 LLVMValueRef lookup_variable(const char* name);
 void declare_variable(const char* name, LLVMValueRef alloca);
+
+// Variables enlazadas directamente a su valor, sin dirección. lookup_value
+// devuelve NULL si el nombre tiene una dirección (y lookup_variable si está
+// enlazado a un valor)
+LLVMValueRef lookup_value(const char* name);
+void declare_value(const char* name, LLVMValueRef value);
 void update_variable(const char* name, LLVMValueRef new_alloca);
 
 #endif
\ No newline at end of file
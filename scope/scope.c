@@ -106,6 +106,10 @@ void init_builtins(Scope* scope) {
     declare_function(
         scope, 1, (Type*[]){ &TYPE_STRING }, &TYPE_VOID, "print"
     );
+    // flush
+    declare_function(
+        scope, 0, NULL, &TYPE_VOID, "flush"
+    );
     // sqrt
     declare_function(
         scope, 1, (Type*[]){ &TYPE_NUMBER }, &TYPE_NUMBER, "sqrt"
@@ -3,7 +3,8 @@
 #include <stdio.h>
 
 LLVMValueRef accept_gen(LLVM_Visitor* visitor, ASTNode* node) {
-    if (!node) {
+    // Una expresión descartada y sin efectos no se genera
+    if (!node || node->flags & FLAG_DEAD) {
         return 0;
     }
     